@@ -21,6 +21,7 @@
 #include <media/stagefright/foundation/AMessage.h>
 
 #include <inttypes.h>
+#include <string.h>
 
 #include <C2Config.h>
 #include <C2Debug.h>
@@ -45,6 +46,10 @@ bool C2RKComponent::WorkQueue::empty() const {
     return mQueue.empty();
 }
 
+size_t C2RKComponent::WorkQueue::size() const {
+    return mQueue.size();
+}
+
 void C2RKComponent::WorkQueue::clear() {
     mQueue.clear();
 }
@@ -201,7 +206,10 @@ C2RKComponent::C2RKComponent(
     : mDummyReadView(DummyReadView()),
       mIntf(intf),
       mLooper(new ALooper),
-      mHandler(new WorkHandler) {
+      mHandler(new WorkHandler),
+      mTraceWork(intf->getName().c_str(), intf->getId(), "work"),
+      mTraceQueue(intf->getName().c_str(), intf->getId(), "queue"),
+      mCapacityId(0) {
     FunctionIn();
 
     mLooper->setName(intf->getName().c_str());
@@ -217,6 +225,8 @@ C2RKComponent::~C2RKComponent() {
     mLooper->unregisterHandler(mHandler->id());
     (void)mLooper->stop();
 
+    releaseCapacity();
+
     FunctionOut();
 }
 
@@ -256,9 +266,13 @@ c2_status_t C2RKComponent::queue_nb(std::list<std::unique_ptr<C2Work>> * const i
         Mutexed<WorkQueue>::Locked queue(mWorkQueue);
         queueWasEmpty = queue->empty();
         while (!items->empty()) {
+            const C2WorkOrdinalStruct &ordinal = items->front()->input.ordinal;
+            c2_trace_stage("queue", ordinal.frameIndex.peeku(), ordinal.timestamp.peekll());
+            mTraceWork.begin((int32_t)ordinal.frameIndex.peeku());
             queue->push_back(std::move(items->front()));
             items->pop_front();
         }
+        mTraceQueue.set(queue->size() + queue->pending().size());
     }
     if (queueWasEmpty) {
         (new AMessage(WorkHandler::kWhatProcess, mHandler))->post();
@@ -299,6 +313,10 @@ c2_status_t C2RKComponent::flush_sm(
             flushedWork->push_back(std::move(queue->pending().begin()->second));
             queue->pending().erase(queue->pending().begin());
         }
+        mTraceQueue.set(0);
+    }
+    for (const std::unique_ptr<C2Work> &work : *flushedWork) {
+        mTraceWork.end((int32_t)work->input.ordinal.frameIndex.peeku());
     }
 
     FunctionOut();
@@ -342,12 +360,17 @@ c2_status_t C2RKComponent::start() {
     }
     bool needsInit = (state->mState == UNINITIALIZED);
     state.unlock();
+    c2_status_t ret = acquireCapacity();
+    if (ret != C2_OK) {
+        return ret;
+    }
     if (needsInit) {
         sp<AMessage> reply;
         (new AMessage(WorkHandler::kWhatInit, mHandler))->postAndAwaitResponse(&reply);
         int32_t err;
         CHECK(reply->findInt32("err", &err));
         if (err != C2_OK) {
+            releaseCapacity();
             return (c2_status_t)err;
         }
     } else {
@@ -382,6 +405,7 @@ c2_status_t C2RKComponent::stop() {
     }
     sp<AMessage> reply;
     (new AMessage(WorkHandler::kWhatStop, mHandler))->postAndAwaitResponse(&reply);
+    releaseCapacity();
     int32_t err;
     CHECK(reply->findInt32("err", &err));
     if (err != C2_OK) {
@@ -408,6 +432,7 @@ c2_status_t C2RKComponent::reset() {
     }
     sp<AMessage> reply;
     (new AMessage(WorkHandler::kWhatReset, mHandler))->postAndAwaitResponse(&reply);
+    releaseCapacity();
     return C2_OK;
 }
 
@@ -415,9 +440,47 @@ c2_status_t C2RKComponent::release() {
     c2_info("release in");
     sp<AMessage> reply;
     (new AMessage(WorkHandler::kWhatRelease, mHandler))->postAndAwaitResponse(&reply);
+    releaseCapacity();
     return C2_OK;
 }
 
+c2_status_t C2RKComponent::acquireCapacity() {
+    C2CapacityRequest request;
+
+    memset(&request, 0, sizeof(request));
+    if (mCapacityId != 0 || !getCapacityRequest(&request)) {
+        return C2_OK;
+    }
+
+    c2_status_t err = C2RKCapacity::get()->reserve(request, &mCapacityId);
+    if (err != C2_OK) {
+        c2_err("%s: not enough hardware capacity to start", mIntf->getName().c_str());
+    }
+    return err;
+}
+
+c2_status_t C2RKComponent::updateCapacity() {
+    C2CapacityRequest request;
+
+    memset(&request, 0, sizeof(request));
+    if (mCapacityId == 0 || !getCapacityRequest(&request)) {
+        return C2_OK;
+    }
+
+    c2_status_t err = C2RKCapacity::get()->update(mCapacityId, request);
+    if (err != C2_OK) {
+        c2_warn("%s: stream exceeds the hardware capacity", mIntf->getName().c_str());
+    }
+    return err;
+}
+
+void C2RKComponent::releaseCapacity() {
+    if (mCapacityId != 0) {
+        C2RKCapacity::get()->release(mCapacityId);
+        mCapacityId = 0;
+    }
+}
+
 std::shared_ptr<C2ComponentInterface> C2RKComponent::intf() {
     return mIntf;
 }
@@ -432,6 +495,18 @@ std::list<std::unique_ptr<C2Work>> vec(std::unique_ptr<C2Work> &work) {
 
 }  // namespace
 
+void C2RKComponent::workDone(
+        const std::shared_ptr<C2Component::Listener> &listener,
+        std::unique_ptr<C2Work> &work) {
+    uint64_t frameIndex = work->input.ordinal.frameIndex.peeku();
+
+    c2_trace_stage("done", frameIndex, work->input.ordinal.timestamp.peekll());
+    if (frameIndex != OUTPUT_WORK_INDEX) {
+        mTraceWork.end((int32_t)frameIndex);
+    }
+    listener->onWorkDone_nb(shared_from_this(), vec(work));
+}
+
 void C2RKComponent::finish(
         uint64_t frameIndex,
         std::function<void(const std::unique_ptr<C2Work> &)> fillWork) {
@@ -445,6 +520,7 @@ void C2RKComponent::finish(
         }
         work = std::move(queue->pending().at(frameIndex));
         queue->pending().erase(frameIndex);
+        mTraceQueue.set(queue->size() + queue->pending().size());
     }
 
     finish(work, fillWork);
@@ -459,7 +535,7 @@ void C2RKComponent::finish(
 
     fillWork(work);
     std::shared_ptr<C2Component::Listener> listener = mExecState.lock()->mListener;
-    listener->onWorkDone_nb(shared_from_this(), vec(work));
+    workDone(listener, work);
     c2_trace("returning pending work");
 }
 
@@ -506,6 +582,7 @@ bool C2RKComponent::processQueue() {
         isFlushPending = queue->popPendingFlush();
         work = queue->pop_front();
         hasQueuedWork = !queue->empty();
+        mTraceQueue.set(queue->size() + queue->pending().size());
     }
     if (isFlushPending) {
         c2_trace("processing pending flush");
@@ -602,7 +679,11 @@ bool C2RKComponent::processQueue() {
             work->input.buffers.clear();
         }
     }
-    process(work, mOutputBlockPool);
+    {
+        c2_trace_stage("process", work->input.ordinal.frameIndex.peeku(),
+                       work->input.ordinal.timestamp.peekll());
+        process(work, mOutputBlockPool);
+    }
     c2_trace("processed frame #%" PRIu64, work->input.ordinal.frameIndex.peeku());
     Mutexed<WorkQueue>::Locked queue(mWorkQueue);
     if (queue->generation() != generation) {
@@ -614,7 +695,7 @@ bool C2RKComponent::processQueue() {
         Mutexed<ExecState>::Locked state(mExecState);
         std::shared_ptr<C2Component::Listener> listener = state->mListener;
         state.unlock();
-        listener->onWorkDone_nb(shared_from_this(), vec(work));
+        workDone(listener, work);
         return hasQueuedWork;
     }
     if (work->workletsProcessed != 0u) {
@@ -623,7 +704,7 @@ bool C2RKComponent::processQueue() {
         c2_trace("returning this work");
         std::shared_ptr<C2Component::Listener> listener = state->mListener;
         state.unlock();
-        listener->onWorkDone_nb(shared_from_this(), vec(work));
+        workDone(listener, work);
     } else {
         c2_trace("queue pending work");
         work->input.buffers.clear();
@@ -635,6 +716,7 @@ bool C2RKComponent::processQueue() {
             queue->pending().erase(frameIndex);
         }
         (void)queue->pending().insert({ frameIndex, std::move(work) });
+        mTraceQueue.set(queue->size() + queue->pending().size());
 
         queue.unlock();
         if (unexpected) {
@@ -643,7 +725,7 @@ bool C2RKComponent::processQueue() {
             Mutexed<ExecState>::Locked state(mExecState);
             std::shared_ptr<C2Component::Listener> listener = state->mListener;
             state.unlock();
-            listener->onWorkDone_nb(shared_from_this(), vec(unexpected));
+            workDone(listener, unexpected);
         }
     }
     return hasQueuedWork;
@@ -19,9 +19,12 @@
 
 // use MediaDefs here vs. MediaCodecConstants as this is not MediaCodec specific/dependent
 #include <media/stagefright/foundation/MediaDefs.h>
+#include <C2PlatformSupport.h>
 
 #include "C2RKInterface.h"
+#include "C2RKCapacityDef.h"
 #include "C2RKLog.h"
+#include "C2RKEnv.h"
 
 namespace android {
 
@@ -42,7 +45,9 @@ C2RKInterface<void>::BaseParams::BaseParams(
         C2Component::domain_t domain,
         C2String mediaType,
         std::vector<C2String> aliases)
-    : C2InterfaceHelper(reflector) {
+    : C2InterfaceHelper(reflector),
+      mCapacityType(MPP_CTX_BUTT),
+      mCapacityCodingType(MPP_VIDEO_CodingUnused) {
     FunctionIn();
 
     setDerivedInstance(this);
@@ -118,6 +123,15 @@ C2RKInterface<void>::BaseParams::BaseParams(
     }
     bool isEncoder = kind == C2Component::KIND_ENCODER;
 
+    // zero-copy decoder input needs dma-buf backed blocks to import into mpp
+    if (!isEncoder && domain == C2Component::DOMAIN_VIDEO) {
+        C2_U32 zeroCopy = 0;
+        Rockchip_C2_GetEnvU32("vendor.c2.dec.input.zerocopy", &zeroCopy, 0);
+        if (zeroCopy) {
+            codedAllocator = C2PlatformAllocatorStore::ION;
+        }
+    }
+
     // handle raw decoders
     if (mediaType == rawMediaType) {
         codedBufferType = rawBufferType;
@@ -337,6 +351,38 @@ void C2RKInterface<void>::BaseParams::noTimeStretch() {
     FunctionOut();
 }
 
+void C2RKInterface<void>::BaseParams::addAvailableCapacity(
+        MppCtxType type, MppCodingType codingType) {
+    FunctionIn();
+
+    mCapacityType = type;
+    mCapacityCodingType = codingType;
+
+    addParameter(
+            DefineParam(mAvailableCapacity, C2_PARAMKEY_AVAILABLE_CAPACITY)
+            .withDefault(new C2AvailableCapacityInfo(UINT64_MAX))
+            .withFields({C2F(mAvailableCapacity, value).any()})
+            .withSetter(Setter<decltype(*mAvailableCapacity)>::StrictValueWithNoDeps)
+            .build());
+
+    FunctionOut();
+}
+
+c2_status_t C2RKInterface<void>::BaseParams::query(
+        const std::vector<C2Param*> &stackParams,
+        const std::vector<C2Param::Index> &heapParamIndices,
+        c2_blocking_t mayBlock,
+        std::vector<std::unique_ptr<C2Param>>* const heapParams) const {
+    if (mAvailableCapacity) {
+        uint64_t mbps = C2RKCapacity::get()->getAvailableMbps(
+                mCapacityType, mCapacityCodingType);
+        Lock lock = this->lock();
+        mAvailableCapacity->value = mbps;
+    }
+
+    return C2InterfaceHelper::query(stackParams, heapParamIndices, mayBlock, heapParams);
+}
+
 /*
     Clients need to handle the following base params due to custom dependency.
 
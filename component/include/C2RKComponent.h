@@ -24,6 +24,8 @@
 #include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/Mutexed.h>
 #include "C2Component.h"
+#include "C2RKTrace.h"
+#include "C2RKCapacityDef.h"
 
 #define OUTPUT_WORK_INDEX            INT64_MAX
 
@@ -84,6 +86,26 @@ protected:
      */
     virtual c2_status_t onFlush_sm() = 0;
 
+    /**
+     * Describe the hardware load of the session for admission control.
+     *
+     * This method is called during every start(), the load is reserved until
+     * stop(), reset() or release(). Return false to skip the check.
+     */
+    virtual bool getCapacityRequest(C2CapacityRequest *request) {
+        (void)request;
+        return false;
+    }
+
+    /**
+     * Move the reservation taken at start() to the current getCapacityRequest(),
+     * for sessions whose load is only known while running.
+     *
+     * \retval C2_NO_MEMORY   the core can not take the new load, the old
+     *                        reservation is kept
+     */
+    c2_status_t updateCapacity();
+
     /**
      * Process the given work and finish pending work using finish().
      *
@@ -224,6 +246,7 @@ private:
         std::unique_ptr<C2Work> pop_front();
         void push_back(std::unique_ptr<C2Work> work);
         bool empty() const;
+        size_t size() const;
         uint32_t drainMode() const;
         void markDrain(uint32_t drainMode);
         inline bool popPendingFlush() {
@@ -250,6 +273,20 @@ private:
     class BlockingBlockPool;
     std::shared_ptr<BlockingBlockPool> mOutputBlockPool;
 
+    // work lifecycle from queue_nb to onWorkDone_nb, and works held
+    C2RKTraceTrack mTraceWork;
+    C2RKTraceTrack mTraceQueue;
+
+    void workDone(
+            const std::shared_ptr<C2Component::Listener> &listener,
+            std::unique_ptr<C2Work> &work);
+
+    // id of the C2RKCapacity reservation held while running, 0 if none
+    int32_t mCapacityId;
+
+    c2_status_t acquireCapacity();
+    void releaseCapacity();
+
     C2RKComponent() = delete;
 };
 
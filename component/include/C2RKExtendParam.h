@@ -43,6 +43,17 @@ enum ExtendedC2ParamIndexKind : C2Param::type_index_t {
     kParamIndexMLVECTriggerTime,
     kParamIndexMLVECDownScalar,
     kParamIndexMLVECInputCrop,
+    /* osd overlay parameters */
+    kParamIndexOsdPalette,
+    kParamIndexOsdData,
+    /* decoder parameters */
+    kParamIndexKeyFrameOnly,
+    kParamIndexRenderClock,
+    kParamIndexDropStats,
+    kParamIndexScaledOutput,
+    kParamIndexErrorPolicy,
+    kParamIndexCorruptedFrame,
+    kParamIndexAvailableCapacity,
 };
 
 typedef C2PortParam<C2Info, C2Int32Value, kParamIndexSceneMode> C2StreamSceneModeInfo;
@@ -315,4 +326,165 @@ struct C2CropStruct {
 typedef C2PortParam<C2Info, C2CropStruct, kParamIndexMLVECInputCrop> C2InputCrop;
 constexpr char C2_PARAMKEY_MLVEC_INPUT_CROP[] = "rtc-ext-enc-input";
 
+/*
+ * 19. OsdPalette is the user defined OSD palette, at most 256 entries of
+ *     32-bit YUVA value (v | u << 8 | y << 16 | alpha << 24). An empty
+ *     palette selects the fixed hardware palette.
+ *     key-name: vendor.osd-palette.value
+ */
+typedef C2PortParam<C2Tuning, C2BlobValue, kParamIndexOsdPalette> C2StreamOsdPaletteTuning;
+constexpr char C2_PARAMKEY_OSD_PALETTE[] = "osd-palette";
+
+/*
+ * 20. OsdData describes the OSD regions blended into every following input
+ *     frame, laid out as a C2OsdDataHeader followed by the palette index
+ *     bitmap of all regions (one byte per pixel, 256 bytes per MB). Region
+ *     position and size are in units of 16x16 MB. An empty value disables OSD.
+ *     key-name: vendor.osd-data.value
+ */
+#define C2_OSD_MAX_REGIONS  8
+
+struct C2OsdRegionDesc {
+    uint32_t enable;
+    uint32_t inverse;
+    uint32_t startMbX;
+    uint32_t startMbY;
+    uint32_t numMbX;
+    uint32_t numMbY;
+    uint32_t bufOffset; /* offset of region bitmap after the header */
+};
+
+struct C2OsdDataHeader {
+    uint32_t numRegion;
+    C2OsdRegionDesc regions[C2_OSD_MAX_REGIONS];
+};
+
+typedef C2PortParam<C2Tuning, C2BlobValue, kParamIndexOsdData> C2StreamOsdDataTuning;
+constexpr char C2_PARAMKEY_OSD_DATA[] = "osd-data";
+
+/*
+ * 21. KeyFrameOnly makes the decoder drop every access unit that is not a
+ *     sync frame before it reaches the hardware, only key frames are decoded
+ *     and output. Meant for thumbnails and trick play index generation.
+ *     key-name: vendor.keyframe-only.value
+ */
+typedef C2PortParam<C2Tuning, C2Int32Value, kParamIndexKeyFrameOnly> C2StreamKeyFrameOnlyTuning;
+constexpr char C2_PARAMKEY_KEYFRAME_ONLY[] = "keyframe-only";
+
+/*
+ * 22. RenderClock maps media time to the monotonic clock of the renderer,
+ *     systemTimeUs is when the frame of pts mediaTimeUs gets displayed.
+ *     The decoder does not output frames that are more than lateThresholdUs
+ *     behind this clock, and skips decoding late non-reference frames.
+ *     A zero systemTimeUs disables late frame dropping.
+ *     key-name: vendor.render-clock.media-time-us(system-time-us,
+ *               late-threshold-us)
+ */
+struct C2RenderClockStruct {
+    int64_t mediaTimeUs;
+    int64_t systemTimeUs;
+    int64_t lateThresholdUs;
+    C2RenderClockStruct() : mediaTimeUs(0), systemTimeUs(0), lateThresholdUs(0) { }
+    C2RenderClockStruct(int64_t _mediaTimeUs, int64_t _systemTimeUs, int64_t _lateThresholdUs)
+        : mediaTimeUs(_mediaTimeUs), systemTimeUs(_systemTimeUs),
+          lateThresholdUs(_lateThresholdUs) {}
+
+    const static std::vector<C2FieldDescriptor> _FIELD_LIST;
+    static const std::vector<C2FieldDescriptor> FieldList();
+};
+
+typedef C2PortParam<C2Tuning, C2RenderClockStruct, kParamIndexRenderClock> C2StreamRenderClockTuning;
+constexpr char C2_PARAMKEY_RENDER_CLOCK[] = "render-clock";
+
+/*
+ * 23. DropStats counts the frames dropped for being late, either before
+ *     decoding or before output.
+ *     key-name: vendor.drop-stats.skipped-decode(dropped-output)
+ */
+struct C2DropStatsStruct {
+    int32_t skippedDecode;
+    int32_t droppedOutput;
+    C2DropStatsStruct() : skippedDecode(0), droppedOutput(0) { }
+    C2DropStatsStruct(int32_t _skippedDecode, int32_t _droppedOutput)
+        : skippedDecode(_skippedDecode), droppedOutput(_droppedOutput) {}
+
+    const static std::vector<C2FieldDescriptor> _FIELD_LIST;
+    static const std::vector<C2FieldDescriptor> FieldList();
+};
+
+typedef C2PortParam<C2Info, C2DropStatsStruct, kParamIndexDropStats> C2StreamDropStatsInfo;
+constexpr char C2_PARAMKEY_DROP_STATS[] = "drop-stats";
+
+/*
+ * 24. ScaledOutput asks the decoder for a second, scaled and converted copy
+ *     of every frame, attached behind the display buffer of the same output
+ *     work as a linear buffer. format is a hal pixel format, one of
+ *     RGB_888, RGBA_8888 or YCrCb_NV12, planes are packed without padding.
+ *     A zero width or height disables the second output.
+ *     key-name: vendor.scaled-output.width(height, format)
+ */
+struct C2ScaledOutputStruct {
+    int32_t width;
+    int32_t height;
+    int32_t format;
+    C2ScaledOutputStruct() : width(0), height(0), format(0) { }
+    C2ScaledOutputStruct(int32_t _width, int32_t _height, int32_t _format)
+        : width(_width), height(_height), format(_format) {}
+
+    const static std::vector<C2FieldDescriptor> _FIELD_LIST;
+    static const std::vector<C2FieldDescriptor> FieldList();
+};
+
+typedef C2PortParam<C2Tuning, C2ScaledOutputStruct, kParamIndexScaledOutput> C2StreamScaledOutputTuning;
+constexpr char C2_PARAMKEY_SCALED_OUTPUT[] = "scaled-output";
+
+/*
+ * 25. ErrorPolicy decides what the decoder does with frames mpp reports
+ *     as corrupted.
+ *     0: output them like any other frame (default)
+ *     1: drop them
+ *     2: drop them and every frame after, until the next sync frame, so the
+ *        display holds the last good picture
+ *     key-name: vendor.error-policy.value
+ */
+enum C2RKErrorPolicy {
+    C2_ERROR_POLICY_OUTPUT = 0,
+    C2_ERROR_POLICY_DROP,
+    C2_ERROR_POLICY_HOLD,
+};
+
+typedef C2PortParam<C2Tuning, C2Int32Value, kParamIndexErrorPolicy> C2StreamErrorPolicyTuning;
+constexpr char C2_PARAMKEY_ERROR_POLICY[] = "error-policy";
+
+/*
+ * 26. CorruptedFrame is sent as a config update when an error policy is
+ *     set and a corrupted frame came out of the decoder, so the client can
+ *     ask the sender for a key frame. count is the total so far, timestampUs
+ *     the pts of the last corrupted frame.
+ *     key-name: vendor.corrupted-frame.count(timestamp-us)
+ */
+struct C2CorruptedFrameStruct {
+    int32_t count;
+    int64_t timestampUs;
+    C2CorruptedFrameStruct() : count(0), timestampUs(0) { }
+    C2CorruptedFrameStruct(int32_t _count, int64_t _timestampUs)
+        : count(_count), timestampUs(_timestampUs) {}
+
+    const static std::vector<C2FieldDescriptor> _FIELD_LIST;
+    static const std::vector<C2FieldDescriptor> FieldList();
+};
+
+typedef C2PortParam<C2Info, C2CorruptedFrameStruct, kParamIndexCorruptedFrame> C2StreamCorruptedFrameInfo;
+constexpr char C2_PARAMKEY_CORRUPTED_FRAME[] = "corrupted-frame";
+
+/*
+ * 27. AvailableCapacity is the macroblock rate per second the hardware core
+ *     of the component's codec still has free, read at query time, so the
+ *     client can check a stream fits before starting it. UINT64_MAX if the
+ *     core is not limited.
+ *     key-name: vendor.available-capacity.value
+ */
+typedef C2GlobalParam<C2Info, C2Uint64Value, kParamIndexAvailableCapacity> C2AvailableCapacityInfo;
+constexpr char C2_PARAMKEY_AVAILABLE_CAPACITY[] = "available-capacity";
+
 #endif  // ANDROID_C2_RK_EXTEND_PARAMS_H
@@ -20,6 +20,8 @@
 #include <C2Config.h>
 #include <util/C2InterfaceHelper.h>
 #include "C2Component.h"
+#include "C2RKExtendParam.h"
+#include "mpp/rk_type.h"
 
 namespace android {
 
@@ -123,6 +125,17 @@ public:
         /// must add support for C2ComponentTimeStretchTuning.
         void noTimeStretch();
 
+        /// Exposes the free capacity of the hardware core running this component
+        /// as C2AvailableCapacityInfo, read from C2RKCapacity on every query.
+        void addAvailableCapacity(MppCtxType type, MppCodingType codingType);
+
+        /// C2InterfaceHelper::query that refreshes the query-time values first.
+        c2_status_t query(
+                const std::vector<C2Param*> &stackParams,
+                const std::vector<C2Param::Index> &heapParamIndices,
+                c2_blocking_t mayBlock,
+                std::vector<std::unique_ptr<C2Param>>* const heapParams) const;
+
         std::shared_ptr<C2ApiLevelSetting> mApiLevel;
         std::shared_ptr<C2ApiFeaturesSetting> mApiFeatures;
 
@@ -178,6 +191,10 @@ public:
         std::shared_ptr<C2PortConfigCounterTuning::input> mInputConfigCounter;
         std::shared_ptr<C2PortConfigCounterTuning::output> mOutputConfigCounter;
         std::shared_ptr<C2ConfigCounterTuning> mDirectConfigCounter;
+
+        std::shared_ptr<C2AvailableCapacityInfo> mAvailableCapacity;
+        MppCtxType mCapacityType;
+        MppCodingType mCapacityCodingType;
     };
 };
 
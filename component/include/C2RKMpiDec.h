@@ -20,7 +20,11 @@
 #include "C2RKComponent.h"
 #include "C2RKInterface.h"
 #include "mpp/rk_mpi.h"
+#include "C2RKDump.h"
+#include "C2RKJobQueue.h"
+#include "C2RKPacketStats.h"
 
+#include <list>
 #include <mutex>
 #include <utils/Vector.h>
 
@@ -41,6 +45,7 @@ public:
     void onReset() override;
     void onRelease() override;
     c2_status_t onFlush_sm() override;
+    bool getCapacityRequest(C2CapacityRequest *request) override;
 
     void process(
             const std::unique_ptr<C2Work> &work,
@@ -83,6 +88,7 @@ private:
     MppCodingType   mCodingType;
     MppFrameFormat  mColorFormat;
     MppBufferGroup  mFrmGrp;
+    MppBufferType   mBufferType;    /* of groups and imports */
     Vector<OutBuffer*> mOutBuffers;
 
     uint32_t mWidth;
@@ -102,14 +108,25 @@ private:
     bool mSignalledInputEos;
     bool mSignalledError;
     bool mLowLatencyMode;
+    /* drop everything but sync frames before sendpacket */
+    bool mKeyFrameOnly;
 
     /*
        1. BufferMode:  without surcace
        2. SurfaceMode: with surface
     */
     bool mBufferMode;
-    FILE *mOutFile;
-    FILE *mInFile;
+    /* hal format of the buffer mode output */
+    uint32_t mOutputFormat;
+    /* format of mOutBlock, and the one last reported to the client */
+    uint32_t mOutBlockFormat;
+    uint32_t mReportedFormat;
+    C2RKDump *mOutFile;
+    C2RKDump *mInFile;
+
+    /* output buffers held by mpp and by c2 */
+    C2RKTraceTrack mTraceMpiBuffers;
+    C2RKTraceTrack mTraceC2Buffers;
 
     struct FbcConfig {
         uint32_t mode;
@@ -138,8 +155,81 @@ private:
         }
     } mBitstreamColorAspects;
 
+    // render clock hint, frames later than it are dropped
+    struct RenderClock {
+        int64_t mediaTimeUs;
+        int64_t systemTimeUs;       /* 0 if no hint */
+        int64_t lateThresholdUs;
+    } mRenderClock;
+    uint32_t mSkippedDecode;
+    uint32_t mDroppedOutput;
+    bool     mDropStatsPending;     /* counters changed since the last report */
+    int32_t  mMaxTemporalId;        /* from the hevc sps, -1 if not seen */
+
+    // optional second output per frame, scaled by rga off the decode thread
+    struct ScaledOutput {
+        int32_t width;              /* 0 if disabled */
+        int32_t height;
+        int32_t format;
+    } mScaledOutput;
+    std::shared_ptr<C2BlockPool> mScaledPool;
+    C2RKJobQueue *mScaleQueue;
+
+    // corrupted frame handling, see C2RKErrorPolicy
+    uint32_t mErrorPolicy;
+    bool     mWaitSync;             /* holding until a sync frame */
+    int64_t  mLastSyncPts;
+    int64_t  mRecoverPts;           /* sync frame ending the hold, -1 if unknown */
+    uint32_t mCorruptedCount;
+    int64_t  mCorruptedPts;
+    bool     mCorruptedPending;     /* report with the next finished work */
+
+    // zero-copy input, dma-buf inputs are imported into mInGrp and their
+    // works stay pending until mpp dropped the packet
+    typedef struct {
+        uint64_t frameIndex;
+        /* holds the block away from the client */
+        std::shared_ptr<C2Buffer> buffer;
+    } InWork;
+
+    MppBufferGroup     mInGrp;
+    uint32_t           mInImported;     /* imported since the group was cleared */
+    std::list<InWork>  mInWorks;
+
+    // input buffer size follows the packets seen, starting from the
+    // level-derived size of the interface. changes go out as configUpdate
+    // only, the interface value stays the initial upper bound.
+    bool               mAdaptiveInput;
+    size_t             mMaxInputSize;   /* last size signalled */
+    size_t             mInitInputSize;  /* never grow past it */
+    C2RKPacketStats    mInputStats;
+
+    // output buffers kept in mpp, lowered by the process memory budget
+    // but never below the dpb, from the sps, the level or learned from mpp
+    uint32_t mLevel;                /* C2Config::level_t of the stream */
+    int32_t  mStreamRefCount;       /* dpb declared by the sps, -1 if not seen */
+    uint32_t mMppDpbCount;          /* buffers mpp needed, 0 until starved */
+    uint32_t mOutBufferCount;
+    bool     mOutDelayChanged;      /* report mOutBufferCount as output delay */
+
+    // C2RKCapacity load of the session, the stream frame rate is estimated
+    // from the input timestamps
+    int64_t  mRateStartPts;
+    uint32_t mRateFrames;
+    float    mFrameRate;            /* 0 until estimated */
+
+    // buffer mode frames from the process wide C2RKFramePool instead of
+    // mpp internal buffers, imported into mFrmGrp
+    bool     mSharedPool;
+    uint32_t mPoolCount;            /* reserved from the pool */
+    size_t   mFrameBufSize;         /* mpp frame size, 0 before info-change */
+
     void fillEmptyWork(const std::unique_ptr<C2Work> &work);
     void finishWork(OutWorkEntry *entry);
+    void sendOutputWork(
+            const std::shared_ptr<C2Buffer> &buffer,
+            const std::shared_ptr<C2Buffer> &scaled,
+            uint64_t timestamp);
     c2_status_t drainInternal(
         uint32_t drainMode,
         const std::shared_ptr<C2BlockPool> &pool,
@@ -148,11 +238,31 @@ private:
     c2_status_t initDecoder();
     void getVuiParams(MppFrame frame);
     c2_status_t sendpacket(
-            uint8_t *data, size_t size, uint64_t pts, uint32_t flags);
+            uint8_t *data, size_t size, uint64_t pts, uint32_t flags,
+            MppBuffer buffer = nullptr, size_t offset = 0);
     c2_status_t getoutframe(OutWorkEntry *entry, bool needGetFrame);
 
+    MppBuffer importInputBuffer(const std::unique_ptr<C2Work> &work, size_t *offset);
+    void releaseInputWorks(bool all);
+    void updateInputSize(const std::unique_ptr<C2Work> &work, size_t size, bool sync);
+
+    void updateFrameRate(int64_t pts);
+    void updateRenderClock();
+    bool isLate(int64_t pts);
+    void updateDropStats();
+    bool checkErrorFrame(int64_t pts, bool corrupted);
+
+    void updateScaledOutput();
+    void postScaleJob(const std::shared_ptr<C2Buffer> &buffer, uint64_t timestamp);
+
     c2_status_t commitBufferToMpp(std::shared_ptr<C2GraphicBlock> block);
     c2_status_t ensureDecoderState(const std::shared_ptr<C2BlockPool> &pool);
+    uint32_t getMinOutBufferCount();
+    void checkOutBufferStarved();
+    c2_status_t reservePoolBuffers();
+    void releasePoolBuffers();
+    void updateOutBufferCount();
+    bool isRgbOutput();
 
     /*
      * OutBuffer vector operations
@@ -213,6 +323,14 @@ private:
         return count;
     }
 
+    void traceOutBuffers() {
+        if (C2_TRACE_ENABLED()) {
+            int mpiCount = getOutBufferCountOwnByMpi();
+            mTraceMpiBuffers.set(mpiCount);
+            mTraceC2Buffers.set(mOutBuffers.size() - mpiCount);
+        }
+    }
+
     C2_DO_NOT_COPY(C2RKMpiDec);
 };
 
@@ -20,6 +20,8 @@
 #include "C2RKComponent.h"
 #include "mpp/rk_mpi.h"
 #include "C2RKMlvecLegacy.h"
+#include "C2RKExtendParam.h"
+#include "C2RKDump.h"
 
 namespace android {
 
@@ -35,6 +37,7 @@ public:
     void onReset() override;
     void onRelease() override;
     c2_status_t onFlush_sm() override;
+    bool getCapacityRequest(C2CapacityRequest *request) override;
     void process(
             const std::unique_ptr<C2Work> &work,
             const std::shared_ptr<C2BlockPool> &pool) override;
@@ -62,6 +65,21 @@ private:
         uint64_t  frameIndex;
     } OutWorkEntry;
 
+    /* parameters that end up in sps/pps/vps */
+    typedef struct {
+        uint32_t width;
+        uint32_t height;
+        uint32_t profile;
+        uint32_t level;
+        uint32_t primaries;
+        uint32_t transfer;
+        uint32_t matrix;
+        uint32_t range;
+        int32_t  layerCount;
+        int32_t  maxBframes;
+        int32_t  refPeriod;
+    } MyCsdKey_t;
+
     std::shared_ptr<IntfImpl> mIntf;
     MyDmaBuffer_t *mDmaMem;
     C2RKMlvecLegacy *mMlvec;
@@ -82,18 +100,36 @@ private:
     int32_t        mHorStride;
     int32_t        mVerStride;
     int32_t        mCurLayerCount;
+    int32_t        mMaxBframes;
+    /* frames between two layer 0 references, 0 means flat */
+    int32_t        mRefPeriod;
     int32_t        mInputCount;
     int32_t        mOutputCount;
 
+    /* hardware OSD overlay */
+    MppBuffer      mOsdBuffer;
+    MppEncOSDData  mOsdCfg;
+    bool           mOsdEnable;
+
+    /* stream headers, kept across resets while the key matches */
+    std::vector<uint8_t> mCsd;
+    MyCsdKey_t     mCsdKey;
+
     /* dump file for debug */
-    FILE          *mInFile;
-    FILE          *mOutFile;
+    C2RKDump      *mInFile;
+    C2RKDump      *mOutFile;
+
+    /* frames sent to mpp and not yet returned */
+    C2RKTraceTrack mTraceHwFrames;
 
     // configurations used by component in process
     // (TODO: keep this in intf but make them internal only)
     std::shared_ptr<C2StreamPictureSizeInfo::input> mSize;
     std::shared_ptr<C2StreamBitrateInfo::output> mBitrate;
     std::shared_ptr<C2StreamRequestSyncFrameTuning::output> mRequestSync;
+    std::shared_ptr<C2StreamOsdPaletteTuning::input> mOsdPalette;
+    std::shared_ptr<C2StreamOsdDataTuning::input> mOsdData;
+    std::shared_ptr<C2StreamOsdDataTuning::input> mOsdRejected;  /* invalid, not retried */
 
     void fillEmptyWork(const std::unique_ptr<C2Work> &work);
     void finishWork(
@@ -112,15 +148,19 @@ private:
     c2_status_t setupQp();
     c2_status_t setupVuiParams();
     c2_status_t setupTemporalLayers();
+    c2_status_t setupGopStructure();
     c2_status_t setupPrependHeaderSetting();
     c2_status_t setupMlvecIfNeccessary();
     c2_status_t setupEncCfg();
 
     c2_status_t initEncoder();
     c2_status_t releaseEncoder();
+    c2_status_t updateCsd();
 
     c2_status_t handleRequestSyncFrame();
     c2_status_t handleMlvecDynamicCfg(MppMeta meta);
+    c2_status_t handleOsdCfg(MppMeta meta);
+    c2_status_t setupOsdData(const std::shared_ptr<C2StreamOsdDataTuning::input> &data);
 
     c2_status_t getInBufferFromWork(
             const std::unique_ptr<C2Work> &work, MyDmaBuffer_t *outBuffer);
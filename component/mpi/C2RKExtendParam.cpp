@@ -112,3 +112,37 @@ const std::vector<C2FieldDescriptor> C2CropStruct::_FIELD_LIST = {
     { C2FieldDescriptor::INT32, 1, "crop-width", 8, 4 },
     { C2FieldDescriptor::INT32, 1, "crop-height", 12, 4 }
 };
+
+const std::vector<C2FieldDescriptor> C2RenderClockStruct::FieldList() {
+    return _FIELD_LIST;
+}
+const std::vector<C2FieldDescriptor> C2RenderClockStruct::_FIELD_LIST = {
+    { C2FieldDescriptor::INT64, 1, "media-time-us", 0, 8 },
+    { C2FieldDescriptor::INT64, 1, "system-time-us", 8, 8 },
+    { C2FieldDescriptor::INT64, 1, "late-threshold-us", 16, 8 }
+};
+
+const std::vector<C2FieldDescriptor> C2DropStatsStruct::FieldList() {
+    return _FIELD_LIST;
+}
+const std::vector<C2FieldDescriptor> C2DropStatsStruct::_FIELD_LIST = {
+    { C2FieldDescriptor::INT32, 1, "skipped-decode", 0, 4 },
+    { C2FieldDescriptor::INT32, 1, "dropped-output", 4, 4 }
+};
+
+const std::vector<C2FieldDescriptor> C2ScaledOutputStruct::FieldList() {
+    return _FIELD_LIST;
+}
+const std::vector<C2FieldDescriptor> C2ScaledOutputStruct::_FIELD_LIST = {
+    { C2FieldDescriptor::INT32, 1, "width", 0, 4 },
+    { C2FieldDescriptor::INT32, 1, "height", 4, 4 },
+    { C2FieldDescriptor::INT32, 1, "format", 8, 4 }
+};
+
+const std::vector<C2FieldDescriptor> C2CorruptedFrameStruct::FieldList() {
+    return _FIELD_LIST;
+}
+const std::vector<C2FieldDescriptor> C2CorruptedFrameStruct::_FIELD_LIST = {
+    { C2FieldDescriptor::INT32, 1, "count", 0, 4 },
+    { C2FieldDescriptor::INT64, 1, "timestamp-us", 8, 8 }
+};
@@ -35,12 +35,21 @@
 #include "C2RKColorAspects.h"
 #include "C2RKVersion.h"
 #include "C2RKEnv.h"
+#include "C2RKMppCtxPool.h"
+#include "C2RKBitstream.h"
+#include "C2RKExtendParam.h"
+#include "C2RKJobQueue.h"
+#include "C2RKMemoryBudget.h"
+#include "C2RKFramePool.h"
+#include "C2RKChipCapDef.h"
 #include <sys/syscall.h>
 
 namespace android {
 
 constexpr uint32_t kDefaultOutputDelay = 16;
 constexpr uint32_t kMaxOutputDelay = 16;
+/* no references when only key frames are decoded: one held, one decoded, one out */
+constexpr uint32_t kKeyFrameOnlyOutputDelay = 1 + 2;
 
 /* max support video resolution */
 constexpr uint32_t kMaxVideoWidth = 8192;
@@ -51,6 +60,34 @@ constexpr size_t kMinInputBufferSize = 2 * 1024 * 1024;
 
 constexpr uint32_t kMaxGegerationClearCount = 100;
 
+/* scaled outputs queued ahead of rga before the decode thread waits */
+constexpr uint32_t kMaxScaleJobs = 2;
+
+/*
+ * inputs mpp may read in place, later ones are copied until it catches up.
+ * kept below the input slots of the client so it never runs out of inputs
+ * while works wait for mpp.
+ */
+constexpr uint32_t kMaxZeroCopyInputs = 4;
+
+/*
+ * released imports stay in the input group until it is cleared, which
+ * needs all pending inputs done. past this many imports new inputs are
+ * copied so the pending ones drain and the group gets cleared.
+ */
+constexpr uint32_t kMaxInputImports = 64;
+
+/*
+ * adaptive input size: sizes are re-evaluated every kInputStatsInterval
+ * packets once two sync frames went by, and only shrunk if that saves at
+ * least a quarter, so the framework does not reallocate inputs for noise.
+ */
+constexpr uint32_t kInputStatsInterval = 64;
+constexpr size_t kMinAdaptiveInputSize = 256 * 1024;
+constexpr size_t kInputSizeAlign = 64 * 1024;
+// inputs the frame rate estimate spans
+constexpr uint32_t kFrameRateWindow = 32;
+
 class C2RKMpiDec::IntfImpl : public C2RKInterface<void>::BaseParams {
 public:
     explicit IntfImpl(
@@ -60,6 +97,11 @@ public:
             C2Component::domain_t domain,
             C2String mediaType)
         : C2RKInterface<void>::BaseParams(helper, name, kind, domain, mediaType) {
+        MppCodingType codingType = MPP_VIDEO_CodingUnused;
+        if (C2RKMediaUtils::getCodingTypeFromComponentName(name, &codingType)) {
+            addAvailableCapacity(MPP_CTX_DEC, codingType);
+        }
+
         addParameter(
                 DefineParam(mActualOutputDelay, C2_PARAMKEY_OUTPUT_DELAY)
                 .withDefault(new C2PortActualDelayTuning::output(kDefaultOutputDelay))
@@ -103,11 +145,18 @@ public:
                 .withSetter(BlockSizeSetter)
                 .build());
 
-        // TODO: support more formats?
+        // rgb formats only apply to buffer mode, rga converts on copy out
         addParameter(
                 DefineParam(mPixelFormat, C2_PARAMKEY_PIXEL_FORMAT)
-                .withConstValue(new C2StreamPixelFormatInfo::output(
+                .withDefault(new C2StreamPixelFormatInfo::output(
                                     0u, HAL_PIXEL_FORMAT_YCBCR_420_888))
+                .withFields({C2F(mPixelFormat, value).oneOf({
+                    HAL_PIXEL_FORMAT_YCBCR_420_888,
+                    HAL_PIXEL_FORMAT_RGBA_8888,
+                    HAL_PIXEL_FORMAT_BGRA_8888,
+                    HAL_PIXEL_FORMAT_RGB_565
+                })})
+                .withSetter(Setter<decltype(*mPixelFormat)>::StrictValueWithNoDeps)
                 .build());
 
         // profile and level
@@ -263,15 +312,26 @@ public:
                     .build());
         }
 
-        // max input buffer size
-        addParameter(
-                DefineParam(mMaxInputSize, C2_PARAMKEY_INPUT_MAX_BUFFER_SIZE)
-                .withDefault(new C2StreamMaxBufferSizeInfo::input(0u, kMinInputBufferSize))
-                .withFields({
-                    C2F(mMaxInputSize, value).any(),
-                })
-                .calculatedAs(MaxInputSizeSetter, mMaxSize)
-                .build());
+        // max input buffer size, bounded by the declared level if there is one
+        if (mProfileLevel != nullptr) {
+            addParameter(
+                    DefineParam(mMaxInputSize, C2_PARAMKEY_INPUT_MAX_BUFFER_SIZE)
+                    .withDefault(new C2StreamMaxBufferSizeInfo::input(0u, kMinInputBufferSize))
+                    .withFields({
+                        C2F(mMaxInputSize, value).any(),
+                    })
+                    .calculatedAs(LevelMaxInputSizeSetter, mMaxSize, mProfileLevel)
+                    .build());
+        } else {
+            addParameter(
+                    DefineParam(mMaxInputSize, C2_PARAMKEY_INPUT_MAX_BUFFER_SIZE)
+                    .withDefault(new C2StreamMaxBufferSizeInfo::input(0u, kMinInputBufferSize))
+                    .withFields({
+                        C2F(mMaxInputSize, value).any(),
+                    })
+                    .calculatedAs(MaxInputSizeSetter, mMaxSize)
+                    .build());
+        }
 
         // ColorInfo
         C2ChromaOffsetStruct locations[1] = { C2ChromaOffsetStruct::ITU_YUV_420_0() };
@@ -357,6 +417,69 @@ public:
                     .withSetter(Setter<decltype(*mLowLatency)>::NonStrictValueWithNoDeps)
                     .build());
         }
+
+        addParameter(
+                DefineParam(mKeyFrameOnly, C2_PARAMKEY_KEYFRAME_ONLY)
+                .withDefault(new C2StreamKeyFrameOnlyTuning::input(0u, 0))
+                .withFields({C2F(mKeyFrameOnly, value).inRange(0, 1)})
+                .withSetter(Setter<decltype(*mKeyFrameOnly)>::StrictValueWithNoDeps)
+                .build());
+
+        addParameter(
+                DefineParam(mRenderClock, C2_PARAMKEY_RENDER_CLOCK)
+                .withDefault(new C2StreamRenderClockTuning::output(0u, 0, 0, 0))
+                .withFields({
+                    C2F(mRenderClock, mediaTimeUs).any(),
+                    C2F(mRenderClock, systemTimeUs).any(),
+                    C2F(mRenderClock, lateThresholdUs).any(),
+                })
+                .withSetter(Setter<decltype(*mRenderClock)>::StrictValueWithNoDeps)
+                .build());
+
+        addParameter(
+                DefineParam(mDropStats, C2_PARAMKEY_DROP_STATS)
+                .withDefault(new C2StreamDropStatsInfo::output(0u, 0, 0))
+                .withFields({
+                    C2F(mDropStats, skippedDecode).any(),
+                    C2F(mDropStats, droppedOutput).any(),
+                })
+                .withSetter(Setter<decltype(*mDropStats)>::StrictValueWithNoDeps)
+                .build());
+
+        addParameter(
+                DefineParam(mScaledOutput, C2_PARAMKEY_SCALED_OUTPUT)
+                .withDefault(new C2StreamScaledOutputTuning::output(
+                        0u, 0, 0, HAL_PIXEL_FORMAT_RGB_888))
+                .withFields({
+                    C2F(mScaledOutput, width).inRange(0, kMaxVideoWidth, 2),
+                    C2F(mScaledOutput, height).inRange(0, kMaxVideoHeight, 2),
+                    C2F(mScaledOutput, format).oneOf({
+                        HAL_PIXEL_FORMAT_RGB_888,
+                        HAL_PIXEL_FORMAT_RGBA_8888,
+                        HAL_PIXEL_FORMAT_YCrCb_NV12
+                    })
+                })
+                .withSetter(Setter<decltype(*mScaledOutput)>::StrictValueWithNoDeps)
+                .build());
+
+        addParameter(
+                DefineParam(mErrorPolicy, C2_PARAMKEY_ERROR_POLICY)
+                .withDefault(new C2StreamErrorPolicyTuning::output(
+                        0u, C2_ERROR_POLICY_OUTPUT))
+                .withFields({C2F(mErrorPolicy, value).inRange(
+                        C2_ERROR_POLICY_OUTPUT, C2_ERROR_POLICY_HOLD)})
+                .withSetter(Setter<decltype(*mErrorPolicy)>::StrictValueWithNoDeps)
+                .build());
+
+        addParameter(
+                DefineParam(mCorruptedFrame, C2_PARAMKEY_CORRUPTED_FRAME)
+                .withDefault(new C2StreamCorruptedFrameInfo::output(0u, 0, 0))
+                .withFields({
+                    C2F(mCorruptedFrame, count).any(),
+                    C2F(mCorruptedFrame, timestampUs).any(),
+                })
+                .withSetter(Setter<decltype(*mCorruptedFrame)>::StrictValueWithNoDeps)
+                .build());
     }
 
     static C2R SizeSetter(bool mayBlock, const C2P<C2StreamPictureSizeInfo::output> &oldMe,
@@ -423,6 +546,109 @@ public:
         return C2R::Ok();
     }
 
+    static C2R LevelMaxInputSizeSetter(bool mayBlock, C2P<C2StreamMaxBufferSizeInfo::input> &me,
+                                       const C2P<C2StreamMaxPictureSizeTuning::output> &maxSize,
+                                       const C2P<C2StreamProfileLevelInfo::input> &profileLevel) {
+        (void)mayBlock;
+        // assume compression ratio of 2
+        size_t size = ((maxSize.v.width + 63) / 64) * ((maxSize.v.height + 63) / 64) * 3072;
+
+        // an access unit never holds a picture larger than the level allows
+        size_t levelLumaPs = GetLevelMaxLumaPs(profileLevel.v.level);
+        if (levelLumaPs > 0) {
+            size = c2_min(size, levelLumaPs * 3 / 4);
+        }
+
+        me.set().value = c2_max(size, kMinInputBufferSize);
+        return C2R::Ok();
+    }
+
+    /* max luma samples of a picture for the level, 0 if not known */
+    static size_t GetLevelMaxLumaPs(C2Config::level_t level) {
+        switch (level) {
+        /* MaxFS is in macroblocks */
+        case C2Config::LEVEL_AVC_1:
+        case C2Config::LEVEL_AVC_1B:        return 99 * 256;
+        case C2Config::LEVEL_AVC_1_1:
+        case C2Config::LEVEL_AVC_1_2:
+        case C2Config::LEVEL_AVC_1_3:
+        case C2Config::LEVEL_AVC_2:         return 396 * 256;
+        case C2Config::LEVEL_AVC_2_1:       return 792 * 256;
+        case C2Config::LEVEL_AVC_2_2:
+        case C2Config::LEVEL_AVC_3:         return 1620 * 256;
+        case C2Config::LEVEL_AVC_3_1:       return 3600 * 256;
+        case C2Config::LEVEL_AVC_3_2:       return 5120 * 256;
+        case C2Config::LEVEL_AVC_4:
+        case C2Config::LEVEL_AVC_4_1:       return 8192 * 256;
+        case C2Config::LEVEL_AVC_4_2:       return 8704 * 256;
+        case C2Config::LEVEL_AVC_5:         return 22080 * 256;
+        case C2Config::LEVEL_AVC_5_1:
+        case C2Config::LEVEL_AVC_5_2:       return 36864 * 256;
+        case C2Config::LEVEL_AVC_6:
+        case C2Config::LEVEL_AVC_6_1:
+        case C2Config::LEVEL_AVC_6_2:       return 139264 * 256;
+
+        case C2Config::LEVEL_HEVC_MAIN_1:   return 36864;
+        case C2Config::LEVEL_HEVC_MAIN_2:   return 122880;
+        case C2Config::LEVEL_HEVC_MAIN_2_1: return 245760;
+        case C2Config::LEVEL_HEVC_MAIN_3:   return 552960;
+        case C2Config::LEVEL_HEVC_MAIN_3_1: return 983040;
+        case C2Config::LEVEL_HEVC_MAIN_4:
+        case C2Config::LEVEL_HEVC_MAIN_4_1:
+        case C2Config::LEVEL_HEVC_HIGH_4:
+        case C2Config::LEVEL_HEVC_HIGH_4_1: return 2228224;
+        case C2Config::LEVEL_HEVC_MAIN_5:
+        case C2Config::LEVEL_HEVC_MAIN_5_1:
+        case C2Config::LEVEL_HEVC_MAIN_5_2:
+        case C2Config::LEVEL_HEVC_HIGH_5:
+        case C2Config::LEVEL_HEVC_HIGH_5_1:
+        case C2Config::LEVEL_HEVC_HIGH_5_2: return 8912896;
+        case C2Config::LEVEL_HEVC_MAIN_6:
+        case C2Config::LEVEL_HEVC_MAIN_6_1:
+        case C2Config::LEVEL_HEVC_MAIN_6_2:
+        case C2Config::LEVEL_HEVC_HIGH_6:
+        case C2Config::LEVEL_HEVC_HIGH_6_1:
+        case C2Config::LEVEL_HEVC_HIGH_6_2: return 35651584;
+
+        case C2Config::LEVEL_VP9_1:         return 36864;
+        case C2Config::LEVEL_VP9_1_1:       return 73728;
+        case C2Config::LEVEL_VP9_2:         return 122880;
+        case C2Config::LEVEL_VP9_2_1:       return 245760;
+        case C2Config::LEVEL_VP9_3:         return 552960;
+        case C2Config::LEVEL_VP9_3_1:       return 983040;
+        case C2Config::LEVEL_VP9_4:
+        case C2Config::LEVEL_VP9_4_1:       return 2228224;
+        case C2Config::LEVEL_VP9_5:
+        case C2Config::LEVEL_VP9_5_1:
+        case C2Config::LEVEL_VP9_5_2:       return 8912896;
+        case C2Config::LEVEL_VP9_6:
+        case C2Config::LEVEL_VP9_6_1:
+        case C2Config::LEVEL_VP9_6_2:       return 35651584;
+
+        case C2Config::LEVEL_AV1_2:         return 147456;
+        case C2Config::LEVEL_AV1_2_1:       return 278784;
+        case C2Config::LEVEL_AV1_3:         return 665856;
+        case C2Config::LEVEL_AV1_3_1:       return 1065024;
+        case C2Config::LEVEL_AV1_4:
+        case C2Config::LEVEL_AV1_4_1:       return 2359296;
+        case C2Config::LEVEL_AV1_5:
+        case C2Config::LEVEL_AV1_5_1:
+        case C2Config::LEVEL_AV1_5_2:
+        case C2Config::LEVEL_AV1_5_3:       return 8912896;
+        case C2Config::LEVEL_AV1_6:
+        case C2Config::LEVEL_AV1_6_1:
+        case C2Config::LEVEL_AV1_6_2:
+        case C2Config::LEVEL_AV1_6_3:       return 35651584;
+
+        case C2Config::LEVEL_MP2V_LOW:      return 352 * 288;
+        case C2Config::LEVEL_MP2V_MAIN:     return 720 * 576;
+        case C2Config::LEVEL_MP2V_HIGH_1440:return 1440 * 1152;
+        case C2Config::LEVEL_MP2V_HIGH:     return 1920 * 1152;
+
+        default:                            return 0;
+        }
+    }
+
 
     static C2R DefaultColorAspectsSetter(bool mayBlock, C2P<C2StreamColorAspectsTuning::output> &me) {
         (void)mayBlock;
@@ -488,6 +714,34 @@ public:
         return mLowLatency;
     }
 
+    std::shared_ptr<C2StreamKeyFrameOnlyTuning::input> getKeyFrameOnly_l() {
+        return mKeyFrameOnly;
+    }
+
+    std::shared_ptr<C2StreamRenderClockTuning::output> getRenderClock_l() {
+        return mRenderClock;
+    }
+
+    std::shared_ptr<C2StreamPixelFormatInfo::output> getPixelFormat_l() {
+        return mPixelFormat;
+    }
+
+    std::shared_ptr<C2StreamScaledOutputTuning::output> getScaledOutput_l() {
+        return mScaledOutput;
+    }
+
+    std::shared_ptr<C2StreamErrorPolicyTuning::output> getErrorPolicy_l() {
+        return mErrorPolicy;
+    }
+
+    std::shared_ptr<C2StreamMaxBufferSizeInfo::input> getMaxInputSize_l() {
+        return mMaxInputSize;
+    }
+
+    std::shared_ptr<C2StreamProfileLevelInfo::input> getProfileLevel_l() {
+        return mProfileLevel;
+    }
+
 private:
     std::shared_ptr<C2StreamPictureSizeInfo::output> mSize;
     std::shared_ptr<C2StreamMaxPictureSizeTuning::output> mMaxSize;
@@ -500,6 +754,12 @@ private:
     std::shared_ptr<C2StreamColorAspectsInfo::input> mCodedColorAspects;
     std::shared_ptr<C2StreamColorAspectsInfo::output> mColorAspects;
     std::shared_ptr<C2GlobalLowLatencyModeTuning> mLowLatency;
+    std::shared_ptr<C2StreamKeyFrameOnlyTuning::input> mKeyFrameOnly;
+    std::shared_ptr<C2StreamRenderClockTuning::output> mRenderClock;
+    std::shared_ptr<C2StreamDropStatsInfo::output> mDropStats;
+    std::shared_ptr<C2StreamScaledOutputTuning::output> mScaledOutput;
+    std::shared_ptr<C2StreamErrorPolicyTuning::output> mErrorPolicy;
+    std::shared_ptr<C2StreamCorruptedFrameInfo::output> mCorruptedFrame;
 };
 
 C2RKMpiDec::C2RKMpiDec(
@@ -513,6 +773,7 @@ C2RKMpiDec::C2RKMpiDec(
       mCodingType(MPP_VIDEO_CodingUnused),
       mColorFormat(MPP_FMT_YUV420SP),
       mFrmGrp(nullptr),
+      mBufferType(C2RKChipCapDef::getImportBufferType()),
       mWidth(0),
       mHeight(0),
       mHorStride(0),
@@ -528,11 +789,48 @@ C2RKMpiDec::C2RKMpiDec(
       mSignalledInputEos(false),
       mSignalledError(false),
       mLowLatencyMode(false),
+      mKeyFrameOnly(false),
       mBufferMode(false),
+      mOutputFormat(HAL_PIXEL_FORMAT_YCBCR_420_888),
+      mOutBlockFormat(0),
+      mReportedFormat(HAL_PIXEL_FORMAT_YCBCR_420_888),
       mOutFile(nullptr),
-      mInFile(nullptr) {
+      mInFile(nullptr),
+      mTraceMpiBuffers(name, id, "mpp-buffers"),
+      mTraceC2Buffers(name, id, "c2-buffers"),
+      mSkippedDecode(0),
+      mDroppedOutput(0),
+      mDropStatsPending(false),
+      mMaxTemporalId(-1),
+      mScaleQueue(nullptr),
+      mErrorPolicy(C2_ERROR_POLICY_OUTPUT),
+      mWaitSync(false),
+      mLastSyncPts(-1),
+      mRecoverPts(-1),
+      mCorruptedCount(0),
+      mCorruptedPts(0),
+      mCorruptedPending(false),
+      mInGrp(nullptr),
+      mInImported(0),
+      mAdaptiveInput(false),
+      mMaxInputSize(0),
+      mInitInputSize(0),
+      mLevel(C2Config::LEVEL_UNUSED),
+      mStreamRefCount(-1),
+      mMppDpbCount(0),
+      mOutBufferCount(kMaxReferenceCount),
+      mOutDelayChanged(false),
+      mRateStartPts(0),
+      mRateFrames(0),
+      mFrameRate(0),
+      mSharedPool(false),
+      mPoolCount(0),
+      mFrameBufSize(0) {
     c2_info("version: %s", C2_GIT_BUILD_VERSION);
 
+    memset(&mRenderClock, 0, sizeof(mRenderClock));
+    memset(&mScaledOutput, 0, sizeof(mScaledOutput));
+
     if (!C2RKMediaUtils::getCodingTypeFromComponentName(name, &mCodingType)) {
         c2_err("failed to get codingType from component %s", name);
     }
@@ -554,12 +852,7 @@ C2RKMpiDec::C2RKMpiDec(
         memset(fileName, 0, 128);
 
         sprintf(fileName, "/data/video/dec_out_%ld.bin", syscall(SYS_gettid));
-        mOutFile = fopen(fileName, "wb");
-        if (mOutFile == nullptr) {
-            c2_err("failed to open output file, err %s", strerror(errno));
-        } else {
-            c2_info("recording output to %s", fileName);
-        }
+        mOutFile = C2RKDump::open(fileName);
     }
 
     if (c2_vdec_debug & VIDEO_DBG_RECORD_IN) {
@@ -567,12 +860,7 @@ C2RKMpiDec::C2RKMpiDec(
         memset(fileName, 0, 128);
 
         sprintf(fileName, "/data/video/dec_in_%ld.bin", syscall(SYS_gettid));
-        mInFile = fopen(fileName, "wb");
-        if (mInFile == nullptr) {
-            c2_err("failed to open output file, err %s", strerror(errno));
-        } else {
-            c2_info("recording output to %s", fileName);
-        }
+        mInFile = C2RKDump::open(fileName);
     }
 }
 
@@ -583,11 +871,20 @@ C2RKMpiDec::~C2RKMpiDec() {
 
 c2_status_t C2RKMpiDec::onInit() {
     c2_info_f("in");
+    C2RKMppCtxPool::get()->prepare(MPP_CTX_DEC, mCodingType);
     return C2_OK;
 }
 
 c2_status_t C2RKMpiDec::onStop() {
     c2_info_f("in");
+    if (mSkippedDecode || mDroppedOutput) {
+        c2_info("late frames: %u not decoded, %u not output",
+                mSkippedDecode, mDroppedOutput);
+    }
+    /* the next start may bring another stream */
+    mRateFrames = 0;
+    mFrameRate = 0;
+
     if (!mFlushed) {
         return onFlush_sm();
     }
@@ -609,6 +906,12 @@ void C2RKMpiDec::onRelease() {
         onFlush_sm();
     }
 
+    if (mScaleQueue != nullptr) {
+        delete mScaleQueue;
+        mScaleQueue = nullptr;
+    }
+    mScaledPool.reset();
+
     if (mOutBlock) {
         mOutBlock.reset();
     }
@@ -619,30 +922,69 @@ void C2RKMpiDec::onRelease() {
     }
 
     if (mMppCtx) {
-        mpp_destroy(mMppCtx);
+        C2RKMppCtxPool::get()->put(mMppCtx);
         mMppCtx = nullptr;
     }
 
+    C2RKMemoryBudget::get()->detach(this);
+
+    /* mpp and its group are gone, the pool buffers are free again */
+    C2RKFramePool::get()->unreserve(this);
+    mPoolCount = 0;
+
+    /* mpp is gone, nothing reads the inputs any more */
+    mInWorks.clear();
+    if (mInGrp != nullptr) {
+        mpp_buffer_group_put(mInGrp);
+        mInGrp = nullptr;
+    }
+    mInImported = 0;
+
     if (mOutFile != nullptr) {
-        fclose(mOutFile);
+        delete mOutFile;
         mOutFile = nullptr;
     }
     if (mInFile != nullptr) {
-        fclose(mInFile);
+        delete mInFile;
         mInFile = nullptr;
     }
 }
 
+bool C2RKMpiDec::getCapacityRequest(C2CapacityRequest *request) {
+    IntfImpl::Lock lock = mIntf->lock();
+
+    request->type = MPP_CTX_DEC;
+    request->codingType = mCodingType;
+    /* the stream size once info-change configured it */
+    request->width = mIntf->getSize_l()->width;
+    request->height = mIntf->getSize_l()->height;
+    /* 0 until estimated from the input timestamps */
+    request->frameRate = mFrameRate;
+
+    return true;
+}
+
 c2_status_t C2RKMpiDec::onFlush_sm() {
     c2_status_t ret = C2_OK;
 
     c2_info_f("in");
 
+    /* let scaled outputs in flight reach the client before the flush */
+    if (mScaleQueue != nullptr) {
+        mScaleQueue->waitIdle();
+    }
+
+    /* a seek breaks the timestamp span of a running estimate */
+    mRateFrames = 0;
     mOutputEos = false;
     mSignalledInputEos = false;
     mSignalledError = false;
     mGeneration = 0;
 
+    mWaitSync = false;
+    mLastSyncPts = -1;
+    mRecoverPts = -1;
+
     clearOutBuffers();
 
     if (mFrmGrp) {
@@ -653,6 +995,16 @@ c2_status_t C2RKMpiDec::onFlush_sm() {
         mMppMpi->reset(mMppCtx);
     }
 
+    /* only once the dpb is gone, other decoders may take them right away */
+    releasePoolBuffers();
+
+    /* the pending input works are handed back by the flush itself */
+    mInWorks.clear();
+    if (mInGrp) {
+        mpp_buffer_group_clear(mInGrp);
+        mInImported = 0;
+    }
+
     mFlushed = true;
 
     return ret;
@@ -660,6 +1012,7 @@ c2_status_t C2RKMpiDec::onFlush_sm() {
 
 c2_status_t C2RKMpiDec::initDecoder() {
     MPP_RET err = MPP_OK;
+    int64_t initUs = ALooper::GetNowUs();
 
     c2_info_f("in");
 
@@ -671,37 +1024,40 @@ c2_status_t C2RKMpiDec::initDecoder() {
         if (mIntf->getLowLatency_l() != nullptr) {
             mLowLatencyMode = (mIntf->getLowLatency_l()->value > 0) ? true : false ;
         }
+        mKeyFrameOnly = (mIntf->getKeyFrameOnly_l()->value > 0);
+        mOutputFormat = mIntf->getPixelFormat_l()->value;
+        mReportedFormat = mOutputFormat;
+        mErrorPolicy = (uint32_t)mIntf->getErrorPolicy_l()->value;
+        mInitInputSize = mIntf->getMaxInputSize_l()->value;
+        if (mIntf->getProfileLevel_l() != nullptr) {
+            mLevel = (uint32_t)mIntf->getProfileLevel_l()->level;
+        }
     }
 
-    c2_info("init: w %d h %d coding %d", mWidth, mHeight, mCodingType);
+    mMaxTemporalId = -1;
+    mStreamRefCount = -1;
+    mRateFrames = 0;
+    mFrameRate = 0;
 
-    err = mpp_create(&mMppCtx, &mMppMpi);
-    if (err != MPP_OK) {
-        c2_err("failed to mpp_create, ret %d", err);
-        goto error;
-    }
+    C2RKMemoryBudget::get()->attach(this);
 
-    // TODO: workround: CTS-CodecDecoderTest
-    // testFlushNative[15(c2.rk.mpeg2.decoder_video/mpeg2)
-    if (mCodingType == MPP_VIDEO_CodingMPEG2) {
-        uint32_t vmode = 0, split = 1;
-        mMppMpi->control(mMppCtx, MPP_DEC_SET_ENABLE_DEINTERLACE, &vmode);
-        mMppMpi->control(mMppCtx, MPP_DEC_SET_PARSER_SPLIT_MODE, &split);
-    } else {
-        // enable deinterlace, but not decting
-        uint32_t vmode = 1;
-        mMppMpi->control(mMppCtx, MPP_DEC_SET_ENABLE_DEINTERLACE, &vmode);
+    {
+        C2_U32 adaptive = 1;
+        Rockchip_C2_GetEnvU32("vendor.c2.dec.input.adaptive", &adaptive, 1);
+        mAdaptiveInput = (adaptive != 0);
+        mMaxInputSize = mInitInputSize;
+        mInputStats.reset();
     }
 
-    {
-        // enable fast mode,
-        uint32_t fastParser = 1;
-        mMppMpi->control(mMppCtx, MPP_DEC_SET_PARSER_FAST_MODE, &fastParser);
+    c2_info("init: w %d h %d coding %d", mWidth, mHeight, mCodingType);
+
+    if (mBufferMode && mOutputFormat != HAL_PIXEL_FORMAT_YCBCR_420_888) {
+        c2_info("init: buffer mode output fmt 0x%x", mOutputFormat);
     }
 
-    err = mpp_init(mMppCtx, MPP_CTX_DEC, mCodingType);
+    err = C2RKMppCtxPool::get()->take(MPP_CTX_DEC, mCodingType, &mMppCtx, &mMppMpi);
     if (err != MPP_OK) {
-        c2_err("failed to mpp_init, ret %d", err);
+        c2_err("failed to get mpp context, ret %d", err);
         goto error;
     }
 
@@ -716,6 +1072,20 @@ c2_status_t C2RKMpiDec::initDecoder() {
             mMppMpi->control(mMppCtx, MPP_DEC_SET_ENABLE_DEINTERLACE, &deinterlace);
             mMppMpi->control(mMppCtx, MPP_DEC_SET_IMMEDIATE_OUT, &immediate);
         }
+
+        if (mKeyFrameOnly) {
+            // nothing to reorder without inter frames
+            uint32_t immediate = 1;
+            c2_info("enable keyframe-only, enable mpp immediate-out mode");
+            mMppMpi->control(mMppCtx, MPP_DEC_SET_IMMEDIATE_OUT, &immediate);
+        }
+
+        if (mErrorPolicy != C2_ERROR_POLICY_OUTPUT) {
+            // the policy lives on mpp error marking, make sure it is not off
+            uint32_t disableError = 0;
+            c2_info("enable error policy %d", mErrorPolicy);
+            mMppMpi->control(mMppCtx, MPP_DEC_SET_DISABLE_ERROR, &disableError);
+        }
     }
 
     {
@@ -765,10 +1135,13 @@ c2_status_t C2RKMpiDec::initDecoder() {
     /*
      * For buffer mode, since we don't konw when the last buffer will use
      * up by user, so we use MPP internal buffer group, and copy output to
-     * dst block(mOutBlock).
+     * dst block(mOutBlock). With frame sharing on, the group is fed from
+     * C2RKFramePool once mpp reported the frame size.
      */
-    if (!mBufferMode) {
-        err = mpp_buffer_group_get_external(&mFrmGrp, MPP_BUFFER_TYPE_ION);
+    mSharedPool = mBufferMode && C2RKFramePool::get()->isEnabled();
+    mFrameBufSize = 0;
+    if (!mBufferMode || mSharedPool) {
+        err = mpp_buffer_group_get_external(&mFrmGrp, mBufferType);
         if (err != MPP_OK) {
             c2_err_f("failed to get buffer_group, err %d", err);
             goto error;
@@ -776,6 +1149,19 @@ c2_status_t C2RKMpiDec::initDecoder() {
         mMppMpi->control(mMppCtx, MPP_DEC_SET_EXT_BUF_GROUP, mFrmGrp);
     }
 
+    {
+        C2_U32 zeroCopy = 0;
+        Rockchip_C2_GetEnvU32("vendor.c2.dec.input.zerocopy", &zeroCopy, 0);
+        if (zeroCopy && !mInGrp) {
+            if (mpp_buffer_group_get_external(&mInGrp, mBufferType) == MPP_OK) {
+                c2_info("init: zero-copy input");
+            } else {
+                c2_warn("failed to get input buffer group, copy input");
+                mInGrp = nullptr;
+            }
+        }
+    }
+
     /* fbc decode output has padding inside, set crop before display */
     if (mFbcCfg.mode) {
         C2RKFbcDef::getFbcOutputOffset(mCodingType,
@@ -786,11 +1172,13 @@ c2_status_t C2RKMpiDec::initDecoder() {
 
     mStarted = true;
 
+    c2_info("init: done in %lld us", (long long)(ALooper::GetNowUs() - initUs));
+
     return C2_OK;
 
 error:
     if (mMppCtx) {
-        mpp_destroy(mMppCtx);
+        C2RKMppCtxPool::get()->put(mMppCtx);
         mMppCtx = nullptr;
     }
 
@@ -811,6 +1199,12 @@ void C2RKMpiDec::fillEmptyWork(const std::unique_ptr<C2Work> &work) {
     work->worklets.front()->output.buffers.clear();
     work->worklets.front()->output.ordinal = work->input.ordinal;
     work->workletsProcessed = 1u;
+
+    if (mCorruptedPending) {
+        C2StreamCorruptedFrameInfo::output corrupted(0u, mCorruptedCount, mCorruptedPts);
+        work->worklets.front()->output.configUpdate.push_back(C2Param::Copy(corrupted));
+        mCorruptedPending = false;
+    }
 }
 
 void C2RKMpiDec::finishWork(OutWorkEntry *entry) {
@@ -819,6 +1213,8 @@ void C2RKMpiDec::finishWork(OutWorkEntry *entry) {
         return;
     }
 
+    c2_trace_stage_pts("finishWork", entry->timestamp);
+
     uint32_t left = mFbcCfg.mode ? mFbcCfg.paddingX : 0;
     uint32_t top  = mFbcCfg.mode ? mFbcCfg.paddingY : 0;
 
@@ -837,14 +1233,30 @@ void C2RKMpiDec::finishWork(OutWorkEntry *entry) {
         }
     }
 
-    auto fillWork = [buffer, entry](const std::unique_ptr<C2Work> &work) {
+    /* once scaling started every frame goes through the queue, in order */
+    if (mScaleQueue != nullptr) {
+        postScaleJob(buffer, entry->timestamp);
+        return;
+    }
+
+    sendOutputWork(buffer, nullptr, entry->timestamp);
+}
+
+void C2RKMpiDec::sendOutputWork(
+        const std::shared_ptr<C2Buffer> &buffer,
+        const std::shared_ptr<C2Buffer> &scaled,
+        uint64_t timestamp) {
+    auto fillWork = [buffer, scaled, timestamp](const std::unique_ptr<C2Work> &work) {
         // now output work is new work, frame index remove by input work,
         // output work set to incomplete to ignore frame index check
         work->worklets.front()->output.flags = C2FrameData::FLAG_INCOMPLETE;
         work->worklets.front()->output.buffers.clear();
         work->worklets.front()->output.buffers.push_back(buffer);
+        if (scaled) {
+            work->worklets.front()->output.buffers.push_back(scaled);
+        }
         work->worklets.front()->output.ordinal = work->input.ordinal;
-        work->worklets.front()->output.ordinal.timestamp = entry->timestamp;
+        work->worklets.front()->output.ordinal.timestamp = timestamp;
         work->workletsProcessed = 1u;
     };
 
@@ -857,6 +1269,99 @@ void C2RKMpiDec::finishWork(OutWorkEntry *entry) {
     finish(outputWork, fillWork);
 }
 
+void C2RKMpiDec::updateScaledOutput() {
+    {
+        IntfImpl::Lock lock = mIntf->lock();
+        std::shared_ptr<C2StreamScaledOutputTuning::output> scaled
+                = mIntf->getScaledOutput_l();
+
+        mScaledOutput.width = scaled->width;
+        mScaledOutput.height = scaled->height;
+        mScaledOutput.format = scaled->format;
+    }
+
+    if (mScaledOutput.width <= 0 || mScaledOutput.height <= 0 || mScaleQueue) {
+        return;
+    }
+
+    c2_status_t err = GetCodec2BlockPool(
+            C2BlockPool::BASIC_LINEAR, shared_from_this(), &mScaledPool);
+    if (err != C2_OK || !mScaledPool) {
+        c2_err("failed to get linear pool for scaled output, err %d", err);
+        mScaledOutput.width = 0;
+        return;
+    }
+
+    mScaleQueue = new C2RKJobQueue("c2_rk_scaler", kMaxScaleJobs);
+    c2_info("scaled output %dx%d fmt 0x%x", mScaledOutput.width,
+            mScaledOutput.height, mScaledOutput.format);
+}
+
+void C2RKMpiDec::postScaleJob(const std::shared_ptr<C2Buffer> &buffer, uint64_t timestamp) {
+    /* rga reads plain 8bit semi-planar only */
+    if (mScaledOutput.width <= 0 || mScaledOutput.height <= 0 ||
+        mFbcCfg.mode || (mColorFormat & MPP_FRAME_FMT_MASK) != MPP_FMT_YUV420SP) {
+        c2_trace("no scaled output, fmt 0x%x", mColorFormat);
+        mScaleQueue->post([this, buffer, timestamp]() {
+            sendOutputWork(buffer, nullptr, timestamp);
+        });
+        return;
+    }
+
+    const C2Handle *c2Handle = buffer->data().graphicBlocks().front().handle();
+    int32_t srcFormat = HAL_PIXEL_FORMAT_YCrCb_NV12;
+    RgaParam src, dst;
+    size_t dstSize = 0;
+
+    C2RKRgaDef::paramInit(&src, c2Handle->data[0], mWidth, mHeight, mHorStride, mVerStride);
+    if (isRgbOutput()) {
+        uint32_t bqSlot, blockW, blockH, blockFmt, blockStride, generation;
+        uint64_t usage, bqId;
+
+        android::_UnwrapNativeCodec2GrallocMetadata(
+                c2Handle, &blockW, &blockH, &blockFmt, &usage,
+                &blockStride, &generation, &bqId, &bqSlot);
+        C2RKRgaDef::paramInit(&src, c2Handle->data[0], mWidth, mHeight, blockStride, blockH);
+        srcFormat = mOutputFormat;
+    }
+    C2RKRgaDef::paramInit(&dst, -1, mScaledOutput.width, mScaledOutput.height);
+
+    switch (mScaledOutput.format) {
+    case HAL_PIXEL_FORMAT_RGB_888:   dstSize = dst.width * dst.height * 3;     break;
+    case HAL_PIXEL_FORMAT_RGBA_8888: dstSize = dst.width * dst.height * 4;     break;
+    default:                         dstSize = dst.width * dst.height * 3 / 2; break;
+    }
+
+    int32_t dstFormat = mScaledOutput.format;
+    std::shared_ptr<C2BlockPool> pool = mScaledPool;
+
+    /* |buffer| keeps the display block, and so the rga source, alive */
+    mScaleQueue->post([this, buffer, timestamp, src, srcFormat, dst, dstSize, dstFormat, pool]() {
+        std::shared_ptr<C2LinearBlock> block;
+        std::shared_ptr<C2Buffer> scaled;
+        RgaParam dstParam = dst;
+
+        C2MemoryUsage usage = { C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE };
+        c2_status_t err = pool->fetchLinearBlock(dstSize, usage, &block);
+        if (err != C2_OK || !block) {
+            c2_err("failed to fetch scaled block, size %zu err %d", dstSize, err);
+            goto done;
+        }
+
+        dstParam.fd = block->handle()->data[0];
+        if (!C2RKRgaDef::blit(src, srcFormat, dstParam, dstFormat)) {
+            c2_err("failed to scale output, pts %lld", (long long)timestamp);
+            goto done;
+        }
+
+        scaled = createLinearBuffer(block, 0, dstSize);
+
+    done:
+        /* the display buffer goes out either way */
+        sendOutputWork(buffer, scaled, timestamp);
+    });
+}
+
 c2_status_t C2RKMpiDec::drainInternal(
         uint32_t drainMode,
         const std::shared_ptr<C2BlockPool> &pool,
@@ -894,7 +1399,13 @@ c2_status_t C2RKMpiDec::drainInternal(
             break;
         }
 
+        releaseInputWorks(mOutputEos);
+
         if (mOutputEos && work) {
+            /* eos goes out behind the last scaled output */
+            if (mScaleQueue != nullptr) {
+                mScaleQueue->waitIdle();
+            }
             fillEmptyWork(work);
             break;
         }
@@ -931,6 +1442,11 @@ void C2RKMpiDec::process(
     mFlushed = false;
     mBufferMode = (pool->getLocalId() <= C2BlockPool::PLATFORM_START);
 
+    updateRenderClock();
+    /* output drops of the previous call, reported once per call */
+    updateDropStats();
+    updateScaledOutput();
+
     // Initialize decoder if not already initialized
     if (!mStarted) {
         err = initDecoder();
@@ -939,6 +1455,15 @@ void C2RKMpiDec::process(
             c2_info("failed to initialize, signalled Error");
             return;
         }
+
+        if (mKeyFrameOnly) {
+            C2PortActualDelayTuning::output delay(kKeyFrameOnlyOutputDelay);
+            std::vector<std::unique_ptr<C2SettingResult>> failures;
+            if (mIntf->config({&delay}, C2_MAY_BLOCK, &failures) == C2_OK) {
+                work->worklets.front()->output.configUpdate.push_back(
+                        C2Param::Copy(delay));
+            }
+        }
     }
 
     if (mSignalledInputEos || mSignalledError) {
@@ -968,11 +1493,82 @@ void C2RKMpiDec::process(
              inSize, timestamp, frameIndex, flags);
 
     bool eos = ((flags & C2FrameData::FLAG_END_OF_STREAM) != 0);
+
+    /* parse the access unit once, only for the users that need it */
+    bool sync = true;
+    if (inSize > 0 && !(flags & C2FrameData::FLAG_CODEC_CONFIG) &&
+        (mAdaptiveInput || mKeyFrameOnly || mErrorPolicy == C2_ERROR_POLICY_HOLD)) {
+        sync = C2RKBitstream::isSyncFrame(mCodingType, inData, inSize);
+    }
+
+    if (mAdaptiveInput && inSize > 0 && !(flags & C2FrameData::FLAG_CODEC_CONFIG)) {
+        updateInputSize(work, inSize, sync);
+    }
+
+    if (mKeyFrameOnly && inSize > 0 &&
+        !(flags & C2FrameData::FLAG_CODEC_CONFIG) && !sync) {
+        c2_trace("keyframe-only: drop frame, pts %lld", timestamp);
+        if (!eos) {
+            fillEmptyWork(work);
+            return;
+        }
+        /* still signal eos, without the payload */
+        inData = nullptr;
+        inSize = 0;
+    }
+
+    if (mErrorPolicy == C2_ERROR_POLICY_HOLD && inSize > 0 &&
+        !(flags & C2FrameData::FLAG_CODEC_CONFIG) && sync) {
+        mLastSyncPts = timestamp;
+        if (mWaitSync && mRecoverPts < 0) {
+            mRecoverPts = timestamp;
+        }
+    }
+
+    if (mFrameRate == 0 && !eos && inSize > 0 && !(flags & C2FrameData::FLAG_CODEC_CONFIG)) {
+        updateFrameRate(timestamp);
+    }
+
+    /* hevc sub-layers, csd usually carries the sps, late frames may too */
+    if (mCodingType == MPP_VIDEO_CodingHEVC && inSize > 0 &&
+        ((flags & C2FrameData::FLAG_CODEC_CONFIG) || (!eos && isLate(timestamp)))) {
+        int32_t maxTemporalId = C2RKBitstream::getMaxTemporalId(mCodingType, inData, inSize);
+        if (maxTemporalId >= 0) {
+            mMaxTemporalId = maxTemporalId;
+        }
+    }
+
+    /* the dpb the stream declares, parameter sets lead the access unit */
+    if ((mCodingType == MPP_VIDEO_CodingAVC || mCodingType == MPP_VIDEO_CodingHEVC) &&
+        inSize > 0) {
+        int32_t refCount = C2RKBitstream::getRefFrameCount(mCodingType, inData, inSize);
+        if (refCount >= 0 && refCount != mStreamRefCount) {
+            c2_info("stream keeps %d reference frames", refCount);
+            mStreamRefCount = refCount;
+        }
+    }
+
+    /* nothing depends on a late non-reference frame, do not decode it */
+    if (!eos && inSize > 0 && isLate(timestamp) &&
+        !(flags & C2FrameData::FLAG_CODEC_CONFIG) &&
+        C2RKBitstream::isNonRefFrame(mCodingType, inData, inSize, mMaxTemporalId)) {
+        c2_trace("skip decoding late frame, pts %lld", timestamp);
+        mSkippedDecode++;
+        mDropStatsPending = true;
+        updateDropStats();
+        fillEmptyWork(work);
+        return;
+    }
+
     bool hasPicture = false;
     bool needGetFrame = false;
     bool sendPacketFlag = true;
     uint32_t outfrmCnt = 0;
     OutWorkEntry entry;
+    MppBuffer inBuffer = nullptr;
+    size_t inOffset = 0;
+
+    releaseInputWorks(false);
 
     err = ensureDecoderState(pool);
     if (err != C2_OK) {
@@ -982,17 +1578,46 @@ void C2RKMpiDec::process(
         return;
     }
 
+    if (mOutDelayChanged && !mBufferMode) {
+        C2PortActualDelayTuning::output delay(mOutBufferCount);
+        std::vector<std::unique_ptr<C2SettingResult>> failures;
+        if (mIntf->config({&delay}, C2_MAY_BLOCK, &failures) == C2_OK) {
+            work->worklets.front()->output.configUpdate.push_back(
+                    C2Param::Copy(delay));
+        }
+        mOutDelayChanged = false;
+    }
+
+    if (!eos && inSize > 0 && !(flags & C2FrameData::FLAG_CODEC_CONFIG)) {
+        inBuffer = importInputBuffer(work, &inOffset);
+    }
+
 inPacket:
     needGetFrame   = false;
     sendPacketFlag = true;
     // may block, quit util enqueue success.
-    err = sendpacket(inData, inSize, timestamp, flags);
+    {
+        c2_trace_stage("sendpacket", frameIndex, timestamp);
+        err = sendpacket(inData, inSize, timestamp, flags, inBuffer, inOffset);
+    }
     if (err != C2_OK) {
         c2_warn("failed to enqueue packet, pts %lld", timestamp);
+        checkOutBufferStarved();
         needGetFrame = true;
         sendPacketFlag = false;
     } else {
-        if (!eos) {
+        if (inBuffer) {
+            /* mpp reads the block in place, finish the work once it is done */
+            InWork inWork;
+            inWork.frameIndex = frameIndex;
+            inWork.buffer = work->input.buffers[0];
+            mInWorks.push_back(inWork);
+
+            mpp_buffer_put(inBuffer);
+            inBuffer = nullptr;
+
+            releaseInputWorks(false);
+        } else if (!eos) {
             fillEmptyWork(work);
         }
 
@@ -1011,6 +1636,9 @@ outframe:
             needGetFrame = false;
             hasPicture = true;
         } else if (err == C2_CORRUPTED) {
+            if (inBuffer) {
+                mpp_buffer_put(inBuffer);
+            }
             mSignalledError = true;
             work->workletsProcessed = 1u;
             work->result = C2_CORRUPTED;
@@ -1040,6 +1668,8 @@ outframe:
         if (err == OK) {
             work->worklets.front()->output.configUpdate.push_back(
                 C2Param::Copy(size));
+            /* start() reserved the configured size, move to the real one */
+            (void)updateCapacity();
         } else {
             c2_err("failed to set width and height");
             mSignalledError = true;
@@ -1048,6 +1678,23 @@ outframe:
             return;
         }
 
+        /*
+         * rga only converts 8bit nv12, anything else goes out as yuv. tell
+         * the client what it gets, the interface keeps its request for the
+         * next start.
+         */
+        if (mBufferMode) {
+            uint32_t outFormat = isRgbOutput() ? mOutputFormat
+                                               : HAL_PIXEL_FORMAT_YCBCR_420_888;
+            if (outFormat != mReportedFormat) {
+                c2_info("output format 0x%x -> 0x%x", mReportedFormat, outFormat);
+                C2StreamPixelFormatInfo::output pixelFormat(0u, outFormat);
+                work->worklets.front()->output.configUpdate.push_back(
+                        C2Param::Copy(pixelFormat));
+                mReportedFormat = outFormat;
+            }
+        }
+
         goto outframe;
     } else if (outfrmCnt == 0) {
         usleep(1000);
@@ -1101,18 +1748,25 @@ void C2RKMpiDec::getVuiParams(MppFrame frame) {
     }
 }
 
-c2_status_t C2RKMpiDec::sendpacket(uint8_t *data, size_t size, uint64_t pts, uint32_t flags) {
+c2_status_t C2RKMpiDec::sendpacket(
+        uint8_t *data, size_t size, uint64_t pts, uint32_t flags,
+        MppBuffer buffer, size_t offset) {
     c2_status_t ret = C2_OK;
     MppPacket packet = nullptr;
 
-    mpp_packet_init(&packet, data, size);
+    if (buffer) {
+        /* the packet takes its own reference, no copy into mpp */
+        mpp_packet_init_with_buffer(&packet, buffer);
+        mpp_packet_set_pos(packet, (uint8_t *)mpp_packet_get_data(packet) + offset);
+    } else {
+        mpp_packet_init(&packet, data, size);
+        mpp_packet_set_pos(packet, data);
+    }
     mpp_packet_set_pts(packet, pts);
-    mpp_packet_set_pos(packet, data);
     mpp_packet_set_length(packet, size);
 
     if (mInFile != nullptr) {
-        fwrite(data, 1, size, mInFile);
-        fflush(mInFile);
+        mInFile->write(data, size);
     }
 
     if (flags & C2FrameData::FLAG_END_OF_STREAM) {
@@ -1147,6 +1801,208 @@ c2_status_t C2RKMpiDec::sendpacket(uint8_t *data, size_t size, uint64_t pts, uin
     return ret;
 }
 
+MppBuffer C2RKMpiDec::importInputBuffer(const std::unique_ptr<C2Work> &work, size_t *offset) {
+    /* imported minus released, a slot frees as soon as its work finished */
+    if (mInGrp == nullptr || mInWorks.size() >= kMaxZeroCopyInputs ||
+        mInImported >= kMaxInputImports ||
+        work->input.buffers.empty() || !work->input.buffers[0]) {
+        return nullptr;
+    }
+
+    C2ConstLinearBlock block = work->input.buffers[0]->data().linearBlocks().front();
+    const C2Handle *c2Handle = block.handle();
+    if (c2Handle == nullptr || c2Handle->numFds < 1) {
+        /* not dma-buf backed, copy as usual */
+        return nullptr;
+    }
+
+    MppBuffer mppBuffer = nullptr;
+    MppBufferInfo info;
+    memset(&info, 0, sizeof(info));
+
+    info.type = mBufferType;
+    info.fd = c2Handle->data[0];
+    info.size = block.offset() + block.size();
+
+    MPP_RET err = mpp_buffer_import_with_tag(mInGrp, &info,
+                                             &mppBuffer, "codec2", __FUNCTION__);
+    if (err != MPP_OK || !mppBuffer) {
+        c2_warn("failed to import input fd %d, ret %d", info.fd, err);
+        return nullptr;
+    }
+
+    mInImported++;
+    *offset = block.offset();
+
+    return mppBuffer;
+}
+
+void C2RKMpiDec::releaseInputWorks(bool all) {
+    if (mInGrp == nullptr || mInImported == 0) {
+        return;
+    }
+
+    /*
+     * mpp consumes packets in order and an imported buffer turns unused
+     * once its packet is dropped, so the unused count tells how many of
+     * the oldest inputs are done.
+     */
+    uint32_t released = (uint32_t)mpp_buffer_group_unused(mInGrp);
+    uint32_t done = mInImported - (uint32_t)mInWorks.size();
+
+    while (!mInWorks.empty() && (all || done < released)) {
+        InWork inWork = mInWorks.front();
+        mInWorks.pop_front();
+        done++;
+
+        inWork.buffer.reset();
+        finish(inWork.frameIndex, [this](const std::unique_ptr<C2Work> &work) {
+            fillEmptyWork(work);
+        });
+    }
+
+    /* nothing tracked any more, a buffer still in use is freed on release */
+    if (mInWorks.empty()) {
+        mpp_buffer_group_clear(mInGrp);
+        mInImported = 0;
+    }
+}
+
+void C2RKMpiDec::updateInputSize(
+        const std::unique_ptr<C2Work> &work, size_t size, bool sync) {
+    size_t target = 0;
+
+    mInputStats.add(size, sync);
+
+    if (size > mMaxInputSize * 3 / 4) {
+        /* close to the limit, grow before a packet does not fit */
+        target = size * 2;
+    } else if (mInputStats.getCount() % kInputStatsInterval == 0 &&
+               mInputStats.getSyncCount() >= 2) {
+        /* largest packet plus headroom, p99 covers a burst of big ones */
+        target = c2_max(mInputStats.getMax() * 3 / 2,
+                        mInputStats.getPercentile(99) * 2);
+        if (target > mMaxInputSize * 3 / 4) {
+            return;
+        }
+    } else {
+        return;
+    }
+
+    target = C2_ALIGN(target, kInputSizeAlign);
+    target = c2_max(target, kMinAdaptiveInputSize);
+    target = c2_min(target, mInitInputSize);
+
+    if (target == mMaxInputSize) {
+        return;
+    }
+
+    c2_info("input size %zu -> %zu, max packet %zu p99 %zu",
+            mMaxInputSize, target, mInputStats.getMax(),
+            mInputStats.getPercentile(99));
+
+    mMaxInputSize = target;
+
+    /*
+     * the interface param is calculated from the max picture size and
+     * level and stays the upper bound, a config here would be overridden
+     * by its setter. the runtime size only reaches the framework through
+     * the work, so queries keep returning the initial size.
+     */
+    C2StreamMaxBufferSizeInfo::input maxSize(0u, target);
+    work->worklets.front()->output.configUpdate.push_back(C2Param::Copy(maxSize));
+}
+
+/*
+ * frame rate over the first kFrameRateWindow inputs, in decode order which
+ * spans about the same time. reserves the real load once it is known.
+ */
+void C2RKMpiDec::updateFrameRate(int64_t pts) {
+    if (mRateFrames++ == 0) {
+        mRateStartPts = pts;
+        return;
+    }
+
+    if (mRateFrames < kFrameRateWindow) {
+        return;
+    }
+
+    int64_t span = pts - mRateStartPts;
+    if (span <= 0) {
+        /* timestamps went back, start over */
+        mRateFrames = 0;
+        return;
+    }
+
+    mFrameRate = (float)(mRateFrames - 1) * 1000000 / span;
+    c2_info("estimated frame rate %.1f", mFrameRate);
+
+    (void)updateCapacity();
+}
+
+void C2RKMpiDec::updateRenderClock() {
+    IntfImpl::Lock lock = mIntf->lock();
+    std::shared_ptr<C2StreamRenderClockTuning::output> clock = mIntf->getRenderClock_l();
+
+    mRenderClock.mediaTimeUs = clock->mediaTimeUs;
+    mRenderClock.systemTimeUs = clock->systemTimeUs;
+    mRenderClock.lateThresholdUs = clock->lateThresholdUs;
+}
+
+bool C2RKMpiDec::isLate(int64_t pts) {
+    if (mRenderClock.systemTimeUs == 0) {
+        return false;
+    }
+
+    int64_t deadlineUs = mRenderClock.systemTimeUs + (pts - mRenderClock.mediaTimeUs);
+    return ALooper::GetNowUs() > deadlineUs + mRenderClock.lateThresholdUs;
+}
+
+bool C2RKMpiDec::checkErrorFrame(int64_t pts, bool corrupted) {
+    if (corrupted) {
+        mCorruptedCount++;
+        mCorruptedPts = pts;
+        mCorruptedPending = true;
+
+        C2StreamCorruptedFrameInfo::output info(0u, mCorruptedCount, mCorruptedPts);
+        std::vector<std::unique_ptr<C2SettingResult>> failures;
+        mIntf->config({&info}, C2_MAY_BLOCK, &failures);
+
+        if (mErrorPolicy == C2_ERROR_POLICY_HOLD) {
+            // a sync frame already sent after this one ends the hold
+            mWaitSync = true;
+            mRecoverPts = (mLastSyncPts > pts) ? mLastSyncPts : -1;
+        }
+
+        c2_warn("drop corrupted frame, pts %lld count %u", pts, mCorruptedCount);
+        return true;
+    }
+
+    /* anything shown after the sync frame no longer depends on the error */
+    if (mWaitSync) {
+        if (mRecoverPts < 0 || pts < mRecoverPts) {
+            c2_trace("hold for sync frame, drop pts %lld", pts);
+            return true;
+        }
+        c2_info("recovered at sync frame, pts %lld", pts);
+        mWaitSync = false;
+        mRecoverPts = -1;
+    }
+
+    return false;
+}
+
+void C2RKMpiDec::updateDropStats() {
+    if (!mDropStatsPending) {
+        return;
+    }
+    mDropStatsPending = false;
+
+    C2StreamDropStatsInfo::output stats(0u, mSkippedDecode, mDroppedOutput);
+    std::vector<std::unique_ptr<C2SettingResult>> failures;
+    mIntf->config({&stats}, C2_MAY_BLOCK, &failures);
+}
+
 c2_status_t C2RKMpiDec::getoutframe(OutWorkEntry *entry, bool needGetFrame) {
     c2_status_t ret = C2_OK;
     MPP_RET err = MPP_OK;
@@ -1183,7 +2039,13 @@ REDO:
         if (!mBufferMode) {
             clearOutBuffers();
             mpp_buffer_group_clear(mFrmGrp);
+        } else if (mSharedPool) {
+            mpp_buffer_group_clear(mFrmGrp);
+            releasePoolBuffers();
+            mFrameBufSize = mpp_frame_get_buf_size(frame);
         }
+        /* the new sequence brings its own dpb */
+        mMppDpbCount = 0;
 
         /*
          * All buffer group config done. Set info change ready to let
@@ -1217,6 +2079,8 @@ REDO:
         c2_trace("get one frame [%d:%d] stride [%d:%d] pts %lld err %d eos %d",
                  width, height, hstride, vstride, pts, err, eos);
 
+        c2_trace_stage_pts("getoutframe", pts);
+
         if (eos) {
             c2_info("get output eos.");
             mOutputEos = true;
@@ -1224,10 +2088,53 @@ REDO:
             if (!mppBuffer) goto exit;
         }
 
+        /*
+         * the renderer would throw a late frame away, give its buffer back
+         * to mpp right away instead of copying or queueing it.
+         */
+        if (!eos && isLate(pts)) {
+            c2_trace("drop late output, pts %lld", pts);
+            mDroppedOutput++;
+            mDropStatsPending = true;
+            mpp_frame_deinit(&frame);
+            frame = nullptr;
+            goto REDO;
+        }
+
+        if (!eos && mErrorPolicy != C2_ERROR_POLICY_OUTPUT &&
+            checkErrorFrame(pts, err || mpp_frame_get_discard(frame))) {
+            mpp_frame_deinit(&frame);
+            frame = nullptr;
+            goto REDO;
+        }
+
         if (mBufferMode) {
             bool useRga = (width * height >= 1280 * 720);
 
-            if (useRga) {
+            if (isRgbOutput()) {
+                /* convert while copying out, no extra pass over the frame */
+                RgaParam src, dst;
+                uint32_t bqSlot, blockW, blockH, blockFmt, blockStride, generation;
+                uint64_t usage, bqId;
+
+                int32_t srcFd = mpp_buffer_get_fd(mppBuffer);
+                auto c2Handle = mOutBlock->handle();
+                int32_t dstFd = c2Handle->data[0];
+
+                android::_UnwrapNativeCodec2GrallocMetadata(
+                        c2Handle, &blockW, &blockH, &blockFmt, &usage,
+                        &blockStride, &generation, &bqId, &bqSlot);
+
+                C2RKRgaDef::paramInit(&src, srcFd, width, height, hstride, vstride);
+                C2RKRgaDef::paramInit(&dst, dstFd, width, height, blockStride, blockH);
+                if (!C2RKRgaDef::blit(src, HAL_PIXEL_FORMAT_YCrCb_NV12,
+                                      dst, mOutputFormat)) {
+                    c2_err("faild to convert output to fmt 0x%x on buffer mode.",
+                           mOutputFormat);
+                    ret = C2_CORRUPTED;
+                    goto exit;
+                }
+            } else if (useRga) {
                 RgaParam src, dst;
 
                 int32_t srcFd = mpp_buffer_get_fd(mppBuffer);
@@ -1263,12 +2170,12 @@ REDO:
             }
             mpp_buffer_inc_ref(mppBuffer);
             outBuffer->site = BUFFER_SITE_BY_C2;
+            traceOutBuffers();
 
             outblock = outBuffer->block;
             if (mOutFile != nullptr) {
                 uint8_t *src = (uint8_t*)mpp_buffer_get_ptr(mppBuffer);
-                fwrite(src, 1, hstride * vstride * 3 / 2, mOutFile);
-                fflush(mOutFile);
+                mOutFile->write(src, hstride * vstride * 3 / 2);
             }
         }
 
@@ -1362,7 +2269,7 @@ c2_status_t C2RKMpiDec::commitBufferToMpp(std::shared_ptr<C2GraphicBlock> block)
         MppBufferInfo info;
         memset(&info, 0, sizeof(info));
 
-        info.type = MPP_BUFFER_TYPE_ION;
+        info.type = mBufferType;
         info.fd = fd;
         info.ptr = nullptr;
         info.hnd = nullptr;
@@ -1385,9 +2292,17 @@ c2_status_t C2RKMpiDec::commitBufferToMpp(std::shared_ptr<C2GraphicBlock> block)
                  fd, info.size, mppBuffer);
     }
 
+    traceOutBuffers();
+
     return C2_OK;
 }
 
+bool C2RKMpiDec::isRgbOutput() {
+    /* rga converts from plain 8bit nv12 only, anything else stays yuv */
+    return mBufferMode && mOutputFormat != HAL_PIXEL_FORMAT_YCBCR_420_888 &&
+           !mFbcCfg.mode && (mColorFormat & MPP_FRAME_FMT_MASK) == MPP_FMT_YUV420SP;
+}
+
 c2_status_t C2RKMpiDec::ensureDecoderState(
         const std::shared_ptr<C2BlockPool> &pool) {
     c2_status_t ret = C2_OK;
@@ -1433,14 +2348,24 @@ c2_status_t C2RKMpiDec::ensureDecoderState(
             break;
     }
 
+    // rgb block of the display size, gralloc picks the stride
+    if (isRgbOutput()) {
+        format = mOutputFormat;
+        blockW = mWidth;
+        blockH = mHeight;
+        usage  = 0;
+    }
+
     /*
      * For buffer mode, since we don't konw when the last buffer will use
      * up by user, so we use MPP internal buffer group, and copy output to
      * dst block(mOutBlock).
      */
     if (mBufferMode) {
+        /* rgb output may turn into yuv at info-change with the same size */
         if (mOutBlock &&
-                (mOutBlock->width() != blockW || mOutBlock->height() != blockH)) {
+                (mOutBlock->width() != blockW || mOutBlock->height() != blockH ||
+                 mOutBlockFormat != format)) {
             mOutBlock.reset();
         }
         if (!mOutBlock) {
@@ -1451,12 +2376,23 @@ c2_status_t C2RKMpiDec::ensureDecoderState(
                 c2_err("failed to fetchGraphicBlock, err %d", ret);
                 return ret;
             }
+            mOutBlockFormat = format;
             c2_trace("required (%dx%d) usage 0x%llx format 0x%x , fetch done",
                      blockW, blockH, usage, format);
         }
+
+        if (mSharedPool) {
+            ret = reservePoolBuffers();
+        }
     } else {
         std::shared_ptr<C2GraphicBlock> outblock;
-        uint32_t count = kMaxReferenceCount - getOutBufferCountOwnByMpi();
+        uint32_t count = 0;
+
+        /* above the target buffers are not topped up, mpp drains to it */
+        updateOutBufferCount();
+        if (mOutBufferCount > (uint32_t)getOutBufferCountOwnByMpi()) {
+            count = mOutBufferCount - getOutBufferCountOwnByMpi();
+        }
 
         uint32_t i = 0;
         for (i = 0; i < count; i++) {
@@ -1481,6 +2417,158 @@ c2_status_t C2RKMpiDec::ensureDecoderState(
     return ret;
 }
 
+/*
+ * top the buffer mode group up to the dpb from the shared pool, mpp
+ * decodes into them and the output is copied out as without sharing.
+ */
+c2_status_t C2RKMpiDec::reservePoolBuffers() {
+    std::vector<MppBuffer> buffers;
+    uint32_t target = getMinOutBufferCount();
+
+    if (mFrameBufSize == 0 || mPoolCount >= target) {
+        return C2_OK;
+    }
+
+    MPP_RET err = C2RKFramePool::get()->reserve(
+            this, mFrameBufSize, target - mPoolCount, &buffers);
+
+    /* partly reserved buffers are still ours, use them */
+    for (MppBuffer poolBuffer : buffers) {
+        MppBuffer mppBuffer = nullptr;
+        MppBufferInfo info;
+        memset(&info, 0, sizeof(info));
+
+        info.type = mBufferType;
+        info.fd = mpp_buffer_get_fd(poolBuffer);
+        info.size = mFrameBufSize;
+
+        if (mpp_buffer_import_with_tag(mFrmGrp, &info, &mppBuffer,
+                                       "codec2", __FUNCTION__) != MPP_OK || !mppBuffer) {
+            c2_err("failed to import pool buffer fd %d", info.fd);
+            err = MPP_NOK;
+            continue;
+        }
+        mpp_buffer_put(mppBuffer);
+        mPoolCount++;
+    }
+
+    c2_trace("shared pool: %u buffers of size %zu", mPoolCount, mFrameBufSize);
+
+    if (err != MPP_OK) {
+        c2_err("failed to reserve pool buffers, ret %d", err);
+        return C2_NO_MEMORY;
+    }
+
+    return C2_OK;
+}
+
+void C2RKMpiDec::releasePoolBuffers() {
+    if (!mSharedPool) {
+        return;
+    }
+
+    /* mFrmGrp is cleared by the caller, nothing in mpp points at them */
+    C2RKFramePool::get()->unreserve(this);
+    mPoolCount = 0;
+}
+
+/*
+ * buffers mpp needs to keep decoding: the references plus one being
+ * decoded and one on its way out. the avc/hevc dpb is what the sps
+ * declares, before the sps is seen it follows the hevc rule on the
+ * level max picture size, larger than the avc one. mpp may still need
+ * more, see checkOutBufferStarved().
+ */
+uint32_t C2RKMpiDec::getMinOutBufferCount() {
+    uint32_t dpb = kMaxReferenceCount;
+
+    if (mKeyFrameOnly) {
+        return c2_min(c2_max(kKeyFrameOnlyOutputDelay, mMppDpbCount), kMaxReferenceCount);
+    }
+
+    switch (mCodingType) {
+    case MPP_VIDEO_CodingVP8: {
+        dpb = 3;
+    } break;
+    case MPP_VIDEO_CodingVP9:
+    case MPP_VIDEO_CodingAV1: {
+        dpb = 8;
+    } break;
+    case MPP_VIDEO_CodingAVC:
+    case MPP_VIDEO_CodingHEVC: {
+        size_t maxLumaPs = IntfImpl::GetLevelMaxLumaPs((C2Config::level_t)mLevel);
+        size_t lumaPs = (size_t)mWidth * mHeight;
+
+        if (mStreamRefCount >= 0) {
+            dpb = c2_max((uint32_t)mStreamRefCount, 1u);
+        } else if (maxLumaPs > 0 && lumaPs > 0) {
+            if (lumaPs <= maxLumaPs / 4) {
+                dpb = 16;
+            } else if (lumaPs <= maxLumaPs / 2) {
+                dpb = 12;
+            } else if (lumaPs <= maxLumaPs * 3 / 4) {
+                dpb = 8;
+            } else {
+                dpb = 6;
+            }
+        }
+    } break;
+    case MPP_VIDEO_CodingMPEG2:
+    case MPP_VIDEO_CodingMPEG4:
+    case MPP_VIDEO_CodingH263: {
+        dpb = 2;
+    } break;
+    default: {
+    } break;
+    }
+
+    return c2_min(c2_max(dpb + 2, mMppDpbCount), kMaxReferenceCount);
+}
+
+/*
+ * mpp refused input while it holds every output buffer we gave it: the
+ * real dpb is larger than the estimate, keep one more from now on.
+ */
+void C2RKMpiDec::checkOutBufferStarved() {
+    uint32_t held = 0;
+
+    if (!mBufferMode) {
+        if ((uint32_t)getOutBufferCountOwnByMpi() < mOutBufferCount) {
+            return;
+        }
+        held = mOutBufferCount;
+    } else if (mSharedPool && mPoolCount > 0) {
+        if (mpp_buffer_group_unused(mFrmGrp) > 0) {
+            return;
+        }
+        held = mPoolCount;
+    } else {
+        return;
+    }
+
+    if (held >= kMaxReferenceCount || held < mMppDpbCount) {
+        return;
+    }
+
+    mMppDpbCount = held + 1;
+    c2_info("mpp starved with %u output buffers, keep at least %u", held, mMppDpbCount);
+}
+
+void C2RKMpiDec::updateOutBufferCount() {
+    size_t frameSize = (size_t)mHorStride * mVerStride * 3 / 2;
+    uint32_t minCount = getMinOutBufferCount();
+    /* keyframe-only has no use for spare buffers, keep the reported delay */
+    uint32_t maxCount = mKeyFrameOnly ? minCount : kMaxReferenceCount;
+    uint32_t count = C2RKMemoryBudget::get()->getBufferCount(
+            this, frameSize, minCount, maxCount);
+
+    if (count != mOutBufferCount) {
+        c2_info("output buffers %u -> %u", mOutBufferCount, count);
+        mOutBufferCount = count;
+        mOutDelayChanged = true;
+    }
+}
+
 class C2RKMpiDecFactory : public C2ComponentFactory {
 public:
     C2RKMpiDecFactory(std::string componentName)
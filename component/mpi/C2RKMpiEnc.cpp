@@ -40,7 +40,11 @@
 #include "C2RKCodecMapper.h"
 #include "C2RKVideoGlobal.h"
 #include "C2RKVersion.h"
-#include "C2RKChips.h"
+#include "C2RKChipCapDef.h"
+#include "C2RKMppCtxPool.h"
+
+/* upper bound of the sps/pps/vps header */
+#define C2_ENC_CSD_MAX_SIZE     (64 * 1024)
 
 namespace android {
 
@@ -120,6 +124,11 @@ public:
         noTimeStretch();
         setDerivedInstance(this);
 
+        MppCodingType codingType = MPP_VIDEO_CodingUnused;
+        if (C2RKMediaUtils::getCodingTypeFromComponentName(name, &codingType)) {
+            addAvailableCapacity(MPP_CTX_ENC, codingType);
+        }
+
         mMlvecParams = std::make_shared<MlvecParams>();
 
         addParameter(
@@ -352,6 +361,20 @@ public:
                 .withSetter(Setter<decltype(mSceneMode)::element_type>::StrictValueWithNoDeps)
                 .build());
 
+        addParameter(
+                DefineParam(mOsdPalette, C2_PARAMKEY_OSD_PALETTE)
+                .withDefault(C2StreamOsdPaletteTuning::input::AllocShared(0u, 0u))
+                .withFields({C2F(mOsdPalette, m.value).any()})
+                .withSetter(OsdPaletteSetter)
+                .build());
+
+        addParameter(
+                DefineParam(mOsdData, C2_PARAMKEY_OSD_DATA)
+                .withDefault(C2StreamOsdDataTuning::input::AllocShared(0u, 0u))
+                .withFields({C2F(mOsdData, m.value).any()})
+                .withSetter(OsdDataSetter)
+                .build());
+
         addParameter(
                 DefineParam(mMlvecParams->driverInfo, C2_PARAMKEY_MLVEC_ENC_DRI_VERSION)
                 .withConstValue(new C2DriverVersion::output(MLVEC_DRIVER_VERSION))
@@ -521,6 +544,25 @@ public:
         return C2R::Ok();
     }
 
+    static C2R OsdPaletteSetter(bool mayBlock, C2P<C2StreamOsdPaletteTuning::input> &me) {
+        (void)mayBlock;
+        C2R res = C2R::Ok();
+        if (me.v.flexCount() > 256 * sizeof(uint32_t)
+                || (me.v.flexCount() % sizeof(uint32_t)) != 0) {
+            res = res.plus(C2SettingResultBuilder::BadValue(me.F(me.v.m.value)));
+        }
+        return res;
+    }
+
+    static C2R OsdDataSetter(bool mayBlock, C2P<C2StreamOsdDataTuning::input> &me) {
+        (void)mayBlock;
+        C2R res = C2R::Ok();
+        if (me.v.flexCount() > 0 && me.v.flexCount() < sizeof(C2OsdDataHeader)) {
+            res = res.plus(C2SettingResultBuilder::BadValue(me.F(me.v.m.value)));
+        }
+        return res;
+    }
+
     static C2R PictureQuantizationSetter(bool mayBlock,
                                          C2P<C2StreamPictureQuantizationTuning::output> &me) {
         (void)mayBlock;
@@ -883,6 +925,10 @@ public:
     { return mPrependHeaderMode; }
     std::shared_ptr<C2StreamSceneModeInfo::input> getSceneMode_l() const
     { return mSceneMode; }
+    std::shared_ptr<C2StreamOsdPaletteTuning::input> getOsdPalette_l() const
+    { return mOsdPalette; }
+    std::shared_ptr<C2StreamOsdDataTuning::input> getOsdData_l() const
+    { return mOsdData; }
     std::shared_ptr<MlvecParams> getMlvecParams_l() const
     { return mMlvecParams; }
 
@@ -903,6 +949,8 @@ private:
     std::shared_ptr<C2StreamTemporalLayeringTuning::output> mLayering;
     std::shared_ptr<C2PrependHeaderModeSetting> mPrependHeaderMode;
     std::shared_ptr<C2StreamSceneModeInfo::input> mSceneMode;
+    std::shared_ptr<C2StreamOsdPaletteTuning::input> mOsdPalette;
+    std::shared_ptr<C2StreamOsdDataTuning::input> mOsdData;
     std::shared_ptr<MlvecParams> mMlvecParams;
 };
 
@@ -926,17 +974,24 @@ C2RKMpiEnc::C2RKMpiEnc(
       mHorStride(0),
       mVerStride(0),
       mCurLayerCount(0),
+      mMaxBframes(0),
+      mRefPeriod(0),
       mInputCount(0),
       mOutputCount(0),
+      mOsdBuffer(nullptr),
+      mOsdEnable(false),
       mInFile(nullptr),
-      mOutFile(nullptr) {
+      mOutFile(nullptr),
+      mTraceHwFrames(name, id, "hw-frames") {
     c2_info("version: %s", C2_GIT_BUILD_VERSION);
 
     if (!C2RKMediaUtils::getCodingTypeFromComponentName(name, &mCodingType)) {
         c2_err("failed to get MppCodingType from component %s", name);
     }
 
-    mChipType = getChipName()->type;
+    mChipType = C2RKChipCapDef::getChipType();
+
+    memset(&mCsdKey, 0, sizeof(mCsdKey));
 
     Rockchip_C2_GetEnvU32("vendor.c2.venc.debug", &c2_venc_debug, 0);
     c2_info("venc_debug: 0x%x", c2_venc_debug);
@@ -946,12 +1001,7 @@ C2RKMpiEnc::C2RKMpiEnc(
         memset(fileName, 0, 128);
 
         sprintf(fileName, "/data/video/enc_in_%ld.bin", syscall(SYS_gettid));
-        mInFile = fopen(fileName, "wb");
-        if (mInFile == nullptr) {
-            c2_err("failed to open input file, err %s", strerror(errno));
-        } else {
-            c2_info("recording input to %s", fileName);
-        }
+        mInFile = C2RKDump::open(fileName);
     }
 
     if (c2_venc_debug & VIDEO_DBG_RECORD_OUT) {
@@ -959,12 +1009,7 @@ C2RKMpiEnc::C2RKMpiEnc(
         memset(fileName, 0, 128);
 
         sprintf(fileName, "/data/video/enc_out_%ld.bin", syscall(SYS_gettid));
-        mOutFile = fopen(fileName, "wb");
-        if (mOutFile == nullptr) {
-            c2_err("failed to open output file, err %s", strerror(errno));
-        } else {
-            c2_info("recording output to %s", fileName);
-        }
+        mOutFile = C2RKDump::open(fileName);
     }
 }
 
@@ -975,7 +1020,9 @@ C2RKMpiEnc::~C2RKMpiEnc() {
 
 c2_status_t C2RKMpiEnc::onInit() {
     c2_info_f("in");
-    return C2_OK;
+    C2RKMppCtxPool::get()->prepare(MPP_CTX_ENC, mCodingType);
+    /* configuration is complete by now, keep the setup off the first frame */
+    return initEncoder();
 }
 
 c2_status_t C2RKMpiEnc::onStop() {
@@ -994,6 +1041,18 @@ void C2RKMpiEnc::onRelease() {
     releaseEncoder();
 }
 
+bool C2RKMpiEnc::getCapacityRequest(C2CapacityRequest *request) {
+    IntfImpl::Lock lock = mIntf->lock();
+
+    request->type = MPP_CTX_ENC;
+    request->codingType = mCodingType;
+    request->width = mIntf->getSize_l()->width;
+    request->height = mIntf->getSize_l()->height;
+    request->frameRate = mIntf->getFrameRate_l()->value;
+
+    return true;
+}
+
 c2_status_t C2RKMpiEnc::onFlush_sm() {
     c2_info_f("in");
     return C2_OK;
@@ -1060,6 +1119,7 @@ c2_status_t C2RKMpiEnc::setupFrameRate() {
             c2_info("updating IDR interval: %d -> %d", idrInterval, syncInterval);
             idrInterval = syncInterval;
         }
+        mMaxBframes = maxBframes;
     }
 
     c2_info("setupFrameRate: framerate %.2f gop %d", frameRate, idrInterval);
@@ -1494,6 +1554,73 @@ c2_status_t C2RKMpiEnc::setupTemporalLayers() {
     }
 
     mCurLayerCount = layerCount;
+    mRefPeriod = 2 << (layerCount - 2);
+
+    return C2_OK;
+}
+
+c2_status_t C2RKMpiEnc::setupGopStructure() {
+    int32_t bFrames = mMaxBframes;
+
+    /* explicit temporal layering takes precedence over gop layering */
+    if (bFrames <= 0 || mCurLayerCount >= 2) {
+        return C2_OK;
+    }
+
+    if (bFrames > 2) {
+        c2_warn("only support gop b-layer 1 ~ 2(%d); clamped.", bFrames);
+        bFrames = 2;
+    }
+
+    /*
+     * NOTE:
+     * The vepu emits packets in input order and has no B-slice support,
+     * so the B layers requested by C2StreamGopTuning are mapped to
+     * hierarchical-P with the same reference depth: every frame that
+     * would be a B-frame becomes a non-reference P-frame on the top
+     * temporal layer, referencing the last layer 0 frame. There is no
+     * reordering, so output pts and C2 ordinals follow input order.
+     */
+
+    int ret = 0;
+    MppEncRefCfg ref;
+    MppEncRefStFrmCfg stRef[4];
+    RK_S32 stCnt = bFrames + 2;
+
+    memset(&stRef, 0, sizeof(stRef));
+
+    mpp_enc_ref_cfg_init(&ref);
+
+    c2_info("setupGopStructure: b-layer %d", bFrames);
+
+    // b-layer 2
+    //   /-> P1
+    //  /--> P2
+    // P0 ----------> P3
+    for (int32_t i = 0; i < stCnt; i++) {
+        bool isBase = (i == 0 || i == stCnt - 1);
+
+        stRef[i].is_non_ref    = isBase ? 0 : 1;
+        stRef[i].temporal_id   = isBase ? 0 : 1;
+        stRef[i].ref_mode      = REF_TO_TEMPORAL_LAYER;
+        stRef[i].ref_arg       = 0;
+        stRef[i].repeat        = 0;
+    }
+
+    mpp_enc_ref_cfg_set_cfg_cnt(ref, 0, stCnt);
+    mpp_enc_ref_cfg_add_st_cfg(ref, stCnt, stRef);
+
+    /* check and get dpb size */
+    mpp_enc_ref_cfg_check(ref);
+
+    ret = mMppMpi->control(mMppCtx, MPP_ENC_SET_REF_CFG, ref);
+    mpp_enc_ref_cfg_deinit(&ref);
+    if (ret) {
+        c2_err("setupGopStructure: failed to set ref cfg ret %d", ret);
+        return C2_CORRUPTED;
+    }
+
+    mRefPeriod = bFrames + 1;
 
     return C2_OK;
 }
@@ -1582,6 +1709,7 @@ c2_status_t C2RKMpiEnc::setupMlvecIfNeccessary() {
             c2_err("failed to setup mlvec static config");
         } else {
             mCurLayerCount = layerCount;
+            mRefPeriod = (layerCount >= 2) ? (2 << (layerCount - 2)) : 0;
         }
 
         // mlvec need pic_order_cnt_type equal to 2
@@ -1631,6 +1759,9 @@ c2_status_t C2RKMpiEnc::setupEncCfg() {
     /* Video control Set Temporal Layers */
     setupTemporalLayers();
 
+    /* Video control Set Gop Structure */
+    setupGopStructure();
+
     /* Video control Set Prepend Header Setting */
     setupPrependHeaderSetting();
 
@@ -1659,7 +1790,7 @@ c2_status_t C2RKMpiEnc::setupEncCfg() {
 c2_status_t C2RKMpiEnc::initEncoder() {
     c2_status_t ret = C2_OK;
     int err = 0;
-    MppPollType timeout = MPP_POLL_BLOCK;
+    int64_t initUs = ALooper::GetNowUs();
 
     c2_info_f("in");
 
@@ -1718,37 +1849,37 @@ c2_status_t C2RKMpiEnc::initEncoder() {
 
     c2_info("alloc temporary DmaMem fd %d size %d", mDmaMem->fd, mDmaMem->size);
 
-    // create mpp and init mpp
-    err = mpp_create(&mMppCtx, &mMppMpi);
+    err = C2RKMppCtxPool::get()->take(MPP_CTX_ENC, mCodingType, &mMppCtx, &mMppMpi);
     if (err) {
-        c2_err("failed to mpp_create, ret %d", err);
+        c2_err("failed to get mpp context, ret %d", err);
         ret = C2_CORRUPTED;
         goto error;
     }
 
-    err = mMppMpi->control(mMppCtx, MPP_SET_OUTPUT_TIMEOUT, &timeout);
-    if (MPP_OK != err) {
-        c2_err("failed to set output timeout %d, ret %d", timeout, err);
-        ret = C2_CORRUPTED;
-        goto error;
-    }
+    /*
+     * layering and gop setup only touch these when they apply, drop the
+     * ones left by a previous session.
+     */
+    mMaxBframes = 0;
+    mCurLayerCount = 0;
+    mRefPeriod = 0;
 
-    err = mpp_init(mMppCtx, MPP_CTX_ENC, mCodingType);
-    if (err) {
-        c2_err("failed to mpp_init, ret %d", err);
+    ret = setupEncCfg();
+    if (ret) {
+        c2_err("failed to set config, ret=0x%x", ret);
         ret = C2_CORRUPTED;
         goto error;
     }
 
-    ret = setupEncCfg();
+    ret = updateCsd();
     if (ret) {
-        c2_err("failed to set config, ret=0x%x", ret);
-        ret = C2_CORRUPTED;
         goto error;
     }
 
     mStarted = true;
 
+    c2_info("init: done in %lld us", (long long)(ALooper::GetNowUs() - initUs));
+
     return C2_OK;
 
 error:
@@ -1775,7 +1906,7 @@ c2_status_t C2RKMpiEnc::releaseEncoder() {
     }
 
     if (mMppCtx){
-        mpp_destroy(mMppCtx);
+        C2RKMppCtxPool::get()->put(mMppCtx);
         mMppCtx = nullptr;
     }
 
@@ -1790,19 +1921,91 @@ c2_status_t C2RKMpiEnc::releaseEncoder() {
         mMlvec = nullptr;
     }
 
+    if (mOsdBuffer != nullptr) {
+        mpp_buffer_put(mOsdBuffer);
+        mOsdBuffer = nullptr;
+    }
+    mOsdEnable = false;
+    mOsdPalette.reset();
+    mOsdData.reset();
+    mOsdRejected.reset();
+
     if (mInFile != nullptr) {
-        fclose(mInFile);
+        delete mInFile;
         mInFile = nullptr;
     }
 
     if (mOutFile != nullptr) {
-        fclose(mOutFile);
+        delete mOutFile;
         mOutFile = nullptr;
     }
 
     return C2_OK;
 }
 
+c2_status_t C2RKMpiEnc::updateCsd() {
+    MyCsdKey_t key;
+    uint32_t size = 0;
+
+    memset(&key, 0, sizeof(key));
+    {
+        IntfImpl::Lock lock = mIntf->lock();
+        std::shared_ptr<C2StreamColorAspectsInfo::output> colorAspects
+                = mIntf->getCodedColorAspects_l();
+
+        key.width = mSize->width;
+        key.height = mSize->height;
+        key.profile = mIntf->getProfile_l(mCodingType);
+        key.level = mIntf->getLevel_l(mCodingType);
+        key.primaries = (uint32_t)colorAspects->primaries;
+        key.transfer = (uint32_t)colorAspects->transfer;
+        key.matrix = (uint32_t)colorAspects->matrix;
+        key.range = (uint32_t)colorAspects->range;
+    }
+    key.layerCount = mCurLayerCount;
+    key.maxBframes = mMaxBframes;
+    key.refPeriod = mRefPeriod;
+
+    if (!mCsd.empty() && !memcmp(&key, &mCsdKey, sizeof(key))) {
+        c2_info("reuse cached csd, size %zu", mCsd.size());
+        return C2_OK;
+    }
+
+    mCsd.clear();
+
+    /*
+     * grow the header buffer until mpp fits the whole header in, large vui
+     * or multi-layer headers do not fit the usual 1KB.
+     */
+    for (size = 1024; size <= C2_ENC_CSD_MAX_SIZE; size <<= 1) {
+        std::vector<uint8_t> hdrBuf(size);
+        MppPacket hdrPkt = nullptr;
+        size_t length = 0;
+        MPP_RET err = MPP_OK;
+
+        err = mpp_packet_init(&hdrPkt, hdrBuf.data(), size);
+        if (err != MPP_OK) {
+            c2_err("failed to init header packet, ret %d", err);
+            return C2_NO_MEMORY;
+        }
+
+        err = mMppMpi->control(mMppCtx, MPP_ENC_GET_HDR_SYNC, hdrPkt);
+        length = mpp_packet_get_length(hdrPkt);
+        mpp_packet_deinit(&hdrPkt);
+
+        if (err == MPP_OK && length > 0 && length < size) {
+            hdrBuf.resize(length);
+            mCsd.swap(hdrBuf);
+            mCsdKey = key;
+            c2_info("generate csd, size %zu", mCsd.size());
+            return C2_OK;
+        }
+    }
+
+    c2_err("failed to get stream header within %d bytes", C2_ENC_CSD_MAX_SIZE);
+    return C2_CORRUPTED;
+}
+
 void C2RKMpiEnc::fillEmptyWork(const std::unique_ptr<C2Work>& work) {
     uint32_t flags = 0;
 
@@ -1831,6 +2034,8 @@ void C2RKMpiEnc::finishWork(
     frmIndex = entry.frameIndex;
     packet = entry.outPacket;
 
+    c2_trace_stage_index("finishWork", frmIndex);
+
     void   *data = mpp_packet_get_data(packet);
     size_t  len  = mpp_packet_get_length(packet);
 
@@ -1856,8 +2061,7 @@ void C2RKMpiEnc::finishWork(
     memcpy(wView.data(), data, len);
 
     if (mOutFile != nullptr) {
-        fwrite(data, 1, len, mOutFile);
-        fflush(mOutFile);
+        mOutFile->write(data, len);
     }
 
     RK_S32 isIntra = 0;
@@ -1997,48 +2201,24 @@ void C2RKMpiEnc::process(
     mSawInputEOS = (flags & C2FrameData::FLAG_END_OF_STREAM);
 
     if (!mSpsPpsHeaderReceived) {
-        MppPacket hdrPkt = nullptr;
-        void *hdrBuf = nullptr;
-        void *extradata = nullptr;
-        uint32_t hdrBufSize = 1024;
-        uint32_t extradataSize = 0;
-
-        hdrBuf = malloc(hdrBufSize * sizeof(uint8_t));
-        if (hdrBuf)
-            mpp_packet_init(&hdrPkt, hdrBuf, hdrBufSize);
-
-        if (hdrPkt) {
-            mMppMpi->control(mMppCtx, MPP_ENC_GET_HDR_SYNC, hdrPkt);
-            extradataSize = mpp_packet_get_length(hdrPkt);
-            extradata = mpp_packet_get_data(hdrPkt);
-        }
-
         std::unique_ptr<C2StreamInitDataInfo::output> csd =
-                C2StreamInitDataInfo::output::AllocUnique(extradataSize, 0u);
+                C2StreamInitDataInfo::output::AllocUnique(mCsd.size(), 0u);
         if (!csd) {
             c2_err("CSD allocation failed");
             work->result = C2_NO_MEMORY;
             work->workletsProcessed = 1u;
-            C2_SAFE_FREE(hdrBuf);
             return;
         }
 
-        memcpy(csd->m.value, extradata, extradataSize);
+        memcpy(csd->m.value, mCsd.data(), mCsd.size());
         work->worklets.front()->output.configUpdate.push_back(std::move(csd));
 
         if (mOutFile != nullptr) {
-            fwrite(extradata, 1, extradataSize , mOutFile);
-            fflush(mOutFile);
+            mOutFile->write(mCsd.data(), mCsd.size());
         }
 
         mSpsPpsHeaderReceived = true;
 
-        if (hdrPkt){
-            mpp_packet_deinit(&hdrPkt);
-            hdrPkt = NULL;
-        }
-        C2_SAFE_FREE(hdrBuf);
-
         if (work->input.buffers.empty()) {
             work->workletsProcessed = 1u;
             return;
@@ -2078,7 +2258,10 @@ void C2RKMpiEnc::process(
     }
 
     /* send frame to mpp */
-    err = sendframe(inDmaBuf, frameIndex, flags);
+    {
+        c2_trace_stage("sendframe", frameIndex, work->input.ordinal.timestamp.peekll());
+        err = sendframe(inDmaBuf, frameIndex, flags);
+    }
     if (C2_OK != err) {
         c2_err("failed to enqueue frame, err %d", err);
         mSignalledError = true;
@@ -2110,8 +2293,8 @@ c2_status_t C2RKMpiEnc::handleRequestSyncFrame() {
     int32_t layerPos = 0;
 
     // TODO Is there a better way to count frame layer?
-    if (mCurLayerCount >= 2) {
-        layerPos = mInputCount % (2 << (mCurLayerCount - 2));
+    if (mRefPeriod > 1) {
+        layerPos = mInputCount % mRefPeriod;
     }
 
     // only handle IDR request at layer 0
@@ -2139,6 +2322,138 @@ c2_status_t C2RKMpiEnc::handleRequestSyncFrame() {
     return C2_OK;
 }
 
+c2_status_t C2RKMpiEnc::handleOsdCfg(MppMeta meta) {
+    c2_status_t ret = C2_OK;
+    int err = 0;
+
+    IntfImpl::Lock lock = mIntf->lock();
+    std::shared_ptr<C2StreamOsdPaletteTuning::input> palette = mIntf->getOsdPalette_l();
+    std::shared_ptr<C2StreamOsdDataTuning::input> data = mIntf->getOsdData_l();
+    lock.unlock();
+
+    if (palette != mOsdPalette) {
+        MppEncOSDPltCfg pltCfg;
+        MppEncOSDPlt plt;
+        size_t count = palette->flexCount() / sizeof(uint32_t);
+
+        memset(&pltCfg, 0, sizeof(pltCfg));
+        memset(&plt, 0, sizeof(plt));
+
+        pltCfg.change = MPP_ENC_OSD_PLT_CFG_CHANGE_ALL;
+        if (count > 0) {
+            memcpy(plt.data, palette->m.value, count * sizeof(uint32_t));
+            pltCfg.type = MPP_ENC_OSD_PLT_TYPE_USERDEF;
+            pltCfg.plt  = &plt;
+        } else {
+            pltCfg.type = MPP_ENC_OSD_PLT_TYPE_DEFAULT;
+        }
+
+        err = mMppMpi->control(mMppCtx, MPP_ENC_SET_OSD_PLT_CFG, &pltCfg);
+        if (err) {
+            c2_err("failed to set osd palette, ret %d", err);
+        } else {
+            c2_info("osd palette update, entries %zu", count);
+        }
+        mOsdPalette = palette;
+    }
+
+    if (data != mOsdData && data != mOsdRejected) {
+        ret = setupOsdData(data);
+        if (ret == C2_OK) {
+            mOsdData = data;
+            mOsdRejected.reset();
+        } else if (ret == C2_BAD_VALUE) {
+            /* an invalid blob stays invalid, retry only on allocation failures */
+            mOsdRejected = data;
+        }
+    }
+
+    if (mOsdEnable) {
+        mpp_meta_set_ptr(meta, KEY_OSD_DATA, (void*)&mOsdCfg);
+    }
+
+    return ret;
+}
+
+/*
+ * validate |data| and load it into mOsdCfg. the previous osd stays
+ * enabled when the blob is rejected, it is dropped only if its buffer
+ * has to be reallocated.
+ */
+c2_status_t C2RKMpiEnc::setupOsdData(
+        const std::shared_ptr<C2StreamOsdDataTuning::input> &data) {
+    if (data->flexCount() < sizeof(C2OsdDataHeader)) {
+        c2_info("osd disabled");
+        mOsdEnable = false;
+        return C2_OK;
+    }
+
+    C2OsdDataHeader header;
+    MppEncOSDData cfg;
+    size_t bitmapSize = data->flexCount() - sizeof(C2OsdDataHeader);
+    uint32_t mbW = C2_ALIGN(mSize->width, 16) / 16;
+    uint32_t mbH = C2_ALIGN(mSize->height, 16) / 16;
+
+    memcpy(&header, data->m.value, sizeof(header));
+
+    if (header.numRegion == 0 || header.numRegion > C2_OSD_MAX_REGIONS) {
+        c2_err("unsupport osd region num %d", header.numRegion);
+        return C2_BAD_VALUE;
+    }
+
+    memset(&cfg, 0, sizeof(cfg));
+
+    for (uint32_t i = 0; i < header.numRegion; i++) {
+        C2OsdRegionDesc *desc = &header.regions[i];
+
+        /* written to not wrap, the descriptors come from the client */
+        if (desc->numMbX > mbW || desc->startMbX > mbW - desc->numMbX ||
+            desc->numMbY > mbH || desc->startMbY > mbH - desc->numMbY ||
+            desc->bufOffset > bitmapSize ||
+            (size_t)desc->numMbX * desc->numMbY * 256 > bitmapSize - desc->bufOffset) {
+            c2_err("invalid osd region %d [%u,%u %ux%u] offset %u",
+                   i, desc->startMbX, desc->startMbY,
+                   desc->numMbX, desc->numMbY, desc->bufOffset);
+            return C2_BAD_VALUE;
+        }
+
+        cfg.region[i].enable     = desc->enable;
+        cfg.region[i].inverse    = desc->inverse;
+        cfg.region[i].start_mb_x = desc->startMbX;
+        cfg.region[i].start_mb_y = desc->startMbY;
+        cfg.region[i].num_mb_x   = desc->numMbX;
+        cfg.region[i].num_mb_y   = desc->numMbY;
+        cfg.region[i].buf_offset = desc->bufOffset;
+    }
+
+    if (mOsdBuffer && mpp_buffer_get_size(mOsdBuffer) < bitmapSize) {
+        /* mOsdCfg points at it */
+        mOsdEnable = false;
+        mpp_buffer_put(mOsdBuffer);
+        mOsdBuffer = nullptr;
+    }
+
+    if (!mOsdBuffer) {
+        if (mpp_buffer_get(nullptr, &mOsdBuffer, bitmapSize)) {
+            c2_err("failed to get osd buffer, size %zu", bitmapSize);
+            mOsdBuffer = nullptr;
+            return C2_NO_MEMORY;
+        }
+    }
+
+    memcpy(mpp_buffer_get_ptr(mOsdBuffer),
+           data->m.value + sizeof(C2OsdDataHeader), bitmapSize);
+
+    cfg.buf = mOsdBuffer;
+    cfg.num_region = header.numRegion;
+    mOsdCfg = cfg;
+    mOsdEnable = true;
+
+    c2_info("osd data update, regions %d size %zu", header.numRegion, bitmapSize);
+
+    return C2_OK;
+}
+
 c2_status_t C2RKMpiEnc::handleMlvecDynamicCfg(MppMeta meta) {
     int32_t layerCount = 0;
     int32_t layerPos = 0;
@@ -2169,6 +2484,7 @@ c2_status_t C2RKMpiEnc::handleMlvecDynamicCfg(MppMeta meta) {
             c2_info("temporalLayers change, %d to %d", mCurLayerCount, layerCount);
             mMlvec->setupMaxTid(layerCount);
             mCurLayerCount = layerCount;
+            mRefPeriod = (layerCount >= 2) ? (2 << (layerCount - 2)) : 0;
         }
 
         if (params->ltrMarkFrmCtl->markFrame >= 0) {
@@ -2266,8 +2582,7 @@ c2_status_t C2RKMpiEnc::getInBufferFromWork(
         uint32_t fd = c2Handle->data[0];
 
         if (mInFile != nullptr) {
-            fwrite(input->data()[0], 1, stride * height * 4, mInFile);
-            fflush(mInFile);
+            mInFile->write(input->data()[0], stride * height * 4);
         }
 
         if (mChipType == RK_CHIP_3588 || !((stride & 0xf) || (height & 0xf))) {
@@ -2306,8 +2621,7 @@ c2_status_t C2RKMpiEnc::getInBufferFromWork(
         uint32_t fd = c2Handle->data[0];
 
         if (mInFile != nullptr) {
-            fwrite(input->data()[0], 1, stride * height * 3 / 2, mInFile);
-            fflush(mInFile);
+            mInFile->write(input->data()[0], stride * height * 3 / 2);
         }
 
         /*
@@ -2381,7 +2695,7 @@ c2_status_t C2RKMpiEnc::sendframe(
 
         memset(&commit, 0, sizeof(commit));
 
-        commit.type = MPP_BUFFER_TYPE_ION;
+        commit.type = C2RKChipCapDef::getImportBufferType();
         commit.fd = dBuffer.fd;
         commit.size = dBuffer.size;
 
@@ -2425,6 +2739,11 @@ c2_status_t C2RKMpiEnc::sendframe(
     /* handle IDR request */
     handleRequestSyncFrame();
 
+    /* handle OSD overlay */
+    if (handleOsdCfg(mpp_frame_get_meta(frame)) != C2_OK) {
+        c2_warn("osd config not applied, encode frame without the update");
+    }
+
     err = mMppMpi->encode_put_frame(mMppCtx, frame);
     if (err) {
         c2_err("failed to put_frame, err %d", err);
@@ -2433,6 +2752,7 @@ c2_status_t C2RKMpiEnc::sendframe(
     }
 
     mInputCount++;
+    mTraceHwFrames.set(mInputCount - mOutputCount);
 
     ret = C2_OK;
 
@@ -2452,28 +2772,32 @@ c2_status_t C2RKMpiEnc::getoutpacket(OutWorkEntry *entry) {
     if (err) {
         return C2_NOT_FOUND;
     } else {
-        int64_t  pts = mpp_packet_get_pts(packet);
+        /* sendframe passes the work frame index as the mpp pts */
+        uint64_t frameIndex = (uint64_t)mpp_packet_get_pts(packet);
         size_t   len = mpp_packet_get_length(packet);
         uint32_t eos = mpp_packet_get_eos(packet);
 
         mOutputCount++;
-        c2_trace("get outpacket pts %lld size %d eos %d", pts, len, eos);
+        mTraceHwFrames.set(mInputCount - mOutputCount);
+        c2_trace("get outpacket frameIndex %llu size %d eos %d", frameIndex, len, eos);
+
+        c2_trace_stage_index("getoutpacket", frameIndex);
 
         if (eos) {
             c2_info("get output eos");
             mOutputEOS = true;
-            if (pts == 0 || !len) {
+            if (frameIndex == 0 || !len) {
                 c2_info("eos with empty pkt");
                 return C2_CORRUPTED;
             }
         }
 
         if (!len) {
-            c2_warn("ignore empty output with pts %lld", pts);
+            c2_warn("ignore empty output with frameIndex %llu", frameIndex);
             return C2_CORRUPTED;
         }
 
-        entry->frameIndex = pts;
+        entry->frameIndex = frameIndex;
         entry->outPacket  = packet;
 
         return C2_OK;
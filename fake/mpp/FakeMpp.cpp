@@ -0,0 +1,581 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <deque>
+#include <mutex>
+
+#include "FakeMppInternal.h"
+#include "mpp_soc.h"
+#include "rk_venc_cfg.h"
+
+/*
+ * Software stand-in of libmpp. It implements the MppApi data flow with a
+ * timing model instead of hardware: every input becomes ready after a fixed
+ * latency, the decoder raises info-change before its first picture and
+ * takes its output buffers from the external group set by the caller, the
+ * encoder produces start-code prefixed dummy packets sized by the rate
+ * control target.
+ *
+ * Tunables, read from the environment at mpp_create():
+ *   FAKE_MPP_DEC_LATENCY_US       decode latency per packet, default 0
+ *   FAKE_MPP_ENC_LATENCY_US       encode latency per frame, default 0
+ *   FAKE_MPP_DEC_WIDTH/HEIGHT     stream size when no frame info is set
+ *   FAKE_MPP_INFO_CHANGE_FRAMES   raise info-change every n pictures, 0 off
+ *   FAKE_MPP_INPUT_QUEUE          max inputs in flight, default 4
+ */
+
+#define FAKE_MPP_ALIGN(x, a)        (((x) + (a) - 1) & ~((a) - 1))
+
+struct FakeMppTask {
+    RK_S64  pts;
+    RK_S64  readyUs;
+    bool    picture;
+    bool    eos;
+    bool    intra;
+};
+
+struct FakeMppCtx {
+    MppCtxType      type;
+    MppCodingType   coding;
+    bool            inited;
+    MppPollType     timeout;
+
+    std::mutex              lock;
+    std::deque<FakeMppTask> tasks;
+
+    /* decoder */
+    FakeMppBufferGroup *extGroup;
+    RK_U32          width;
+    RK_U32          height;
+    RK_U32          horStride;
+    RK_U32          verStride;
+    MppFrameFormat  fmt;
+    bool            infoChangeDone;
+    bool            infoChangeWait;
+    RK_U32          picSinceInfoChange;
+
+    /* encoder */
+    FakeMppEncCfg   encCfg;
+    bool            idrRequest;
+    RK_S64          frameCount;
+
+    /* tunables */
+    RK_S64          latencyUs;
+    RK_U32          infoChangeFrames;
+    RK_U32          inputQueueMax;
+};
+
+static RK_S64 getEnv(const char *name, RK_S64 def) {
+    const char *value = getenv(name);
+    return value ? strtoll(value, nullptr, 0) : def;
+}
+
+static RK_S64 nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (RK_S64)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/*
+ * Wait for the head task to become ready as allowed by the output timeout.
+ * Returns false if the caller should report no output. Drops the lock
+ * while sleeping.
+ */
+static bool waitHeadReady(FakeMppCtx *ctx, std::unique_lock<std::mutex> &lock) {
+    RK_S64 waitUs = ctx->tasks.front().readyUs - nowUs();
+
+    if (waitUs <= 0) {
+        return true;
+    }
+    if (ctx->timeout == MPP_POLL_NON_BLOCK) {
+        return false;
+    }
+    if (ctx->timeout > 0 && waitUs > (RK_S64)ctx->timeout * 1000) {
+        lock.unlock();
+        usleep(ctx->timeout * 1000);
+        lock.lock();
+        return false;
+    }
+
+    lock.unlock();
+    usleep(waitUs);
+    lock.lock();
+
+    return !ctx->tasks.empty();
+}
+
+/* decoder model */
+static void decSetFrameInfo(FakeMppCtx *ctx, MppFrame frame) {
+    ctx->width     = mpp_frame_get_width(frame);
+    ctx->height    = mpp_frame_get_height(frame);
+    ctx->fmt       = mpp_frame_get_fmt(frame);
+    ctx->horStride = FAKE_MPP_ALIGN(ctx->width, 16);
+    ctx->verStride = FAKE_MPP_ALIGN(ctx->height, 16);
+
+    mpp_frame_set_hor_stride(frame, ctx->horStride);
+    mpp_frame_set_ver_stride(frame, ctx->verStride);
+}
+
+static MppFrame decNewFrame(FakeMppCtx *ctx) {
+    MppFrame frame = nullptr;
+
+    mpp_frame_init(&frame);
+    mpp_frame_set_width(frame, ctx->width);
+    mpp_frame_set_height(frame, ctx->height);
+    mpp_frame_set_hor_stride(frame, ctx->horStride);
+    mpp_frame_set_ver_stride(frame, ctx->verStride);
+    mpp_frame_set_fmt(frame, ctx->fmt);
+    /* nv12 size, the decoder sizes its shared pool from the info change */
+    mpp_frame_set_buf_size(frame, ctx->horStride * ctx->verStride * 3 / 2);
+
+    return frame;
+}
+
+static MPP_RET fakeDecodePutPacket(MppCtx mppCtx, MppPacket packet) {
+    FakeMppCtx *ctx = (FakeMppCtx *)mppCtx;
+    FakeMppPacket *p = (FakeMppPacket *)packet;
+
+    if (!ctx || !p) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    std::lock_guard<std::mutex> lock(ctx->lock);
+
+    bool eos = (p->flag & FAKE_MPP_PACKET_FLAG_EOS) != 0;
+    bool extra = (p->flag & FAKE_MPP_PACKET_FLAG_EXTRA) != 0;
+
+    /* codec config and empty packets produce no picture */
+    if (!eos && (extra || !p->length)) {
+        return MPP_OK;
+    }
+
+    if (ctx->tasks.size() >= ctx->inputQueueMax) {
+        return MPP_NOK;
+    }
+
+    FakeMppTask task;
+    task.pts     = p->pts;
+    task.readyUs = nowUs() + ctx->latencyUs;
+    task.picture = !extra && p->length > 0;
+    task.eos     = eos;
+    task.intra   = false;
+    ctx->tasks.push_back(task);
+
+    return MPP_OK;
+}
+
+static MPP_RET fakeDecodeGetFrame(MppCtx mppCtx, MppFrame *frame) {
+    FakeMppCtx *ctx = (FakeMppCtx *)mppCtx;
+
+    if (!ctx || !frame) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    *frame = nullptr;
+
+    std::unique_lock<std::mutex> lock(ctx->lock);
+
+    if (ctx->infoChangeWait || ctx->tasks.empty()) {
+        return MPP_OK;
+    }
+
+    FakeMppTask &head = ctx->tasks.front();
+    if (head.picture && (!ctx->infoChangeDone ||
+            (ctx->infoChangeFrames &&
+             ctx->picSinceInfoChange >= ctx->infoChangeFrames))) {
+        MppFrame f = decNewFrame(ctx);
+        mpp_frame_set_info_change(f, 1);
+        ctx->infoChangeDone = true;
+        ctx->infoChangeWait = true;
+        ctx->picSinceInfoChange = 0;
+        *frame = f;
+        return MPP_OK;
+    }
+
+    if (!waitHeadReady(ctx, lock)) {
+        return MPP_OK;
+    }
+
+    FakeMppTask task = ctx->tasks.front();
+    FakeMppBuffer *buf = nullptr;
+
+    if (task.picture) {
+        size_t size = ctx->horStride * ctx->verStride * 3 / 2;
+
+        buf = ctx->extGroup ? fake_mpp_buffer_group_take(ctx->extGroup)
+                            : fake_mpp_buffer_alloc(size);
+        if (!buf) {
+            /* wait for the caller to return output buffers */
+            return MPP_OK;
+        }
+    }
+
+    ctx->tasks.pop_front();
+
+    MppFrame f = decNewFrame(ctx);
+    mpp_frame_set_pts(f, task.pts);
+    mpp_frame_set_eos(f, task.eos);
+    if (buf) {
+        /* frame takes over the reference from take/alloc */
+        ((FakeMppFrame *)f)->buffer = buf;
+        ctx->picSinceInfoChange++;
+    }
+    *frame = f;
+
+    return MPP_OK;
+}
+
+/* encoder model */
+static size_t encPacketSize(FakeMppCtx *ctx, bool intra) {
+    auto &cfg = ctx->encCfg.values;
+    RK_S64 bps = cfg.count("rc:bps_target") ? cfg["rc:bps_target"] : 4000000;
+    RK_S64 num = cfg.count("rc:fps_out_num") ? cfg["rc:fps_out_num"] : 30;
+    RK_S64 den = cfg.count("rc:fps_out_denorm") ? cfg["rc:fps_out_denorm"] : 1;
+    size_t size = 0;
+
+    if (num <= 0 || den <= 0) {
+        num = 30;
+        den = 1;
+    }
+
+    size = (size_t)(bps * den / num / 8);
+    if (intra) {
+        size *= 4;
+    }
+
+    return size < 16 ? 16 : size;
+}
+
+static void encFillNal(FakeMppCtx *ctx, uint8_t *data, size_t size, bool intra) {
+    memset(data, 0, size);
+
+    /* annex-b start code with a plausible nal header */
+    data[3] = 0x01;
+    if (ctx->coding == MPP_VIDEO_CodingHEVC) {
+        data[4] = intra ? 0x26 : 0x02;
+        data[5] = 0x01;
+    } else {
+        data[4] = intra ? 0x65 : 0x41;
+    }
+}
+
+static MPP_RET fakeEncodePutFrame(MppCtx mppCtx, MppFrame frame) {
+    FakeMppCtx *ctx = (FakeMppCtx *)mppCtx;
+    FakeMppFrame *f = (FakeMppFrame *)frame;
+
+    if (!ctx || !f) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    std::lock_guard<std::mutex> lock(ctx->lock);
+
+    if (ctx->tasks.size() >= ctx->inputQueueMax) {
+        return MPP_NOK;
+    }
+
+    RK_S32 idrReq = 0;
+    if (f->meta) {
+        mpp_meta_get_s32(f->meta, KEY_INPUT_IDR_REQ, &idrReq);
+    }
+
+    auto &cfg = ctx->encCfg.values;
+    RK_S64 gop = cfg.count("rc:gop") ? cfg["rc:gop"] : 0;
+
+    FakeMppTask task;
+    task.pts     = f->pts;
+    task.readyUs = nowUs() + ctx->latencyUs;
+    task.picture = f->buffer != nullptr;
+    task.eos     = f->eos != 0;
+    task.intra   = task.picture &&
+                   (ctx->frameCount == 0 || ctx->idrRequest || idrReq ||
+                    (gop > 0 && ctx->frameCount % gop == 0));
+    ctx->tasks.push_back(task);
+
+    if (task.picture) {
+        if (task.intra) {
+            ctx->idrRequest = false;
+        }
+        ctx->frameCount++;
+    }
+
+    return MPP_OK;
+}
+
+static MPP_RET fakeEncodeGetPacket(MppCtx mppCtx, MppPacket *packet) {
+    FakeMppCtx *ctx = (FakeMppCtx *)mppCtx;
+
+    if (!ctx || !packet) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    *packet = nullptr;
+
+    std::unique_lock<std::mutex> lock(ctx->lock);
+
+    if (ctx->tasks.empty() || !waitHeadReady(ctx, lock)) {
+        return MPP_ERR_TIMEOUT;
+    }
+
+    FakeMppTask task = ctx->tasks.front();
+    ctx->tasks.pop_front();
+
+    size_t size = task.picture ? encPacketSize(ctx, task.intra) : 0;
+    void *data = malloc(size ? size : 1);
+    if (!data) {
+        return MPP_ERR_MALLOC;
+    }
+    if (size) {
+        encFillNal(ctx, (uint8_t *)data, size, task.intra);
+    }
+
+    MppPacket p = nullptr;
+    mpp_packet_init(&p, data, size);
+    ((FakeMppPacket *)p)->allocated = true;
+    mpp_packet_set_pts(p, task.pts);
+    if (task.eos) {
+        mpp_packet_set_eos(p);
+    }
+    if (task.picture) {
+        mpp_meta_set_s32(mpp_packet_get_meta(p), KEY_OUTPUT_INTRA, task.intra);
+    }
+    *packet = p;
+
+    return MPP_OK;
+}
+
+static MPP_RET encGetHdr(FakeMppCtx *ctx, MppPacket packet) {
+    static const uint8_t kAvcHdr[] = {
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1f,
+        0x00, 0x00, 0x00, 0x01, 0x68, 0xce, 0x38, 0x80,
+    };
+    static const uint8_t kHevcHdr[] = {
+        0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01,
+        0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01,
+        0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc1, 0x72,
+    };
+    FakeMppPacket *p = (FakeMppPacket *)packet;
+    const uint8_t *hdr = kAvcHdr;
+    size_t size = sizeof(kAvcHdr);
+
+    if (!p) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    if (ctx->coding == MPP_VIDEO_CodingHEVC) {
+        hdr = kHevcHdr;
+        size = sizeof(kHevcHdr);
+    }
+    if (p->size < size) {
+        return MPP_NOK;
+    }
+
+    memcpy(p->data, hdr, size);
+    p->pos = p->data;
+    p->length = size;
+
+    return MPP_OK;
+}
+
+/* common */
+static MPP_RET fakeReset(MppCtx mppCtx) {
+    FakeMppCtx *ctx = (FakeMppCtx *)mppCtx;
+
+    if (!ctx) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    std::lock_guard<std::mutex> lock(ctx->lock);
+    ctx->tasks.clear();
+
+    return MPP_OK;
+}
+
+static MPP_RET fakeControl(MppCtx mppCtx, MpiCmd cmd, MppParam param) {
+    FakeMppCtx *ctx = (FakeMppCtx *)mppCtx;
+
+    if (!ctx) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    std::lock_guard<std::mutex> lock(ctx->lock);
+
+    switch (cmd) {
+    case MPP_SET_OUTPUT_TIMEOUT: {
+        if (param) {
+            ctx->timeout = *(MppPollType *)param;
+        }
+    } break;
+    case MPP_DEC_SET_FRAME_INFO: {
+        if (param) {
+            decSetFrameInfo(ctx, (MppFrame)param);
+        }
+    } break;
+    case MPP_DEC_SET_EXT_BUF_GROUP: {
+        ctx->extGroup = (FakeMppBufferGroup *)param;
+    } break;
+    case MPP_DEC_SET_INFO_CHANGE_READY: {
+        ctx->infoChangeWait = false;
+    } break;
+    case MPP_ENC_SET_CFG: {
+        if (param) {
+            for (auto &it : ((FakeMppEncCfg *)param)->values) {
+                ctx->encCfg.values[it.first] = it.second;
+            }
+        }
+    } break;
+    case MPP_ENC_GET_CFG: {
+        if (param) {
+            ((FakeMppEncCfg *)param)->values = ctx->encCfg.values;
+        }
+    } break;
+    case MPP_ENC_SET_IDR_FRAME: {
+        ctx->idrRequest = true;
+    } break;
+    case MPP_ENC_GET_HDR_SYNC: {
+        return encGetHdr(ctx, (MppPacket)param);
+    } break;
+    default: {
+        /* everything else is accepted and ignored */
+    } break;
+    }
+
+    return MPP_OK;
+}
+
+/* single-shot, isp and task interfaces are not modelled */
+static MPP_RET fakeDecode(MppCtx, MppPacket, MppFrame *) { return MPP_NOK; }
+static MPP_RET fakeEncode(MppCtx, MppFrame, MppPacket *) { return MPP_NOK; }
+static MPP_RET fakeIsp(MppCtx, MppFrame, MppFrame) { return MPP_NOK; }
+static MPP_RET fakeIspPutFrame(MppCtx, MppFrame) { return MPP_NOK; }
+static MPP_RET fakeIspGetFrame(MppCtx, MppFrame *) { return MPP_NOK; }
+static MPP_RET fakePoll(MppCtx, MppPortType, MppPollType) { return MPP_NOK; }
+static MPP_RET fakeDequeue(MppCtx, MppPortType, MppTask *) { return MPP_NOK; }
+static MPP_RET fakeEnqueue(MppCtx, MppPortType, MppTask) { return MPP_NOK; }
+
+static MppApi gFakeMppApi = {
+    sizeof(MppApi),
+    0,
+    fakeDecode,
+    fakeDecodePutPacket,
+    fakeDecodeGetFrame,
+    fakeEncode,
+    fakeEncodePutFrame,
+    fakeEncodeGetPacket,
+    fakeIsp,
+    fakeIspPutFrame,
+    fakeIspGetFrame,
+    fakePoll,
+    fakeDequeue,
+    fakeEnqueue,
+    fakeReset,
+    fakeControl,
+    { 0 },
+};
+
+MPP_RET mpp_create(MppCtx *ctx, MppApi **mpi) {
+    if (!ctx || !mpi) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    FakeMppCtx *c = new FakeMppCtx;
+    c->type       = MPP_CTX_BUTT;
+    c->coding     = MPP_VIDEO_CodingUnused;
+    c->inited     = false;
+    c->timeout    = MPP_POLL_NON_BLOCK;
+    c->extGroup   = nullptr;
+    c->width      = (RK_U32)getEnv("FAKE_MPP_DEC_WIDTH", 1920);
+    c->height     = (RK_U32)getEnv("FAKE_MPP_DEC_HEIGHT", 1080);
+    c->horStride  = FAKE_MPP_ALIGN(c->width, 16);
+    c->verStride  = FAKE_MPP_ALIGN(c->height, 16);
+    c->fmt        = MPP_FMT_YUV420SP;
+    c->infoChangeDone = false;
+    c->infoChangeWait = false;
+    c->picSinceInfoChange = 0;
+    c->idrRequest = false;
+    c->frameCount = 0;
+    c->latencyUs  = 0;
+    c->infoChangeFrames = (RK_U32)getEnv("FAKE_MPP_INFO_CHANGE_FRAMES", 0);
+    c->inputQueueMax = (RK_U32)getEnv("FAKE_MPP_INPUT_QUEUE", 4);
+
+    *ctx = c;
+    *mpi = &gFakeMppApi;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_init(MppCtx ctx, MppCtxType type, MppCodingType coding) {
+    FakeMppCtx *c = (FakeMppCtx *)ctx;
+
+    if (!c) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    c->type   = type;
+    c->coding = coding;
+    c->inited = true;
+    c->latencyUs = getEnv((type == MPP_CTX_DEC) ? "FAKE_MPP_DEC_LATENCY_US"
+                                                : "FAKE_MPP_ENC_LATENCY_US", 0);
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_destroy(MppCtx ctx) {
+    delete (FakeMppCtx *)ctx;
+    return MPP_OK;
+}
+
+MPP_RET mpp_check_support_format(MppCtxType type, MppCodingType coding) {
+    (void)type; (void)coding;
+    return MPP_OK;
+}
+
+void mpp_show_support_format(void) {
+}
+
+/* soc info, reported as a capable chip so that every path is reachable */
+static const MppSocInfo gFakeSocInfo = {
+    "rockchip,fake",
+    ROCKCHIP_SOC_RK3588,
+    0xffffffff,
+    { nullptr, nullptr, nullptr, nullptr },
+    { nullptr, nullptr, nullptr, nullptr },
+};
+
+const char *mpp_get_soc_name(void) {
+    return gFakeSocInfo.compatible;
+}
+
+RockchipSocType mpp_get_soc_type(void) {
+    return gFakeSocInfo.soc_type;
+}
+
+RK_U32 mpp_get_vcodec_type(void) {
+    return gFakeSocInfo.vcodec_type;
+}
+
+const MppSocInfo *mpp_get_soc_info(void) {
+    return &gFakeSocInfo;
+}
+
+RK_U32 mpp_check_soc_cap(MppCtxType type, MppCodingType coding) {
+    (void)type; (void)coding;
+    return 1;
+}
@@ -0,0 +1,389 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <mutex>
+
+#include "FakeMppInternal.h"
+
+/*
+ * Buffer and group bookkeeping of the fake backend. External groups keep
+ * committed buffers until the decoder model takes them, internal buffers
+ * are plain heap memory. A single lock covers all reference counts.
+ */
+static std::mutex gBufferLock;
+
+static void freeBuffer(FakeMppBuffer *buf) {
+    if (buf->mapped) {
+        munmap(buf->ptr, buf->size);
+    } else if (buf->allocated) {
+        free(buf->ptr);
+    }
+    delete buf;
+}
+
+static FakeMppBuffer *newBuffer(FakeMppBufferGroup *group, MppBufferType type) {
+    FakeMppBuffer *buf = new FakeMppBuffer;
+
+    memset(buf, 0, sizeof(*buf));
+    buf->group = group;
+    buf->type  = type;
+    buf->fd    = -1;
+    buf->index = -1;
+
+    if (group) {
+        group->buffers.push_back(buf);
+    }
+
+    return buf;
+}
+
+/* call with gBufferLock held */
+static void releaseBufferLocked(FakeMppBuffer *buf) {
+    if (buf->ref > 0 || (buf->group && !buf->discard)) {
+        return;
+    }
+
+    if (buf->group) {
+        buf->group->buffers.remove(buf);
+    }
+    freeBuffer(buf);
+}
+
+FakeMppBuffer *fake_mpp_buffer_group_take(FakeMppBufferGroup *group) {
+    std::lock_guard<std::mutex> lock(gBufferLock);
+
+    for (FakeMppBuffer *buf : group->buffers) {
+        if (buf->ref == 0 && !buf->discard) {
+            buf->ref = 1;
+            return buf;
+        }
+    }
+
+    return nullptr;
+}
+
+FakeMppBuffer *fake_mpp_buffer_alloc(size_t size) {
+    FakeMppBuffer *buf = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(gBufferLock);
+        buf = newBuffer(nullptr, MPP_BUFFER_TYPE_NORMAL);
+    }
+
+    buf->ptr = calloc(1, size);
+    if (!buf->ptr) {
+        delete buf;
+        return nullptr;
+    }
+    buf->size = size;
+    buf->allocated = true;
+    buf->ref = 1;
+
+    return buf;
+}
+
+MPP_RET mpp_buffer_import_with_tag(MppBufferGroup group, MppBufferInfo *info, MppBuffer *buffer,
+                                   const char *tag, const char *caller) {
+    (void)tag; (void)caller;
+
+    if (!info || (info->fd < 0 && !info->ptr)) {
+        fake_mpp_err("invalid import info");
+        return MPP_ERR_NULL_PTR;
+    }
+
+    std::lock_guard<std::mutex> lock(gBufferLock);
+
+    FakeMppBuffer *buf = newBuffer((FakeMppBufferGroup *)group, info->type);
+    buf->fd    = info->fd;
+    buf->ptr   = info->ptr;
+    buf->size  = info->size;
+    buf->index = info->index;
+
+    /* commit leaves the buffer unused in group, import hands it out */
+    if (buffer) {
+        buf->ref = 1;
+        *buffer = buf;
+    }
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_buffer_get_with_tag(MppBufferGroup group, MppBuffer *buffer, size_t size,
+                                const char *tag, const char *caller) {
+    FakeMppBufferGroup *grp = (FakeMppBufferGroup *)group;
+    (void)tag; (void)caller;
+
+    if (!buffer || !size) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    *buffer = nullptr;
+
+    if (grp) {
+        std::lock_guard<std::mutex> lock(gBufferLock);
+
+        for (FakeMppBuffer *buf : grp->buffers) {
+            if (buf->ref == 0 && !buf->discard && buf->size >= size) {
+                buf->ref = 1;
+                *buffer = buf;
+                return MPP_OK;
+            }
+        }
+        if (grp->mode == MPP_BUFFER_EXTERNAL) {
+            return MPP_NOK;
+        }
+    }
+
+    FakeMppBuffer *buf = fake_mpp_buffer_alloc(size);
+    if (!buf) {
+        return MPP_ERR_MALLOC;
+    }
+
+    if (grp) {
+        std::lock_guard<std::mutex> lock(gBufferLock);
+        buf->group = grp;
+        buf->type  = grp->type;
+        grp->buffers.push_back(buf);
+    }
+
+    *buffer = buf;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_buffer_put_with_caller(MppBuffer buffer, const char *caller) {
+    FakeMppBuffer *buf = (FakeMppBuffer *)buffer;
+
+    if (!buf) {
+        fake_mpp_err("put null buffer from %s", caller);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    std::lock_guard<std::mutex> lock(gBufferLock);
+
+    if (buf->ref <= 0) {
+        fake_mpp_err("buffer %p ref underflow from %s", buf, caller);
+        return MPP_NOK;
+    }
+
+    buf->ref--;
+    releaseBufferLocked(buf);
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_buffer_inc_ref_with_caller(MppBuffer buffer, const char *caller) {
+    FakeMppBuffer *buf = (FakeMppBuffer *)buffer;
+    (void)caller;
+
+    if (!buf) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    std::lock_guard<std::mutex> lock(gBufferLock);
+    buf->ref++;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_buffer_info_get_with_caller(MppBuffer buffer, MppBufferInfo *info, const char *caller) {
+    FakeMppBuffer *buf = (FakeMppBuffer *)buffer;
+    (void)caller;
+
+    if (!buf || !info) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    memset(info, 0, sizeof(*info));
+    info->type  = buf->type;
+    info->size  = buf->size;
+    info->ptr   = buf->ptr;
+    info->fd    = buf->fd;
+    info->index = buf->index;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_buffer_read_with_caller(MppBuffer buffer, size_t offset, void *data, size_t size, const char *caller) {
+    void *ptr = mpp_buffer_get_ptr_with_caller(buffer, caller);
+
+    if (!ptr || offset + size > ((FakeMppBuffer *)buffer)->size) {
+        return MPP_NOK;
+    }
+    memcpy(data, (uint8_t *)ptr + offset, size);
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_buffer_write_with_caller(MppBuffer buffer, size_t offset, void *data, size_t size, const char *caller) {
+    void *ptr = mpp_buffer_get_ptr_with_caller(buffer, caller);
+
+    if (!ptr || offset + size > ((FakeMppBuffer *)buffer)->size) {
+        return MPP_NOK;
+    }
+    memcpy((uint8_t *)ptr + offset, data, size);
+
+    return MPP_OK;
+}
+
+void *mpp_buffer_get_ptr_with_caller(MppBuffer buffer, const char *caller) {
+    FakeMppBuffer *buf = (FakeMppBuffer *)buffer;
+    (void)caller;
+
+    if (!buf) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(gBufferLock);
+
+    /* imported dma-buf, map on first cpu access */
+    if (!buf->ptr && buf->fd >= 0 && buf->size) {
+        void *ptr = mmap(nullptr, buf->size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, buf->fd, 0);
+        if (ptr == MAP_FAILED) {
+            fake_mpp_err("failed to map fd %d size %zu", buf->fd, buf->size);
+            return nullptr;
+        }
+        buf->ptr = ptr;
+        buf->mapped = true;
+    }
+
+    return buf->ptr;
+}
+
+int mpp_buffer_get_fd_with_caller(MppBuffer buffer, const char *caller) {
+    (void)caller;
+    return buffer ? ((FakeMppBuffer *)buffer)->fd : -1;
+}
+
+size_t mpp_buffer_get_size_with_caller(MppBuffer buffer, const char *caller) {
+    (void)caller;
+    return buffer ? ((FakeMppBuffer *)buffer)->size : 0;
+}
+
+int mpp_buffer_get_index_with_caller(MppBuffer buffer, const char *caller) {
+    (void)caller;
+    return buffer ? ((FakeMppBuffer *)buffer)->index : -1;
+}
+
+MPP_RET mpp_buffer_set_index_with_caller(MppBuffer buffer, int index, const char *caller) {
+    (void)caller;
+
+    if (!buffer) {
+        return MPP_ERR_NULL_PTR;
+    }
+    ((FakeMppBuffer *)buffer)->index = index;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_buffer_group_get(MppBufferGroup *group, MppBufferType type, MppBufferMode mode,
+                             const char *tag, const char *caller) {
+    (void)tag; (void)caller;
+
+    if (!group) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    FakeMppBufferGroup *grp = new FakeMppBufferGroup;
+    grp->type = type;
+    grp->mode = mode;
+    *group = grp;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_buffer_group_clear(MppBufferGroup group) {
+    FakeMppBufferGroup *grp = (FakeMppBufferGroup *)group;
+
+    if (!grp) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    std::lock_guard<std::mutex> lock(gBufferLock);
+
+    /* buffers still referenced are detached and freed on their last put */
+    while (!grp->buffers.empty()) {
+        FakeMppBuffer *buf = grp->buffers.front();
+        grp->buffers.pop_front();
+        buf->group = nullptr;
+        buf->discard = true;
+        releaseBufferLocked(buf);
+    }
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_buffer_group_put(MppBufferGroup group) {
+    MPP_RET ret = mpp_buffer_group_clear(group);
+
+    if (ret == MPP_OK) {
+        delete (FakeMppBufferGroup *)group;
+    }
+
+    return ret;
+}
+
+RK_S32 mpp_buffer_group_unused(MppBufferGroup group) {
+    FakeMppBufferGroup *grp = (FakeMppBufferGroup *)group;
+    RK_S32 count = 0;
+
+    if (!grp) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(gBufferLock);
+    for (FakeMppBuffer *buf : grp->buffers) {
+        if (buf->ref == 0) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+size_t mpp_buffer_group_usage(MppBufferGroup group) {
+    FakeMppBufferGroup *grp = (FakeMppBufferGroup *)group;
+    size_t usage = 0;
+
+    if (!grp) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(gBufferLock);
+    for (FakeMppBuffer *buf : grp->buffers) {
+        usage += buf->size;
+    }
+
+    return usage;
+}
+
+MppBufferMode mpp_buffer_group_mode(MppBufferGroup group) {
+    return group ? ((FakeMppBufferGroup *)group)->mode : MPP_BUFFER_MODE_BUTT;
+}
+
+MppBufferType mpp_buffer_group_type(MppBufferGroup group) {
+    return group ? ((FakeMppBufferGroup *)group)->type : MPP_BUFFER_TYPE_BUTT;
+}
+
+MPP_RET mpp_buffer_group_limit_config(MppBufferGroup group, size_t size, RK_S32 count) {
+    (void)group; (void)size; (void)count;
+    return MPP_OK;
+}
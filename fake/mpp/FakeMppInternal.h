@@ -0,0 +1,133 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_C2_RK_FAKE_MPP_INTERNAL_H__
+#define ANDROID_C2_RK_FAKE_MPP_INTERNAL_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <map>
+#include <list>
+#include <string>
+
+#include "rk_mpi.h"
+#include "mpp_buffer.h"
+#include "mpp_frame.h"
+#include "mpp_packet.h"
+#include "mpp_meta.h"
+
+#define fake_mpp_err(fmt, ...) \
+    fprintf(stderr, "fake_mpp: %s: " fmt "\n", __FUNCTION__, ##__VA_ARGS__)
+
+/*
+ * Object layouts of the fake backend. Handles handed out to the caller are
+ * plain pointers to these structs, the same way libmpp hides its own.
+ */
+struct FakeMppBufferGroup;
+
+struct FakeMppBuffer {
+    FakeMppBufferGroup *group;
+    MppBufferType       type;
+    int32_t             ref;
+    int32_t             fd;
+    int32_t             index;
+    size_t              size;
+    void               *ptr;
+    bool                allocated;  /* ptr malloced by us */
+    bool                mapped;     /* ptr mmaped from fd */
+    bool                discard;    /* group cleared while in use */
+};
+
+struct FakeMppBufferGroup {
+    MppBufferType             type;
+    MppBufferMode             mode;
+    std::list<FakeMppBuffer*> buffers;
+};
+
+struct FakeMppMetaValue {
+    MppMetaType     type;
+    union {
+        RK_S32  s32;
+        RK_S64  s64;
+        void   *ptr;
+    };
+};
+
+struct FakeMppMeta {
+    std::map<RK_S32, FakeMppMetaValue> values;
+};
+
+struct FakeMppFrame {
+    RK_U32              width;
+    RK_U32              height;
+    RK_U32              horStride;
+    RK_U32              verStride;
+    RK_U32              horStridePixel;
+    RK_U32              offsetX;
+    RK_U32              offsetY;
+    RK_U32              mode;
+    RK_U32              discard;
+    RK_U32              viewid;
+    RK_U32              poc;
+    RK_S64              pts;
+    RK_S64              dts;
+    RK_U32              errinfo;
+    size_t              bufSize;
+    RK_U32              eos;
+    RK_U32              infoChange;
+    MppFrameFormat      fmt;
+    MppFrameColorRange  colorRange;
+    MppFrameColorPrimaries colorPrimaries;
+    MppFrameColorTransferCharacteristic colorTrc;
+    MppFrameColorSpace  colorSpace;
+    MppFrameChromaLocation chromaLocation;
+    MppFrameRational    sar;
+    MppFrameMasteringDisplayMetadata masteringDisplay;
+    MppFrameContentLightMetadata contentLight;
+    MppBuffer           buffer;
+    MppMeta             meta;
+};
+
+#define FAKE_MPP_PACKET_FLAG_EOS    (0x00000001)
+#define FAKE_MPP_PACKET_FLAG_EXTRA  (0x00000002)
+
+struct FakeMppPacket {
+    void       *data;
+    void       *pos;
+    size_t      size;
+    size_t      length;
+    RK_S64      pts;
+    RK_S64      dts;
+    RK_U32      flag;
+    MppBuffer   buffer;
+    MppMeta     meta;
+    bool        allocated;  /* data malloced by us */
+};
+
+/* shared by the encoder model and mpp_enc_cfg_* */
+struct FakeMppEncCfg {
+    std::map<std::string, RK_S64> values;
+};
+
+/*
+ * Buffer helpers used by the codec models: take an unused buffer from an
+ * external group, or allocate one from the internal pool.
+ */
+FakeMppBuffer *fake_mpp_buffer_group_take(FakeMppBufferGroup *group);
+FakeMppBuffer *fake_mpp_buffer_alloc(size_t size);
+
+#endif  // ANDROID_C2_RK_FAKE_MPP_INTERNAL_H__
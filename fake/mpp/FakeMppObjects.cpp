@@ -0,0 +1,597 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "FakeMppInternal.h"
+#include "rk_venc_cfg.h"
+#include "rk_venc_ref.h"
+
+/*
+ * MppFrame / MppPacket / MppMeta / MppEncCfg / MppEncRefCfg objects of the
+ * fake backend. They only hold values, no hardware state.
+ */
+
+/* MppMeta */
+MPP_RET mpp_meta_get_with_tag(MppMeta *meta, const char *tag, const char *caller) {
+    (void)tag; (void)caller;
+
+    if (!meta) {
+        return MPP_ERR_NULL_PTR;
+    }
+    *meta = new FakeMppMeta;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_meta_put(MppMeta meta) {
+    delete (FakeMppMeta *)meta;
+    return MPP_OK;
+}
+
+RK_S32 mpp_meta_size(MppMeta meta) {
+    return meta ? (RK_S32)((FakeMppMeta *)meta)->values.size() : 0;
+}
+
+static MPP_RET metaSet(MppMeta meta, MppMetaKey key, const FakeMppMetaValue &val) {
+    if (!meta) {
+        return MPP_ERR_NULL_PTR;
+    }
+    ((FakeMppMeta *)meta)->values[key] = val;
+
+    return MPP_OK;
+}
+
+static MPP_RET metaGet(MppMeta meta, MppMetaKey key, MppMetaType type, FakeMppMetaValue *val) {
+    if (!meta) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    /* meta values are consumed on read like libmpp does */
+    FakeMppMeta *m = (FakeMppMeta *)meta;
+    auto it = m->values.find(key);
+    if (it == m->values.end() || it->second.type != type) {
+        return MPP_NOK;
+    }
+    *val = it->second;
+    m->values.erase(it);
+
+    return MPP_OK;
+}
+
+#define FAKE_META_ACCESSOR(name, vtype, field, ctype)                           \
+MPP_RET mpp_meta_set_##name(MppMeta meta, MppMetaKey key, ctype val) {          \
+    FakeMppMetaValue v;                                                         \
+    v.type = vtype;                                                             \
+    v.field = val;                                                              \
+    return metaSet(meta, key, v);                                               \
+}                                                                               \
+MPP_RET mpp_meta_get_##name(MppMeta meta, MppMetaKey key, ctype *val) {         \
+    FakeMppMetaValue v;                                                         \
+    MPP_RET ret = metaGet(meta, key, vtype, &v);                                \
+    if (ret == MPP_OK && val) {                                                 \
+        *val = (ctype)v.field;                                                  \
+    }                                                                           \
+    return ret;                                                                 \
+}
+
+FAKE_META_ACCESSOR(s32,    TYPE_S32,    s32, RK_S32)
+FAKE_META_ACCESSOR(s64,    TYPE_S64,    s64, RK_S64)
+FAKE_META_ACCESSOR(ptr,    TYPE_PTR,    ptr, void *)
+FAKE_META_ACCESSOR(frame,  TYPE_FRAME,  ptr, MppFrame)
+FAKE_META_ACCESSOR(packet, TYPE_PACKET, ptr, MppPacket)
+FAKE_META_ACCESSOR(buffer, TYPE_BUFFER, ptr, MppBuffer)
+
+/* MppFrame */
+MPP_RET mpp_frame_init(MppFrame *frame) {
+    if (!frame) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    FakeMppFrame *f = (FakeMppFrame *)calloc(1, sizeof(FakeMppFrame));
+    if (!f) {
+        return MPP_ERR_MALLOC;
+    }
+    *frame = f;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_frame_deinit(MppFrame *frame) {
+    if (!frame || !*frame) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    FakeMppFrame *f = (FakeMppFrame *)*frame;
+    if (f->buffer) {
+        mpp_buffer_put(f->buffer);
+    }
+    if (f->meta) {
+        mpp_meta_put(f->meta);
+    }
+    free(f);
+    *frame = nullptr;
+
+    return MPP_OK;
+}
+
+MppFrame mpp_frame_get_next(MppFrame frame) {
+    (void)frame;
+    return nullptr;
+}
+
+#define FAKE_FRAME_ACCESSOR(name, field, type)                                  \
+type mpp_frame_get_##name(const MppFrame frame) {                               \
+    return ((FakeMppFrame *)frame)->field;                                      \
+}                                                                               \
+void mpp_frame_set_##name(MppFrame frame, type val) {                           \
+    ((FakeMppFrame *)frame)->field = val;                                       \
+}
+
+FAKE_FRAME_ACCESSOR(width,              width,              RK_U32)
+FAKE_FRAME_ACCESSOR(height,             height,             RK_U32)
+FAKE_FRAME_ACCESSOR(hor_stride,         horStride,          RK_U32)
+FAKE_FRAME_ACCESSOR(ver_stride,         verStride,          RK_U32)
+FAKE_FRAME_ACCESSOR(hor_stride_pixel,   horStridePixel,     RK_U32)
+FAKE_FRAME_ACCESSOR(offset_x,           offsetX,            RK_U32)
+FAKE_FRAME_ACCESSOR(offset_y,           offsetY,            RK_U32)
+FAKE_FRAME_ACCESSOR(mode,               mode,               RK_U32)
+FAKE_FRAME_ACCESSOR(discard,            discard,            RK_U32)
+FAKE_FRAME_ACCESSOR(viewid,             viewid,             RK_U32)
+FAKE_FRAME_ACCESSOR(poc,                poc,                RK_U32)
+FAKE_FRAME_ACCESSOR(pts,                pts,                RK_S64)
+FAKE_FRAME_ACCESSOR(dts,                dts,                RK_S64)
+FAKE_FRAME_ACCESSOR(errinfo,            errinfo,            RK_U32)
+FAKE_FRAME_ACCESSOR(buf_size,           bufSize,            size_t)
+FAKE_FRAME_ACCESSOR(eos,                eos,                RK_U32)
+FAKE_FRAME_ACCESSOR(info_change,        infoChange,         RK_U32)
+FAKE_FRAME_ACCESSOR(color_range,        colorRange,         MppFrameColorRange)
+FAKE_FRAME_ACCESSOR(color_primaries,    colorPrimaries,     MppFrameColorPrimaries)
+FAKE_FRAME_ACCESSOR(color_trc,          colorTrc,           MppFrameColorTransferCharacteristic)
+FAKE_FRAME_ACCESSOR(colorspace,         colorSpace,         MppFrameColorSpace)
+FAKE_FRAME_ACCESSOR(chroma_location,    chromaLocation,     MppFrameChromaLocation)
+FAKE_FRAME_ACCESSOR(sar,                sar,                MppFrameRational)
+FAKE_FRAME_ACCESSOR(mastering_display,  masteringDisplay,   MppFrameMasteringDisplayMetadata)
+FAKE_FRAME_ACCESSOR(content_light,      contentLight,       MppFrameContentLightMetadata)
+
+MppFrameFormat mpp_frame_get_fmt(MppFrame frame) {
+    return ((FakeMppFrame *)frame)->fmt;
+}
+
+void mpp_frame_set_fmt(MppFrame frame, MppFrameFormat fmt) {
+    ((FakeMppFrame *)frame)->fmt = fmt;
+}
+
+MppBuffer mpp_frame_get_buffer(const MppFrame frame) {
+    return ((FakeMppFrame *)frame)->buffer;
+}
+
+void mpp_frame_set_buffer(MppFrame frame, MppBuffer buffer) {
+    FakeMppFrame *f = (FakeMppFrame *)frame;
+
+    if (f->buffer == buffer) {
+        return;
+    }
+    /* frame keeps its own reference like libmpp */
+    if (buffer) {
+        mpp_buffer_inc_ref(buffer);
+    }
+    if (f->buffer) {
+        mpp_buffer_put(f->buffer);
+    }
+    f->buffer = buffer;
+}
+
+RK_S32 mpp_frame_has_meta(const MppFrame frame) {
+    return ((FakeMppFrame *)frame)->meta != nullptr;
+}
+
+MppMeta mpp_frame_get_meta(const MppFrame frame) {
+    FakeMppFrame *f = (FakeMppFrame *)frame;
+
+    if (!f->meta) {
+        mpp_meta_get(&f->meta);
+    }
+
+    return f->meta;
+}
+
+void mpp_frame_set_meta(MppFrame frame, MppMeta meta) {
+    FakeMppFrame *f = (FakeMppFrame *)frame;
+
+    if (f->meta && f->meta != meta) {
+        mpp_meta_put(f->meta);
+    }
+    f->meta = meta;
+}
+
+/* MppPacket */
+MPP_RET mpp_packet_new(MppPacket *packet) {
+    if (!packet) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    FakeMppPacket *p = (FakeMppPacket *)calloc(1, sizeof(FakeMppPacket));
+    if (!p) {
+        return MPP_ERR_MALLOC;
+    }
+    *packet = p;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_packet_init(MppPacket *packet, void *data, size_t size) {
+    MPP_RET ret = mpp_packet_new(packet);
+
+    if (ret == MPP_OK) {
+        FakeMppPacket *p = (FakeMppPacket *)*packet;
+        p->data   = data;
+        p->pos    = data;
+        p->size   = size;
+        p->length = size;
+    }
+
+    return ret;
+}
+
+MPP_RET mpp_packet_init_with_buffer(MppPacket *packet, MppBuffer buffer) {
+    MPP_RET ret = mpp_packet_init(packet, mpp_buffer_get_ptr(buffer),
+                                  mpp_buffer_get_size(buffer));
+
+    if (ret == MPP_OK) {
+        mpp_buffer_inc_ref(buffer);
+        ((FakeMppPacket *)*packet)->buffer = buffer;
+    }
+
+    return ret;
+}
+
+MPP_RET mpp_packet_copy_init(MppPacket *packet, const MppPacket src) {
+    FakeMppPacket *s = (FakeMppPacket *)src;
+    void *data = nullptr;
+
+    if (!s) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    data = malloc(s->length ? s->length : 1);
+    if (!data) {
+        return MPP_ERR_MALLOC;
+    }
+    memcpy(data, s->pos, s->length);
+
+    MPP_RET ret = mpp_packet_init(packet, data, s->length);
+    if (ret != MPP_OK) {
+        free(data);
+        return ret;
+    }
+
+    FakeMppPacket *p = (FakeMppPacket *)*packet;
+    p->pts  = s->pts;
+    p->dts  = s->dts;
+    p->flag = s->flag;
+    p->allocated = true;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_packet_deinit(MppPacket *packet) {
+    if (!packet || !*packet) {
+        return MPP_ERR_NULL_PTR;
+    }
+
+    FakeMppPacket *p = (FakeMppPacket *)*packet;
+    if (p->buffer) {
+        mpp_buffer_put(p->buffer);
+    }
+    if (p->meta) {
+        mpp_meta_put(p->meta);
+    }
+    if (p->allocated) {
+        free(p->data);
+    }
+    free(p);
+    *packet = nullptr;
+
+    return MPP_OK;
+}
+
+void mpp_packet_set_data(MppPacket packet, void *data) {
+    ((FakeMppPacket *)packet)->data = data;
+}
+
+void mpp_packet_set_size(MppPacket packet, size_t size) {
+    ((FakeMppPacket *)packet)->size = size;
+}
+
+void mpp_packet_set_pos(MppPacket packet, void *pos) {
+    ((FakeMppPacket *)packet)->pos = pos;
+}
+
+void mpp_packet_set_length(MppPacket packet, size_t size) {
+    ((FakeMppPacket *)packet)->length = size;
+}
+
+void *mpp_packet_get_data(const MppPacket packet) {
+    return ((FakeMppPacket *)packet)->data;
+}
+
+void *mpp_packet_get_pos(const MppPacket packet) {
+    return ((FakeMppPacket *)packet)->pos;
+}
+
+size_t mpp_packet_get_size(const MppPacket packet) {
+    return ((FakeMppPacket *)packet)->size;
+}
+
+size_t mpp_packet_get_length(const MppPacket packet) {
+    return ((FakeMppPacket *)packet)->length;
+}
+
+void mpp_packet_set_pts(MppPacket packet, RK_S64 pts) {
+    ((FakeMppPacket *)packet)->pts = pts;
+}
+
+RK_S64 mpp_packet_get_pts(const MppPacket packet) {
+    return ((FakeMppPacket *)packet)->pts;
+}
+
+void mpp_packet_set_dts(MppPacket packet, RK_S64 dts) {
+    ((FakeMppPacket *)packet)->dts = dts;
+}
+
+RK_S64 mpp_packet_get_dts(const MppPacket packet) {
+    return ((FakeMppPacket *)packet)->dts;
+}
+
+void mpp_packet_set_flag(MppPacket packet, RK_U32 flag) {
+    ((FakeMppPacket *)packet)->flag = flag;
+}
+
+RK_U32 mpp_packet_get_flag(const MppPacket packet) {
+    return ((FakeMppPacket *)packet)->flag;
+}
+
+MPP_RET mpp_packet_set_eos(MppPacket packet) {
+    ((FakeMppPacket *)packet)->flag |= FAKE_MPP_PACKET_FLAG_EOS;
+    return MPP_OK;
+}
+
+MPP_RET mpp_packet_clr_eos(MppPacket packet) {
+    ((FakeMppPacket *)packet)->flag &= ~FAKE_MPP_PACKET_FLAG_EOS;
+    return MPP_OK;
+}
+
+RK_U32 mpp_packet_get_eos(MppPacket packet) {
+    return (((FakeMppPacket *)packet)->flag & FAKE_MPP_PACKET_FLAG_EOS) ? 1 : 0;
+}
+
+MPP_RET mpp_packet_set_extra_data(MppPacket packet) {
+    ((FakeMppPacket *)packet)->flag |= FAKE_MPP_PACKET_FLAG_EXTRA;
+    return MPP_OK;
+}
+
+void mpp_packet_set_buffer(MppPacket packet, MppBuffer buffer) {
+    FakeMppPacket *p = (FakeMppPacket *)packet;
+
+    if (buffer) {
+        mpp_buffer_inc_ref(buffer);
+    }
+    if (p->buffer) {
+        mpp_buffer_put(p->buffer);
+    }
+    p->buffer = buffer;
+}
+
+MppBuffer mpp_packet_get_buffer(const MppPacket packet) {
+    return ((FakeMppPacket *)packet)->buffer;
+}
+
+MPP_RET mpp_packet_read(MppPacket packet, size_t offset, void *data, size_t size) {
+    FakeMppPacket *p = (FakeMppPacket *)packet;
+
+    if (!p || !data || offset + size > p->size) {
+        return MPP_NOK;
+    }
+    memcpy(data, (uint8_t *)p->data + offset, size);
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_packet_write(MppPacket packet, size_t offset, void *data, size_t size) {
+    FakeMppPacket *p = (FakeMppPacket *)packet;
+
+    if (!p || !data || offset + size > p->size) {
+        return MPP_NOK;
+    }
+    memcpy((uint8_t *)p->data + offset, data, size);
+
+    return MPP_OK;
+}
+
+MppMeta mpp_packet_get_meta(const MppPacket packet) {
+    FakeMppPacket *p = (FakeMppPacket *)packet;
+
+    if (!p->meta) {
+        mpp_meta_get(&p->meta);
+    }
+
+    return p->meta;
+}
+
+/* MppEncCfg, kept as a name -> value table */
+MPP_RET mpp_enc_cfg_init(MppEncCfg *cfg) {
+    if (!cfg) {
+        return MPP_ERR_NULL_PTR;
+    }
+    *cfg = new FakeMppEncCfg;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_enc_cfg_deinit(MppEncCfg cfg) {
+    delete (FakeMppEncCfg *)cfg;
+    return MPP_OK;
+}
+
+#define FAKE_ENC_CFG_ACCESSOR(name, type)                                       \
+MPP_RET mpp_enc_cfg_set_##name(MppEncCfg cfg, const char *key, type val) {      \
+    if (!cfg || !key) {                                                         \
+        return MPP_ERR_NULL_PTR;                                                \
+    }                                                                           \
+    ((FakeMppEncCfg *)cfg)->values[key] = (RK_S64)val;                          \
+    return MPP_OK;                                                              \
+}                                                                               \
+MPP_RET mpp_enc_cfg_get_##name(MppEncCfg cfg, const char *key, type *val) {     \
+    if (!cfg || !key || !val) {                                                 \
+        return MPP_ERR_NULL_PTR;                                                \
+    }                                                                           \
+    auto &values = ((FakeMppEncCfg *)cfg)->values;                              \
+    auto it = values.find(key);                                                 \
+    *val = (it == values.end()) ? 0 : (type)it->second;                         \
+    return MPP_OK;                                                              \
+}
+
+FAKE_ENC_CFG_ACCESSOR(s32, RK_S32)
+FAKE_ENC_CFG_ACCESSOR(u32, RK_U32)
+FAKE_ENC_CFG_ACCESSOR(s64, RK_S64)
+FAKE_ENC_CFG_ACCESSOR(u64, RK_U64)
+
+MPP_RET mpp_enc_cfg_set_ptr(MppEncCfg cfg, const char *name, void *val) {
+    return mpp_enc_cfg_set_s64(cfg, name, (RK_S64)(intptr_t)val);
+}
+
+MPP_RET mpp_enc_cfg_get_ptr(MppEncCfg cfg, const char *name, void **val) {
+    RK_S64 v = 0;
+    MPP_RET ret = mpp_enc_cfg_get_s64(cfg, name, &v);
+
+    if (ret == MPP_OK && val) {
+        *val = (void *)(intptr_t)v;
+    }
+
+    return ret;
+}
+
+MPP_RET mpp_enc_cfg_set_st(MppEncCfg cfg, const char *name, void *val) {
+    (void)cfg; (void)name; (void)val;
+    return MPP_OK;
+}
+
+MPP_RET mpp_enc_cfg_get_st(MppEncCfg cfg, const char *name, void *val) {
+    (void)cfg; (void)name; (void)val;
+    return MPP_NOK;
+}
+
+void mpp_enc_cfg_show(void) {
+}
+
+/* MppEncRefCfg, only counts are tracked */
+struct FakeMppEncRefCfg {
+    RK_S32 ltCnt;
+    RK_S32 stCnt;
+    RK_S32 ltAdded;
+    RK_S32 stAdded;
+    RK_S32 keepCpb;
+};
+
+MPP_RET mpp_enc_ref_cfg_init(MppEncRefCfg *ref) {
+    if (!ref) {
+        return MPP_ERR_NULL_PTR;
+    }
+    *ref = calloc(1, sizeof(FakeMppEncRefCfg));
+
+    return *ref ? MPP_OK : MPP_ERR_MALLOC;
+}
+
+MPP_RET mpp_enc_ref_cfg_deinit(MppEncRefCfg *ref) {
+    if (!ref) {
+        return MPP_ERR_NULL_PTR;
+    }
+    free(*ref);
+    *ref = nullptr;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_enc_ref_cfg_reset(MppEncRefCfg ref) {
+    if (!ref) {
+        return MPP_ERR_NULL_PTR;
+    }
+    memset(ref, 0, sizeof(FakeMppEncRefCfg));
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_enc_ref_cfg_set_cfg_cnt(MppEncRefCfg ref, RK_S32 lt_cnt, RK_S32 st_cnt) {
+    FakeMppEncRefCfg *r = (FakeMppEncRefCfg *)ref;
+
+    if (!r) {
+        return MPP_ERR_NULL_PTR;
+    }
+    r->ltCnt = lt_cnt;
+    r->stCnt = st_cnt;
+    r->ltAdded = 0;
+    r->stAdded = 0;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_enc_ref_cfg_add_lt_cfg(MppEncRefCfg ref, RK_S32 cnt, MppEncRefLtFrmCfg *frm) {
+    FakeMppEncRefCfg *r = (FakeMppEncRefCfg *)ref;
+
+    if (!r || !frm || r->ltAdded + cnt > r->ltCnt) {
+        return MPP_ERR_VALUE;
+    }
+    r->ltAdded += cnt;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_enc_ref_cfg_add_st_cfg(MppEncRefCfg ref, RK_S32 cnt, MppEncRefStFrmCfg *frm) {
+    FakeMppEncRefCfg *r = (FakeMppEncRefCfg *)ref;
+
+    if (!r || !frm || r->stAdded + cnt > r->stCnt) {
+        return MPP_ERR_VALUE;
+    }
+    r->stAdded += cnt;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_enc_ref_cfg_check(MppEncRefCfg ref) {
+    FakeMppEncRefCfg *r = (FakeMppEncRefCfg *)ref;
+
+    if (!r || r->ltAdded != r->ltCnt || r->stAdded != r->stCnt) {
+        return MPP_NOK;
+    }
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_enc_ref_cfg_set_keep_cpb(MppEncRefCfg ref, RK_S32 keep) {
+    if (!ref) {
+        return MPP_ERR_NULL_PTR;
+    }
+    ((FakeMppEncRefCfg *)ref)->keepCpb = keep;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_enc_ref_cfg_show(MppEncRefCfg ref) {
+    (void)ref;
+    return MPP_OK;
+}
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef  ROCKCHIP_LOG_TAG
+#define ROCKCHIP_LOG_TAG    "C2RKRgaDefFake"
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "C2RKRgaDef.h"
+#include "C2RKLog.h"
+#include "hardware/hardware_rockchip.h"
+
+/*
+ * CPU stand-in of C2RKRgaDef for running without the RGA driver. Buffers
+ * are dma-buf (or memfd) fds mapped on every call, scaling is nearest
+ * neighbour and conversions between NV12 and RGB use BT.601 limited range. Link it ahead of
+ * libcodec2_rk_osal so that it replaces C2RKRgaDef.cpp.
+ */
+
+namespace {
+
+class FdMapping {
+public:
+    FdMapping(int32_t fd, size_t size)
+        : mSize(size), mPtr(MAP_FAILED) {
+        if (fd >= 0 && size) {
+            mPtr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        if (mPtr == MAP_FAILED) {
+            c2_err("failed to map fd %d size %zu", fd, size);
+        }
+    }
+
+    ~FdMapping() {
+        if (mPtr != MAP_FAILED) {
+            munmap(mPtr, mSize);
+        }
+    }
+
+    uint8_t *data() const {
+        return (mPtr == MAP_FAILED) ? nullptr : (uint8_t *)mPtr;
+    }
+
+private:
+    size_t mSize;
+    void  *mPtr;
+};
+
+/* bytes per pixel of packed rgb formats, 0 otherwise */
+int32_t getRgbBpp(int32_t format) {
+    switch (format) {
+    case HAL_PIXEL_FORMAT_RGBA_8888:
+    case HAL_PIXEL_FORMAT_RGBX_8888:
+    case HAL_PIXEL_FORMAT_BGRA_8888:
+        return 4;
+    case HAL_PIXEL_FORMAT_RGB_888:
+        return 3;
+    case HAL_PIXEL_FORMAT_RGB_565:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+size_t getBufferSize(const RgaParam &param, int32_t format) {
+    size_t pixels = (size_t)param.wstride * param.hstride;
+
+    if (format == HAL_PIXEL_FORMAT_YCrCb_NV12) {
+        return pixels * 3 / 2;
+    }
+    return pixels * getRgbBpp(format);
+}
+
+uint8_t clampU8(int32_t v) {
+    return (v < 0) ? 0 : ((v > 255) ? 255 : (uint8_t)v);
+}
+
+void scaleNv12(const uint8_t *src, const RgaParam &s, uint8_t *dst, const RgaParam &d) {
+    const uint8_t *srcUv = src + s.wstride * s.hstride;
+    uint8_t *dstUv = dst + d.wstride * d.hstride;
+
+    for (int32_t y = 0; y < d.height; y++) {
+        int32_t sy = s.top + y * s.height / d.height;
+        const uint8_t *srcRow = src + sy * s.wstride + s.left;
+        uint8_t *dstRow = dst + (d.top + y) * d.wstride + d.left;
+
+        if (s.width == d.width) {
+            memcpy(dstRow, srcRow, d.width);
+            continue;
+        }
+        for (int32_t x = 0; x < d.width; x++) {
+            dstRow[x] = srcRow[x * s.width / d.width];
+        }
+    }
+
+    for (int32_t y = 0; y < d.height / 2; y++) {
+        int32_t sy = s.top / 2 + y * s.height / d.height;
+        const uint8_t *srcRow = srcUv + sy * s.wstride + (s.left & ~1);
+        uint8_t *dstRow = dstUv + (d.top / 2 + y) * d.wstride + (d.left & ~1);
+
+        if (s.width == d.width) {
+            memcpy(dstRow, srcRow, d.width);
+            continue;
+        }
+        for (int32_t x = 0; x < d.width / 2; x++) {
+            int32_t sx = x * s.width / d.width;
+            dstRow[2 * x]     = srcRow[2 * sx];
+            dstRow[2 * x + 1] = srcRow[2 * sx + 1];
+        }
+    }
+}
+
+void rgbaToNv12(const uint8_t *src, const RgaParam &s, uint8_t *dst, const RgaParam &d) {
+    uint8_t *dstUv = dst + d.wstride * d.hstride;
+
+    for (int32_t y = 0; y < d.height; y++) {
+        int32_t sy = s.top + y * s.height / d.height;
+        const uint8_t *srcRow = src + (sy * s.wstride + s.left) * 4;
+        uint8_t *dstRow = dst + (d.top + y) * d.wstride + d.left;
+        uint8_t *uvRow = dstUv + ((d.top + y) / 2) * d.wstride + (d.left & ~1);
+
+        for (int32_t x = 0; x < d.width; x++) {
+            const uint8_t *p = srcRow + (x * s.width / d.width) * 4;
+            int32_t r = p[0], g = p[1], b = p[2];
+
+            dstRow[x] = clampU8(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            if (!(y & 1) && !(x & 1)) {
+                uvRow[x]     = clampU8(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+                uvRow[x + 1] = clampU8(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+            }
+        }
+    }
+}
+
+void nv12ToRgb(const uint8_t *src, const RgaParam &s,
+               uint8_t *dst, const RgaParam &d, int32_t format) {
+    const uint8_t *srcUv = src + s.wstride * s.hstride;
+    int32_t bpp = getRgbBpp(format);
+
+    for (int32_t y = 0; y < d.height; y++) {
+        int32_t sy = s.top + y * s.height / d.height;
+        const uint8_t *yRow = src + sy * s.wstride;
+        const uint8_t *uvRow = srcUv + (sy / 2) * s.wstride;
+        uint8_t *dstRow = dst + ((d.top + y) * d.wstride + d.left) * bpp;
+
+        for (int32_t x = 0; x < d.width; x++) {
+            int32_t sx = s.left + x * s.width / d.width;
+            int32_t c = 298 * (yRow[sx] - 16);
+            int32_t u = uvRow[sx & ~1] - 128;
+            int32_t v = uvRow[sx | 1] - 128;
+            uint8_t r = clampU8((c + 409 * v + 128) >> 8);
+            uint8_t g = clampU8((c - 100 * u - 208 * v + 128) >> 8);
+            uint8_t b = clampU8((c + 516 * u + 128) >> 8);
+            uint8_t *p = dstRow + x * bpp;
+
+            switch (format) {
+            case HAL_PIXEL_FORMAT_BGRA_8888:
+                p[0] = b; p[1] = g; p[2] = r; p[3] = 0xff;
+                break;
+            case HAL_PIXEL_FORMAT_RGB_565: {
+                uint16_t pixel = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+                memcpy(p, &pixel, 2);
+            } break;
+            default:
+                p[0] = r; p[1] = g; p[2] = b;
+                if (bpp == 4) {
+                    p[3] = 0xff;
+                }
+                break;
+            }
+        }
+    }
+}
+
+void scaleRgb(const uint8_t *src, const RgaParam &s,
+              uint8_t *dst, const RgaParam &d, int32_t bpp) {
+    for (int32_t y = 0; y < d.height; y++) {
+        int32_t sy = s.top + y * s.height / d.height;
+        const uint8_t *srcRow = src + (sy * s.wstride + s.left) * bpp;
+        uint8_t *dstRow = dst + ((d.top + y) * d.wstride + d.left) * bpp;
+
+        for (int32_t x = 0; x < d.width; x++) {
+            memcpy(dstRow + x * bpp, srcRow + (x * s.width / d.width) * bpp, bpp);
+        }
+    }
+}
+
+}  // namespace
+
+void C2RKRgaDef::paramInit(RgaParam *param, int32_t fd,
+                           int32_t width, int32_t height,
+                           int32_t wstride, int32_t hstride) {
+    memset(param, 0, sizeof(RgaParam));
+
+    param->fd = fd;
+    param->width = width;
+    param->height = height;
+    param->wstride = (wstride > 0) ? wstride : width;
+    param->hstride = (hstride > 0) ? hstride : height;
+}
+
+bool C2RKRgaDef::rgbToNv12(RgaParam srcParam, RgaParam dstParam) {
+    return blit(srcParam, HAL_PIXEL_FORMAT_RGBA_8888,
+                dstParam, HAL_PIXEL_FORMAT_YCrCb_NV12);
+}
+
+bool C2RKRgaDef::nv12Copy(RgaParam srcParam, RgaParam dstParam) {
+    return blit(srcParam, HAL_PIXEL_FORMAT_YCrCb_NV12,
+                dstParam, HAL_PIXEL_FORMAT_YCrCb_NV12);
+}
+
+bool C2RKRgaDef::blit(RgaParam srcParam, int32_t srcFormat,
+                      RgaParam dstParam, int32_t dstFormat) {
+    size_t srcSize = getBufferSize(srcParam, srcFormat);
+    size_t dstSize = getBufferSize(dstParam, dstFormat);
+
+    /* rgb sources are only scaled, or turned into nv12 from 32bit */
+    bool srcRgb = (srcFormat != HAL_PIXEL_FORMAT_YCrCb_NV12);
+    bool dstRgb = (dstFormat != HAL_PIXEL_FORMAT_YCrCb_NV12);
+    if (!srcSize || !dstSize ||
+            (srcRgb && dstRgb && srcFormat != dstFormat) ||
+            (srcRgb && !dstRgb && getRgbBpp(srcFormat) != 4)) {
+        c2_err("unsupported blit fmt 0x%x -> 0x%x", srcFormat, dstFormat);
+        return false;
+    }
+
+    FdMapping src(srcParam.fd, srcSize);
+    FdMapping dst(dstParam.fd, dstSize);
+    if (!src.data() || !dst.data()) {
+        return false;
+    }
+
+    if (dstFormat == HAL_PIXEL_FORMAT_YCrCb_NV12) {
+        if (srcFormat == HAL_PIXEL_FORMAT_YCrCb_NV12) {
+            scaleNv12(src.data(), srcParam, dst.data(), dstParam);
+        } else {
+            rgbaToNv12(src.data(), srcParam, dst.data(), dstParam);
+        }
+    } else if (srcFormat == HAL_PIXEL_FORMAT_YCrCb_NV12) {
+        nv12ToRgb(src.data(), srcParam, dst.data(), dstParam, dstFormat);
+    } else {
+        scaleRgb(src.data(), srcParam, dst.data(), dstParam, getRgbBpp(dstFormat));
+    }
+
+    return true;
+}
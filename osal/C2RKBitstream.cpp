@@ -0,0 +1,506 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef  ROCKCHIP_LOG_TAG
+#define ROCKCHIP_LOG_TAG    "C2RKBitstream"
+
+#include "C2RKBitstream.h"
+
+namespace {
+
+/* msb first reader, reads past the end return zero bits */
+class BitReader {
+public:
+    BitReader(const uint8_t *data, size_t size)
+        : mData(data), mBits(size * 8), mPos(0) {}
+
+    uint32_t read(uint32_t bits) {
+        uint32_t value = 0;
+        /* counting down would wrap, osal is built with unsigned overflow checks */
+        for (uint32_t i = 0; i < bits; i++) {
+            uint32_t bit = 0;
+            if (mPos < mBits) {
+                bit = (mData[mPos >> 3] >> (7 - (mPos & 7))) & 1;
+                mPos++;
+            }
+            value = (value << 1) | bit;
+        }
+        return value;
+    }
+
+    /* exp-golomb ue(v), codes longer than 32 bits are clamped */
+    uint32_t readUE() {
+        uint32_t zeros = 0;
+        while (mPos < mBits && read(1) == 0 && zeros < 31) {
+            zeros++;
+        }
+        /* at most 2^31 - 1 + 2^31 - 1, no wrap */
+        return ((1u << zeros) - 1) + read(zeros);
+    }
+
+    void skip(size_t bits) {
+        mPos = (bits < mBits - mPos) ? mPos + bits : mBits;
+    }
+
+private:
+    const uint8_t *mData;
+    size_t         mBits;
+    size_t         mPos;
+};
+
+/* payload after the next 00 00 01 start code, |end| if there is none */
+const uint8_t *nextStartCode(const uint8_t *p, const uint8_t *end) {
+    while (end - p >= 3) {
+        if (p[0] == 0 && p[1] == 0 && p[2] == 1) {
+            return p + 3;
+        }
+        p++;
+    }
+    return end;
+}
+
+bool isSyncAvc(const uint8_t *data, size_t size) {
+    const uint8_t *end = data + size;
+
+    for (const uint8_t *p = nextStartCode(data, end); p < end; p = nextStartCode(p, end)) {
+        uint32_t type = p[0] & 0x1f;
+
+        if (type == 5) {
+            return true;
+        }
+        if (type == 1) {
+            BitReader reader(p + 1, end - p - 1);
+            (void)reader.readUE();          /* first_mb_in_slice */
+            uint32_t sliceType = reader.readUE() % 5;
+            /* I or SI slice */
+            return (sliceType == 2 || sliceType == 4);
+        }
+    }
+
+    /* parameter sets and sei only */
+    return true;
+}
+
+bool isSyncHevc(const uint8_t *data, size_t size) {
+    const uint8_t *end = data + size;
+
+    for (const uint8_t *p = nextStartCode(data, end); p < end; p = nextStartCode(p, end)) {
+        uint32_t type = (p[0] >> 1) & 0x3f;
+
+        /* vcl nal units, BLA/IDR/CRA are irap */
+        if (type <= 31) {
+            return (type >= 16 && type <= 23);
+        }
+    }
+
+    return true;
+}
+
+bool isSyncVp8(const uint8_t *data, size_t size) {
+    /* frame tag bit 0 is zero for key frames */
+    return size == 0 || (data[0] & 1) == 0;
+}
+
+bool isSyncVp9(const uint8_t *data, size_t size) {
+    BitReader reader(data, size);
+
+    if (size == 0 || reader.read(2) != 2) {         /* frame_marker */
+        return true;
+    }
+
+    uint32_t profile = reader.read(1);
+    profile |= reader.read(1) << 1;
+    if (profile == 3) {
+        (void)reader.read(1);                       /* reserved_zero */
+    }
+
+    if (reader.read(1)) {                           /* show_existing_frame */
+        return false;
+    }
+
+    return reader.read(1) == 0;                     /* frame_type KEY_FRAME */
+}
+
+bool isSyncAv1(const uint8_t *data, size_t size) {
+    const uint8_t *p = data;
+    const uint8_t *end = data + size;
+
+    while (p < end) {
+        uint8_t header = *p++;
+        uint32_t type = (header >> 3) & 0xf;
+        uint64_t obuSize = 0;
+
+        if (header & 0x4) {                         /* obu_extension_flag */
+            p++;
+        }
+        if (header & 0x2) {                         /* obu_has_size_field */
+            for (int i = 0; i < 8 && p < end; i++) {
+                uint8_t byte = *p++;
+                obuSize |= (uint64_t)(byte & 0x7f) << (i * 7);
+                if (!(byte & 0x80)) {
+                    break;
+                }
+            }
+        } else {
+            obuSize = (p < end) ? (uint64_t)(end - p) : 0;
+        }
+
+        if (p >= end) {
+            break;
+        }
+        if (obuSize > (uint64_t)(end - p)) {
+            obuSize = end - p;
+        }
+
+        /* key frames come with a sequence header, so do still pictures */
+        if (type == 1) {
+            return true;
+        }
+
+        /* OBU_FRAME_HEADER or OBU_FRAME */
+        if (type == 3 || type == 6) {
+            BitReader reader(p, obuSize);
+            if (reader.read(1)) {                   /* show_existing_frame */
+                return false;
+            }
+            return reader.read(2) == 0;             /* frame_type KEY_FRAME */
+        }
+
+        p += obuSize;
+    }
+
+    return true;
+}
+
+bool isSyncMpeg2(const uint8_t *data, size_t size) {
+    const uint8_t *end = data + size;
+
+    for (const uint8_t *p = nextStartCode(data, end); p < end; p = nextStartCode(p, end)) {
+        if (p[0] == 0x00) {                         /* picture_start_code */
+            BitReader reader(p + 1, end - p - 1);
+            (void)reader.read(10);                  /* temporal_reference */
+            return reader.read(3) == 1;             /* picture_coding_type I */
+        }
+    }
+
+    return true;
+}
+
+bool isSyncMpeg4(const uint8_t *data, size_t size) {
+    const uint8_t *end = data + size;
+
+    for (const uint8_t *p = nextStartCode(data, end); p < end; p = nextStartCode(p, end)) {
+        if (p[0] == 0xb6) {                         /* vop_start_code */
+            BitReader reader(p + 1, end - p - 1);
+            return reader.read(2) == 0;             /* vop_coding_type I */
+        }
+    }
+
+    return true;
+}
+
+bool isNonRefAvc(const uint8_t *data, size_t size) {
+    const uint8_t *end = data + size;
+
+    for (const uint8_t *p = nextStartCode(data, end); p < end; p = nextStartCode(p, end)) {
+        uint32_t type = p[0] & 0x1f;
+
+        if (type == 1 || type == 5) {
+            return ((p[0] >> 5) & 0x3) == 0;        /* nal_ref_idc */
+        }
+    }
+
+    return false;
+}
+
+bool isNonRefHevc(const uint8_t *data, size_t size, int32_t maxTemporalId) {
+    const uint8_t *end = data + size;
+
+    for (const uint8_t *p = nextStartCode(data, end); p < end; p = nextStartCode(p, end)) {
+        uint32_t type = (p[0] >> 1) & 0x3f;
+
+        /* TRAIL_N, TSA_N, STSA_N, RADL_N, RASL_N and reserved N types */
+        if (type <= 31) {
+            if (type > 14 || (type & 1) != 0 || end - p < 2) {
+                return false;
+            }
+            /*
+             * sub-layer non-reference pictures are still referenced by
+             * higher sub-layers, only the highest one is free to drop
+             */
+            int32_t temporalId = (int32_t)(p[1] & 0x7) - 1;
+            return maxTemporalId >= 0 && temporalId == maxTemporalId;
+        }
+    }
+
+    return false;
+}
+
+int32_t getMaxTemporalIdHevc(const uint8_t *data, size_t size) {
+    const uint8_t *end = data + size;
+
+    for (const uint8_t *p = nextStartCode(data, end); p < end; p = nextStartCode(p, end)) {
+        uint32_t type = (p[0] >> 1) & 0x3f;
+
+        /* SPS_NUT */
+        if (type == 33 && end - p > 3) {
+            BitReader reader(p + 2, end - p - 2);
+            (void)reader.read(4);                   /* sps_video_parameter_set_id */
+            return (int32_t)reader.read(3);         /* sps_max_sub_layers_minus1 */
+        }
+    }
+
+    return -1;
+}
+
+/* nal payload without emulation prevention bytes, at most |capacity| bytes */
+size_t unescapeRbsp(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity) {
+    size_t length = 0;
+    uint32_t zeros = 0;
+
+    for (size_t i = 0; i < size && length < capacity; i++) {
+        if (zeros >= 2 && src[i] == 0x03) {
+            zeros = 0;
+            continue;
+        }
+        dst[length++] = src[i];
+        zeros = (src[i] == 0) ? zeros + 1 : 0;
+    }
+
+    return length;
+}
+
+/* sps are short, scaling lists included */
+const size_t kMaxSpsSize = 512;
+
+void skipAvcScalingList(BitReader &reader, uint32_t count) {
+    uint32_t lastScale = 8;
+    uint32_t nextScale = 8;
+
+    for (uint32_t i = 0; i < count && nextScale != 0; i++) {
+        /* delta_scale se(v), modulo 256 without signed math */
+        uint32_t code = reader.readUE();
+        uint32_t delta = (code >> 1) % 256;
+        delta = (code & 1) ? (delta + 1) % 256 : (256 - delta) % 256;
+        nextScale = (lastScale + delta) % 256;
+        if (nextScale != 0) {
+            lastScale = nextScale;
+        }
+    }
+}
+
+int32_t parseAvcRefFrames(const uint8_t *data, size_t size) {
+    uint8_t rbsp[kMaxSpsSize];
+    BitReader reader(rbsp, unescapeRbsp(data, size, rbsp, sizeof(rbsp)));
+
+    uint32_t profile = reader.read(8);              /* profile_idc */
+    (void)reader.read(16);                          /* constraint flags, level_idc */
+    (void)reader.readUE();                          /* seq_parameter_set_id */
+
+    if (profile == 100 || profile == 110 || profile == 122 || profile == 244 ||
+        profile == 44 || profile == 83 || profile == 86 || profile == 118 ||
+        profile == 128 || profile == 138 || profile == 139 || profile == 134 ||
+        profile == 135) {
+        uint32_t chromaFormat = reader.readUE();
+        if (chromaFormat == 3) {
+            (void)reader.read(1);                   /* separate_colour_plane_flag */
+        }
+        (void)reader.readUE();                      /* bit_depth_luma_minus8 */
+        (void)reader.readUE();                      /* bit_depth_chroma_minus8 */
+        (void)reader.read(1);                       /* qpprime_y_zero_transform_bypass */
+        if (reader.read(1)) {                       /* seq_scaling_matrix_present_flag */
+            uint32_t lists = (chromaFormat != 3) ? 8 : 12;
+            for (uint32_t i = 0; i < lists; i++) {
+                if (reader.read(1)) {
+                    skipAvcScalingList(reader, (i < 6) ? 16 : 64);
+                }
+            }
+        }
+    }
+
+    (void)reader.readUE();                          /* log2_max_frame_num_minus4 */
+    uint32_t pocType = reader.readUE();
+    if (pocType == 0) {
+        (void)reader.readUE();                      /* log2_max_pic_order_cnt_lsb_minus4 */
+    } else if (pocType == 1) {
+        (void)reader.read(1);                       /* delta_pic_order_always_zero_flag */
+        (void)reader.readUE();                      /* offset_for_non_ref_pic */
+        (void)reader.readUE();                      /* offset_for_top_to_bottom_field */
+        uint32_t cycle = reader.readUE();
+        for (uint32_t i = 0; i < cycle && i < 256; i++) {
+            (void)reader.readUE();                  /* offset_for_ref_frame */
+        }
+    }
+
+    uint32_t refFrames = reader.readUE();           /* max_num_ref_frames */
+    return (int32_t)((refFrames < 16) ? refFrames : 16);
+}
+
+int32_t parseHevcRefFrames(const uint8_t *data, size_t size) {
+    uint8_t rbsp[kMaxSpsSize];
+    BitReader reader(rbsp, unescapeRbsp(data, size, rbsp, sizeof(rbsp)));
+    bool profilePresent[8];
+    bool levelPresent[8];
+
+    (void)reader.read(4);                           /* sps_video_parameter_set_id */
+    uint32_t maxSubLayers = reader.read(3);         /* sps_max_sub_layers_minus1 */
+    (void)reader.read(1);                           /* sps_temporal_id_nesting_flag */
+
+    /* profile_tier_level, general part then the sub-layers */
+    reader.skip(88 + 8);
+    for (uint32_t i = 0; i < maxSubLayers; i++) {
+        profilePresent[i] = reader.read(1);
+        levelPresent[i] = reader.read(1);
+    }
+    if (maxSubLayers > 0) {
+        reader.skip(2 * (8 - maxSubLayers));        /* reserved_zero_2bits */
+    }
+    for (uint32_t i = 0; i < maxSubLayers; i++) {
+        reader.skip((profilePresent[i] ? 88 : 0) + (levelPresent[i] ? 8 : 0));
+    }
+
+    (void)reader.readUE();                          /* sps_seq_parameter_set_id */
+    if (reader.readUE() == 3) {                     /* chroma_format_idc */
+        (void)reader.read(1);                       /* separate_colour_plane_flag */
+    }
+    (void)reader.readUE();                          /* pic_width_in_luma_samples */
+    (void)reader.readUE();                          /* pic_height_in_luma_samples */
+    if (reader.read(1)) {                           /* conformance_window_flag */
+        for (uint32_t i = 0; i < 4; i++) {
+            (void)reader.readUE();
+        }
+    }
+    (void)reader.readUE();                          /* bit_depth_luma_minus8 */
+    (void)reader.readUE();                          /* bit_depth_chroma_minus8 */
+    (void)reader.readUE();                          /* log2_max_pic_order_cnt_lsb_minus4 */
+
+    /* the highest sub-layer bounds the others */
+    uint32_t first = reader.read(1) ? 0 : maxSubLayers;
+    uint32_t maxDecPicBuffering = 0;
+    for (uint32_t i = first; i <= maxSubLayers; i++) {
+        maxDecPicBuffering = reader.readUE();       /* sps_max_dec_pic_buffering_minus1 */
+        (void)reader.readUE();                      /* sps_max_num_reorder_pics */
+        (void)reader.readUE();                      /* sps_max_latency_increase_plus1 */
+    }
+
+    /* minus1 leaves out the picture being decoded */
+    return (int32_t)((maxDecPicBuffering < 16) ? maxDecPicBuffering : 16);
+}
+
+int32_t getRefFramesAvc(const uint8_t *data, size_t size) {
+    const uint8_t *end = data + size;
+
+    for (const uint8_t *p = nextStartCode(data, end); p < end; p = nextStartCode(p, end)) {
+        uint32_t type = p[0] & 0x1f;
+
+        if (type == 7) {
+            return parseAvcRefFrames(p + 1, end - p - 1);
+        }
+        /* parameter sets come before the slices */
+        if (type >= 1 && type <= 5) {
+            break;
+        }
+    }
+
+    return -1;
+}
+
+int32_t getRefFramesHevc(const uint8_t *data, size_t size) {
+    const uint8_t *end = data + size;
+
+    for (const uint8_t *p = nextStartCode(data, end); p < end; p = nextStartCode(p, end)) {
+        uint32_t type = (p[0] >> 1) & 0x3f;
+
+        if (type == 33 && end - p > 2) {
+            return parseHevcRefFrames(p + 2, end - p - 2);
+        }
+        if (type <= 31) {
+            break;
+        }
+    }
+
+    return -1;
+}
+
+bool isNonRefMpeg2(const uint8_t *data, size_t size) {
+    const uint8_t *end = data + size;
+
+    for (const uint8_t *p = nextStartCode(data, end); p < end; p = nextStartCode(p, end)) {
+        if (p[0] == 0x00) {
+            BitReader reader(p + 1, end - p - 1);
+            (void)reader.read(10);
+            return reader.read(3) == 3;             /* picture_coding_type B */
+        }
+    }
+
+    return false;
+}
+
+}  // namespace
+
+bool C2RKBitstream::isSyncFrame(MppCodingType codingType, const uint8_t *data, size_t size) {
+    if (data == nullptr || size == 0) {
+        return true;
+    }
+
+    switch (codingType) {
+    case MPP_VIDEO_CodingAVC:   return isSyncAvc(data, size);
+    case MPP_VIDEO_CodingHEVC:  return isSyncHevc(data, size);
+    case MPP_VIDEO_CodingVP8:   return isSyncVp8(data, size);
+    case MPP_VIDEO_CodingVP9:   return isSyncVp9(data, size);
+    case MPP_VIDEO_CodingAV1:   return isSyncAv1(data, size);
+    case MPP_VIDEO_CodingMPEG2: return isSyncMpeg2(data, size);
+    case MPP_VIDEO_CodingMPEG4: return isSyncMpeg4(data, size);
+    default:                    return true;
+    }
+}
+
+bool C2RKBitstream::isNonRefFrame(
+        MppCodingType codingType, const uint8_t *data, size_t size, int32_t maxTemporalId) {
+    if (data == nullptr || size == 0) {
+        return false;
+    }
+
+    switch (codingType) {
+    case MPP_VIDEO_CodingAVC:   return isNonRefAvc(data, size);
+    case MPP_VIDEO_CodingHEVC:  return isNonRefHevc(data, size, maxTemporalId);
+    case MPP_VIDEO_CodingMPEG2: return isNonRefMpeg2(data, size);
+    default:                    return false;
+    }
+}
+
+int32_t C2RKBitstream::getMaxTemporalId(MppCodingType codingType, const uint8_t *data, size_t size) {
+    if (data == nullptr || size == 0) {
+        return -1;
+    }
+
+    switch (codingType) {
+    case MPP_VIDEO_CodingHEVC:  return getMaxTemporalIdHevc(data, size);
+    default:                    return -1;
+    }
+}
+
+int32_t C2RKBitstream::getRefFrameCount(MppCodingType codingType, const uint8_t *data, size_t size) {
+    if (data == nullptr || size == 0) {
+        return -1;
+    }
+
+    switch (codingType) {
+    case MPP_VIDEO_CodingAVC:   return getRefFramesAvc(data, size);
+    case MPP_VIDEO_CodingHEVC:  return getRefFramesHevc(data, size);
+    default:                    return -1;
+    }
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef  ROCKCHIP_LOG_TAG
+#define ROCKCHIP_LOG_TAG    "C2RKCapacityDef"
+
+#include <string.h>
+#include <algorithm>
+
+#include "C2RKCapacityDef.h"
+#include "C2RKChipCapDef.h"
+#include "C2RKEnv.h"
+#include "C2RKLog.h"
+
+/*
+ * per codec macroblock rate of the vpu cores. codecs not listed, and
+ * chips not listed, are not limited.
+ */
+static const C2CodecCapacity codecCaps_rk3288[] = {
+    { MPP_VIDEO_CodingAVC,   C2_CAP_MBPS(1920, 1080, 60), C2_CAP_MBPS(1920, 1080, 30) },
+    { MPP_VIDEO_CodingHEVC,  C2_CAP_MBPS(3840, 2160, 60), 0 },
+    { MPP_VIDEO_CodingVP8,   C2_CAP_MBPS(1920, 1080, 60), C2_CAP_MBPS(1920, 1080, 30) },
+    { MPP_VIDEO_CodingMPEG2, C2_CAP_MBPS(1920, 1080, 60), 0 },
+    { MPP_VIDEO_CodingMPEG4, C2_CAP_MBPS(1920, 1080, 60), 0 },
+    { MPP_VIDEO_CodingH263,  C2_CAP_MBPS(1920, 1080, 60), 0 },
+};
+
+static const C2CodecCapacity codecCaps_rk3328[] = {
+    { MPP_VIDEO_CodingAVC,   C2_CAP_MBPS(3840, 2160, 30), C2_CAP_MBPS(1920, 1080, 30) },
+    { MPP_VIDEO_CodingHEVC,  C2_CAP_MBPS(3840, 2160, 60), C2_CAP_MBPS(1920, 1080, 30) },
+    { MPP_VIDEO_CodingVP9,   C2_CAP_MBPS(3840, 2160, 60), 0 },
+    { MPP_VIDEO_CodingVP8,   C2_CAP_MBPS(1920, 1080, 60), 0 },
+    { MPP_VIDEO_CodingMPEG2, C2_CAP_MBPS(1920, 1080, 60), 0 },
+    { MPP_VIDEO_CodingMPEG4, C2_CAP_MBPS(1920, 1080, 60), 0 },
+    { MPP_VIDEO_CodingH263,  C2_CAP_MBPS(1920, 1080, 60), 0 },
+};
+
+static const C2CodecCapacity codecCaps_rk3399[] = {
+    { MPP_VIDEO_CodingAVC,   C2_CAP_MBPS(3840, 2160, 30), C2_CAP_MBPS(1920, 1080, 30) },
+    { MPP_VIDEO_CodingHEVC,  C2_CAP_MBPS(3840, 2160, 60), 0 },
+    { MPP_VIDEO_CodingVP9,   C2_CAP_MBPS(3840, 2160, 60), 0 },
+    { MPP_VIDEO_CodingVP8,   C2_CAP_MBPS(1920, 1080, 60), C2_CAP_MBPS(1920, 1080, 30) },
+    { MPP_VIDEO_CodingMPEG2, C2_CAP_MBPS(1920, 1080, 60), 0 },
+    { MPP_VIDEO_CodingMPEG4, C2_CAP_MBPS(1920, 1080, 60), 0 },
+    { MPP_VIDEO_CodingH263,  C2_CAP_MBPS(1920, 1080, 60), 0 },
+};
+
+static const C2CodecCapacity codecCaps_rk3326[] = {
+    { MPP_VIDEO_CodingAVC,   C2_CAP_MBPS(1920, 1080, 60), C2_CAP_MBPS(1920, 1080, 30) },
+    { MPP_VIDEO_CodingHEVC,  C2_CAP_MBPS(1920, 1080, 60), 0 },
+    { MPP_VIDEO_CodingVP8,   C2_CAP_MBPS(1920, 1080, 60), 0 },
+    { MPP_VIDEO_CodingMPEG2, C2_CAP_MBPS(1920, 1080, 60), 0 },
+    { MPP_VIDEO_CodingMPEG4, C2_CAP_MBPS(1920, 1080, 60), 0 },
+    { MPP_VIDEO_CodingH263,  C2_CAP_MBPS(1920, 1080, 60), 0 },
+};
+
+/* rkvdec2 is rated for 16 streams of 1080p30 */
+static const C2CodecCapacity codecCaps_rk356x[] = {
+    { MPP_VIDEO_CodingAVC,   C2_CAP_MBPS(1920, 1080, 30 * 16), C2_CAP_MBPS(1920, 1080, 60) },
+    { MPP_VIDEO_CodingHEVC,  C2_CAP_MBPS(1920, 1080, 30 * 16), C2_CAP_MBPS(1920, 1080, 60) },
+    { MPP_VIDEO_CodingVP9,   C2_CAP_MBPS(1920, 1080, 30 * 16), 0 },
+    { MPP_VIDEO_CodingVP8,   C2_CAP_MBPS(1920, 1080, 60), C2_CAP_MBPS(1920, 1080, 30) },
+    { MPP_VIDEO_CodingMPEG2, C2_CAP_MBPS(1920, 1080, 60), 0 },
+    { MPP_VIDEO_CodingMPEG4, C2_CAP_MBPS(1920, 1080, 60), 0 },
+    { MPP_VIDEO_CodingH263,  C2_CAP_MBPS(1920, 1080, 60), 0 },
+};
+
+static const C2CodecCapacity codecCaps_rk3588[] = {
+    { MPP_VIDEO_CodingAVC,   C2_CAP_MBPS(7680, 4320, 30), C2_CAP_MBPS(7680, 4320, 30) },
+    { MPP_VIDEO_CodingHEVC,  C2_CAP_MBPS(7680, 4320, 60), C2_CAP_MBPS(7680, 4320, 30) },
+    { MPP_VIDEO_CodingVP9,   C2_CAP_MBPS(7680, 4320, 60), 0 },
+    { MPP_VIDEO_CodingAV1,   C2_CAP_MBPS(7680, 4320, 30), 0 },
+    { MPP_VIDEO_CodingVP8,   C2_CAP_MBPS(1920, 1080, 60), C2_CAP_MBPS(1920, 1080, 30) },
+    { MPP_VIDEO_CodingMPEG2, C2_CAP_MBPS(1920, 1080, 60), 0 },
+    { MPP_VIDEO_CodingMPEG4, C2_CAP_MBPS(1920, 1080, 60), 0 },
+    { MPP_VIDEO_CodingH263,  C2_CAP_MBPS(1920, 1080, 60), 0 },
+};
+
+#define C2_CAPS(caps)   (int)(sizeof(caps) / sizeof((caps)[0])), caps
+
+static const C2CapacityInfo CapacityInfos[] = {
+    { "rk3288",  RK_CHIP_3288,  C2_CAPS(codecCaps_rk3288) },
+    { "rk3228h", RK_CHIP_3228H, C2_CAPS(codecCaps_rk3328) },
+    { "rk3328",  RK_CHIP_3328,  C2_CAPS(codecCaps_rk3328) },
+    { "rk3399",  RK_CHIP_3399,  C2_CAPS(codecCaps_rk3399) },
+    { "rk3326",  RK_CHIP_3326,  C2_CAPS(codecCaps_rk3326) },
+    { "px30",    RK_CHIP_3326,  C2_CAPS(codecCaps_rk3326) },
+    { "rk3566",  RK_CHIP_3566,  C2_CAPS(codecCaps_rk356x) },
+    { "rk3568",  RK_CHIP_3568,  C2_CAPS(codecCaps_rk356x) },
+    { "rk3588",  RK_CHIP_3588,  C2_CAPS(codecCaps_rk3588) },
+};
+
+static const int capacityInfoSize = sizeof(CapacityInfos) / sizeof((CapacityInfos)[0]);
+
+const C2CapacityInfo* C2RKCapacityDef::findCapacityInfo(const char *chipName) {
+    for (int i = 0; i < capacityInfoSize; i++) {
+        if (strstr(chipName, CapacityInfos[i].chipName)) {
+            return &CapacityInfos[i];
+        }
+    }
+
+    return NULL;
+}
+
+C2RKCapacity* C2RKCapacity::get() {
+    static C2RKCapacity *sCapacity = [] {
+        C2_U32 disable = 0;
+        Rockchip_C2_GetEnvU32("vendor.c2.capacity.disable", &disable, 0);
+        return new C2RKCapacity(disable ? NULL : C2RKChipCapDef::get()->capacityInfo);
+    }();
+
+    return sCapacity;
+}
+
+C2RKCapacity::C2RKCapacity(const C2CapacityInfo *info)
+    : mInfo(info),
+      mNextId(1) {
+    memset(mUsed, 0, sizeof(mUsed));
+}
+
+uint64_t C2RKCapacity::getCapacityMbps(MppCtxType type, MppCodingType codingType) const {
+    if (mInfo == NULL) {
+        return 0;
+    }
+
+    for (int i = 0; i < mInfo->codecNum; i++) {
+        const C2CodecCapacity *caps = &mInfo->codecs[i];
+        if (caps->codingType == codingType) {
+            return (type == MPP_CTX_ENC) ? caps->encMbps : caps->decMbps;
+        }
+    }
+
+    return 0;
+}
+
+bool C2RKCapacity::getShare(const C2CapacityRequest &request, uint32_t *share) const {
+    uint64_t capacity = getCapacityMbps(request.type, request.codingType);
+    uint64_t load = C2_CAP_MBPS(request.width, request.height, 1);
+
+    if (capacity == 0 || request.type >= MPP_CTX_BUTT) {
+        return false;
+    }
+
+    /* unknown frame rate counts as 30 */
+    load = (uint64_t)(load * ((request.frameRate > 0) ? request.frameRate : 30.0f));
+
+    /* round up, every running session takes something */
+    *share = (uint32_t)std::min<uint64_t>(
+            (load * kShareFull + capacity - 1) / capacity, kShareFull + 1);
+
+    return true;
+}
+
+c2_status_t C2RKCapacity::reserve(const C2CapacityRequest &request, int32_t *id) {
+    uint32_t share = 0;
+
+    *id = 0;
+
+    if (!getShare(request, &share)) {
+        return C2_OK;
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (mUsed[request.type] + share > kShareFull) {
+        c2_err("%s capacity exceeded, %ux%u@%.1f needs %u/%u, %u in use",
+               (request.type == MPP_CTX_ENC) ? "encoder" : "decoder",
+               request.width, request.height, request.frameRate,
+               share, kShareFull, mUsed[request.type]);
+        return C2_NO_MEMORY;
+    }
+
+    mUsed[request.type] += share;
+    *id = mNextId++;
+    mReservations[*id] = std::make_pair(request.type, share);
+
+    c2_info("reserve id %d %ux%u@%.1f share %u, %u/%u in use", *id,
+            request.width, request.height, request.frameRate,
+            share, mUsed[request.type], kShareFull);
+
+    return C2_OK;
+}
+
+void C2RKCapacity::release(int32_t id) {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    auto it = mReservations.find(id);
+    if (it == mReservations.end()) {
+        return;
+    }
+
+    MppCtxType type = it->second.first;
+    mUsed[type] -= it->second.second;
+    mReservations.erase(it);
+
+    c2_info("release id %d, %u/%u in use", id, mUsed[type], kShareFull);
+}
+
+c2_status_t C2RKCapacity::update(int32_t id, const C2CapacityRequest &request) {
+    uint32_t share = 0;
+
+    if (!getShare(request, &share)) {
+        share = 0;
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+
+    auto it = mReservations.find(id);
+    if (it == mReservations.end() || it->second.first != request.type) {
+        return C2_BAD_VALUE;
+    }
+
+    uint32_t used = mUsed[request.type] - it->second.second;
+    if (used + share > kShareFull) {
+        c2_warn("%s capacity exceeded, %ux%u@%.1f needs %u/%u, %u in use, keep id %d",
+                (request.type == MPP_CTX_ENC) ? "encoder" : "decoder",
+                request.width, request.height, request.frameRate,
+                share, kShareFull, used, id);
+        return C2_NO_MEMORY;
+    }
+
+    mUsed[request.type] = used + share;
+    it->second.second = share;
+
+    c2_info("update id %d %ux%u@%.1f share %u, %u/%u in use", id,
+            request.width, request.height, request.frameRate,
+            share, mUsed[request.type], kShareFull);
+
+    return C2_OK;
+}
+
+uint64_t C2RKCapacity::getAvailableMbps(MppCtxType type, MppCodingType codingType) {
+    uint64_t capacity = getCapacityMbps(type, codingType);
+
+    if (capacity == 0 || type >= MPP_CTX_BUTT) {
+        return UINT64_MAX;
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+    return capacity * (kShareFull - mUsed[type]) / kShareFull;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef  ROCKCHIP_LOG_TAG
+#define ROCKCHIP_LOG_TAG    "C2RKChipCapDef"
+
+#include <string.h>
+#include <unistd.h>
+#include <mutex>
+
+#include <sys/system_properties.h>
+
+#include "C2RKChipCapDef.h"
+#include "C2RKGrallocDef.h"
+#include "C2RKLog.h"
+#include "C2RKEnv.h"
+
+static C2ChipCapInfo sChipCapInfo;
+static std::once_flag sChipCapOnce;
+
+static void probeBufferTypes(C2ChipCapInfo *info) {
+    char type[PROP_VALUE_MAX + 1];
+    C2_U32 flags = 0;
+
+    bool hasIon = (access("/dev/ion", F_OK) == 0);
+    bool hasHeap = (access("/dev/dma_heap", F_OK) == 0);
+    bool hasDrm = (access("/dev/dri/card0", F_OK) == 0);
+
+    /*
+     * without ion every dma-buf comes from a heap, importing it as ion
+     * goes through the compat shim, ext_dma takes it as is
+     */
+    info->importBufferType = (!hasIon && hasHeap) ? MPP_BUFFER_TYPE_EXT_DMA
+                                                  : MPP_BUFFER_TYPE_ION;
+    info->allocBufferType = (!hasIon && hasDrm) ? MPP_BUFFER_TYPE_DRM
+                                                : MPP_BUFFER_TYPE_ION;
+
+    memset(type, 0, sizeof(type));
+    Rockchip_C2_GetEnvStr("vendor.c2.buffer.type", type, NULL);
+    if (!strcmp(type, "ion")) {
+        info->importBufferType = MPP_BUFFER_TYPE_ION;
+        info->allocBufferType = MPP_BUFFER_TYPE_ION;
+    } else if (!strcmp(type, "dma")) {
+        /* ext_dma only imports, allocations keep the probed type */
+        info->importBufferType = MPP_BUFFER_TYPE_EXT_DMA;
+    } else if (!strcmp(type, "drm")) {
+        info->importBufferType = MPP_BUFFER_TYPE_DRM;
+        info->allocBufferType = MPP_BUFFER_TYPE_DRM;
+    } else if (type[0] != '\0') {
+        c2_warn("unknown buffer type %s, use the probed one", type);
+    }
+
+    /* flags originate from drm gem types, nothing else takes them */
+    Rockchip_C2_GetEnvU32("vendor.c2.buffer.flags", &flags, 0);
+    if (info->allocBufferType == MPP_BUFFER_TYPE_DRM) {
+        info->allocBufferType = (MppBufferType)(info->allocBufferType |
+                                                (flags & MPP_BUFFER_FLAGS_MASK));
+    }
+
+    c2_info("buffer types: ion %d heap %d drm %d, import 0x%x alloc 0x%x",
+            hasIon, hasHeap, hasDrm, info->importBufferType, info->allocBufferType);
+}
+
+static void initChipCapInfo() {
+    C2ChipCapInfo *info = &sChipCapInfo;
+
+    memset(info, 0, sizeof(C2ChipCapInfo));
+
+    info->chipInfo = probeChipName();
+    info->socInfo  = mpp_get_soc_info();
+
+    if (info->chipInfo != NULL) {
+        const C2FbcInfo *fbcInfo = C2RKFbcDef::findFbcInfo(info->chipInfo->name);
+        if (fbcInfo != NULL) {
+            info->fbcCapNum = fbcInfo->fbcCapNum;
+            info->fbcCaps   = fbcInfo->fbcCaps;
+        }
+
+        info->capacityInfo = C2RKCapacityDef::findCapacityInfo(info->chipInfo->name);
+
+        const C2GrallocInfo *grallocInfo =
+                C2RKGrallocDef::findGrallocInfo(info->chipInfo->name);
+        if (grallocInfo != NULL) {
+            info->grallocVersion = grallocInfo->grallocVersion;
+        }
+    }
+
+    probeBufferTypes(info);
+
+    c2_info("chip %s type %d gralloc-version %d fbc-caps %d soc %s",
+            info->chipInfo ? info->chipInfo->name : "unkown",
+            info->chipInfo ? info->chipInfo->type : RK_CHIP_UNKOWN,
+            info->grallocVersion, info->fbcCapNum,
+            info->socInfo ? info->socInfo->compatible : "unkown");
+}
+
+const C2ChipCapInfo* C2RKChipCapDef::get() {
+    std::call_once(sChipCapOnce, initChipCapInfo);
+    return &sChipCapInfo;
+}
+
+RKChipType C2RKChipCapDef::getChipType() {
+    const C2ChipCapInfo *info = get();
+    return info->chipInfo ? info->chipInfo->type : RK_CHIP_UNKOWN;
+}
+
+const C2FbcCaps* C2RKChipCapDef::getFbcCaps(MppCodingType codecId) {
+    const C2ChipCapInfo *info = get();
+
+    for (int i = 0; i < info->fbcCapNum; i++) {
+        if (info->fbcCaps[i].codecId == codecId) {
+            return &info->fbcCaps[i];
+        }
+    }
+
+    return NULL;
+}
+
+MppBufferType C2RKChipCapDef::getImportBufferType() {
+    return get()->importBufferType;
+}
+
+MppBufferType C2RKChipCapDef::getAllocBufferType() {
+    return get()->allocBufferType;
+}
@@ -25,6 +25,7 @@
 #include <fcntl.h>
 
 #include "C2RKChips.h"
+#include "C2RKChipCapDef.h"
 #include "C2RKLog.h"
 
 
@@ -125,7 +126,7 @@ RKChipInfo* readEfuse() {
     return NULL;
 }
 
-RKChipInfo* getChipName() {
+RKChipInfo* probeChipName() {
     RKChipInfo* infor = readEfuse();
     if (infor != NULL) {
         return infor;
@@ -143,3 +144,7 @@ RKChipInfo* getChipName() {
 
     return NULL;
 }
+
+RKChipInfo* getChipName() {
+    return C2RKChipCapDef::get()->chipInfo;
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef  ROCKCHIP_LOG_TAG
+#define ROCKCHIP_LOG_TAG    "C2RKDump"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "C2RKDump.h"
+#include "C2RKLog.h"
+#include "C2RKEnv.h"
+
+/* default ring size in MB, override with vendor.c2.dump.ring.mb */
+#define C2_DUMP_DEFAULT_RING_MB     64
+
+C2RKDump* C2RKDump::open(const char *fileName, size_t ringSize) {
+    if (ringSize == 0) {
+        C2_U32 ringMb = 0;
+        Rockchip_C2_GetEnvU32("vendor.c2.dump.ring.mb", &ringMb, C2_DUMP_DEFAULT_RING_MB);
+        ringSize = (size_t)(ringMb ? ringMb : C2_DUMP_DEFAULT_RING_MB) << 20;
+    }
+
+    int fd = ::open(fileName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        c2_err("failed to open dump file %s, err %s", fileName, strerror(errno));
+        return nullptr;
+    }
+
+    C2RKDump *dump = new C2RKDump(fd, fileName, ringSize);
+    if (dump->mRing == nullptr) {
+        c2_err("failed to malloc dump ring, size %zu", ringSize);
+        delete dump;
+        return nullptr;
+    }
+
+    c2_info("recording to %s, ring %zu bytes", fileName, ringSize);
+
+    return dump;
+}
+
+C2RKDump::C2RKDump(int fd, const char *fileName, size_t ringSize)
+    : mFd(fd),
+      mRing(nullptr),
+      mRingSize(ringSize),
+      mHead(0),
+      mTail(0),
+      mUsed(0),
+      mExit(false),
+      mWritten(0),
+      mDropBytes(0),
+      mDropCount(0) {
+    snprintf(mFileName, sizeof(mFileName), "%s", fileName);
+
+    mRing = (uint8_t *)malloc(ringSize);
+    if (mRing != nullptr) {
+        mThread = std::thread(&C2RKDump::threadLoop, this);
+    }
+}
+
+C2RKDump::~C2RKDump() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    mCond.notify_one();
+
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+
+    if (mDropCount) {
+        c2_warn("dump %s: %u chunks (%llu bytes) dropped",
+                mFileName, mDropCount, (unsigned long long)mDropBytes);
+    }
+    c2_info("dump %s: %llu bytes written", mFileName, (unsigned long long)mWritten);
+
+    if (mRing) {
+        free(mRing);
+        mRing = nullptr;
+    }
+
+    if (mFd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+    }
+}
+
+void C2RKDump::write(const void *data, size_t size) {
+    size_t head = 0;
+
+    if (data == nullptr || size == 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (size > mRingSize - mUsed) {
+            mDropCount++;
+            mDropBytes += size;
+            return;
+        }
+        head = mHead;
+    }
+
+    /* the free region is only touched by producer, copy outside lock */
+    size_t first = (size < mRingSize - head) ? size : (mRingSize - head);
+    memcpy(mRing + head, data, first);
+    if (first < size) {
+        memcpy(mRing, (const uint8_t *)data + first, size - first);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mHead = (head + size) % mRingSize;
+        mUsed += size;
+    }
+    mCond.notify_one();
+}
+
+void C2RKDump::threadLoop() {
+    while (true) {
+        size_t tail = 0, len = 0;
+
+        {
+            std::unique_lock<std::mutex> lock(mLock);
+            mCond.wait(lock, [this] { return mUsed > 0 || mExit; });
+            if (mUsed == 0 && mExit) {
+                break;
+            }
+            tail = mTail;
+            len  = (mUsed < mRingSize - tail) ? mUsed : (mRingSize - tail);
+        }
+
+        /* the used region is only touched by consumer, write outside lock */
+        ssize_t ret = ::write(mFd, mRing + tail, len);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            c2_err("dump %s write failed, err %s", mFileName, strerror(errno));
+            ret = len;  /* discard to keep the producer running */
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mTail = (tail + ret) % mRingSize;
+            mUsed -= ret;
+            mWritten += ret;
+        }
+    }
+}
@@ -15,6 +15,7 @@
  */
 
 #include "C2RKFbcDef.h"
+#include "C2RKChipCapDef.h"
 #include "C2RKLog.h"
 #include "C2RKEnv.h"
 
@@ -168,8 +169,18 @@ static const C2FbcInfo FbcInfos[] = {
 
 static const int fbcInfoSize = sizeof(FbcInfos) / sizeof((FbcInfos)[0]);
 
+const C2FbcInfo* C2RKFbcDef::findFbcInfo(const char *chipName) {
+    for (int i = 0; i < fbcInfoSize; i++) {
+        if (strstr(chipName, FbcInfos[i].chipName)) {
+            return &FbcInfos[i];
+        }
+    }
+
+    return NULL;
+}
+
 int C2RKFbcDef::getFbcOutputMode(MppCodingType codecId) {
-    RKChipInfo *chipInfo = getChipName();
+    RKChipInfo *chipInfo = C2RKChipCapDef::get()->chipInfo;
 
     if (chipInfo == NULL)
         return 0;
@@ -181,20 +192,10 @@ int C2RKFbcDef::getFbcOutputMode(MppCodingType codecId) {
         return 0;
     }
 
-    int i, j;
     int fbcMode = 0;
-    for (i = 0; i < fbcInfoSize; i++) {
-        C2FbcInfo fbcInfo = FbcInfos[i];
-
-        if (strstr(chipInfo->name, fbcInfo.chipName)) {
-            for (j = 0; j < fbcInfo.fbcCapNum; j++) {
-                if (fbcInfo.fbcCaps[j].codecId == codecId
-                        && fbcInfo.fbcCaps[j].fbcMode != 0) {
-                    fbcMode = fbcInfo.fbcCaps[j].fbcMode;
-                    break;
-                }
-            }
-        }
+    const C2FbcCaps *caps = C2RKChipCapDef::getFbcCaps(codecId);
+    if (caps != NULL) {
+        fbcMode = caps->fbcMode;
     }
 
     c2_info("[%s] codec-0x%08x fbc_support_result-%d", chipInfo->name, codecId, fbcMode);
@@ -209,21 +210,9 @@ void C2RKFbcDef::getFbcOutputOffset(
         return;
     }
 
-    RKChipInfo *chipInfo = getChipName();
-
-    int i, j;
-    for (i = 0; i < fbcInfoSize; i++) {
-        C2FbcInfo fbcInfo = FbcInfos[i];
-
-        if (strstr(chipInfo->name, fbcInfo.chipName)) {
-            for (j = 0; j < fbcInfo.fbcCapNum; j++) {
-                if (fbcInfo.fbcCaps[j].codecId == codecId) {
-                    *offsetX = fbcInfo.fbcCaps[j].offsetX;
-                    *offsetY = fbcInfo.fbcCaps[j].offsetY;
-                    return;
-                }
-            }
-        }
+    const C2FbcCaps *caps = C2RKChipCapDef::getFbcCaps(codecId);
+    if (caps != NULL) {
+        *offsetX = caps->offsetX;
+        *offsetY = caps->offsetY;
     }
 }
-
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef  ROCKCHIP_LOG_TAG
+#define ROCKCHIP_LOG_TAG    "C2RKFramePool"
+
+#include "C2RKFramePool.h"
+#include "C2RKLog.h"
+#include "C2RKEnv.h"
+#include "C2RKChipCapDef.h"
+
+/* upper bound of idle buffers kept for later decoders */
+#define C2_FRAME_POOL_MAX_IDLE      64
+
+C2RKFramePool* C2RKFramePool::get() {
+    static C2RKFramePool *sPool = [] {
+        C2_U32 maxIdle = 0;
+        Rockchip_C2_GetEnvU32("vendor.c2.dec.shared_pool", &maxIdle, 0);
+        if (maxIdle > C2_FRAME_POOL_MAX_IDLE) {
+            maxIdle = C2_FRAME_POOL_MAX_IDLE;
+        }
+        return new C2RKFramePool((uint32_t)maxIdle);
+    }();
+
+    return sPool;
+}
+
+C2RKFramePool::C2RKFramePool(uint32_t maxIdle)
+    : mMaxIdle(maxIdle),
+      mAllocated(0),
+      mGroup(nullptr) {
+    MppBufferType type = C2RKChipCapDef::getAllocBufferType();
+
+    if (mMaxIdle > 0 && mpp_buffer_group_get_internal(&mGroup, type) != MPP_OK) {
+        c2_err("failed to get buffer group, disable frame sharing");
+        mGroup = nullptr;
+        mMaxIdle = 0;
+    }
+}
+
+C2RKFramePool::~C2RKFramePool() {
+    for (auto &it : mReserved) {
+        for (Entry &entry : it.second) {
+            mpp_buffer_put(entry.buffer);
+        }
+    }
+    mReserved.clear();
+
+    for (Entry &entry : mIdle) {
+        mpp_buffer_put(entry.buffer);
+    }
+    mIdle.clear();
+
+    if (mGroup != nullptr) {
+        mpp_buffer_group_put(mGroup);
+        mGroup = nullptr;
+    }
+}
+
+MPP_RET C2RKFramePool::reserve(
+        const void *owner, size_t size, uint32_t count, std::vector<MppBuffer> *buffers) {
+    uint32_t reused = 0;
+
+    if (mGroup == nullptr) {
+        return MPP_NOK;
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+    std::list<Entry> &reserved = mReserved[owner];
+
+    for (auto it = mIdle.begin(); it != mIdle.end() && reused < count;) {
+        if (it->size == size) {
+            buffers->push_back(it->buffer);
+            reserved.push_back(*it);
+            it = mIdle.erase(it);
+            reused++;
+        } else {
+            it++;
+        }
+    }
+
+    for (uint32_t i = reused; i < count; i++) {
+        Entry entry;
+
+        entry.size = size;
+        entry.buffer = nullptr;
+        if (mpp_buffer_get(mGroup, &entry.buffer, size) != MPP_OK) {
+            c2_err("failed to get buffer of size %zu, %u allocated", size, mAllocated);
+            return MPP_ERR_NOMEM;
+        }
+        mAllocated++;
+
+        buffers->push_back(entry.buffer);
+        reserved.push_back(entry);
+    }
+
+    c2_trace("reserve %u size %zu, reused %u, allocated %u idle %zu",
+             count, size, reused, mAllocated, mIdle.size());
+
+    return MPP_OK;
+}
+
+void C2RKFramePool::unreserve(const void *owner) {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    auto it = mReserved.find(owner);
+    if (it == mReserved.end()) {
+        return;
+    }
+
+    mIdle.splice(mIdle.begin(), it->second);
+    mReserved.erase(it);
+
+    /* drop the buffers returned longest ago */
+    while (mIdle.size() > mMaxIdle) {
+        mpp_buffer_put(mIdle.back().buffer);
+        mIdle.pop_back();
+        mAllocated--;
+    }
+
+    c2_trace("unreserve, allocated %u idle %zu", mAllocated, mIdle.size());
+}
@@ -15,6 +15,7 @@
  */
 
 #include "C2RKGrallocDef.h"
+#include "C2RKChipCapDef.h"
 #include "C2RKLog.h"
 #include "C2RKEnv.h"
 
@@ -130,25 +131,25 @@ static const C2GrallocInfo GrallocInfos[] = {
 
 static const int GrallocInfoSize = sizeof(GrallocInfos) / sizeof((GrallocInfos)[0]);
 
-uint32_t C2RKGrallocDef::getGrallocVersion() {
-    RKChipInfo *chipInfo = getChipName();
-
-    if (chipInfo == NULL)
-        return 0;
-
-    int grallocVersion = 0;
+const C2GrallocInfo* C2RKGrallocDef::findGrallocInfo(const char *chipName) {
     for (int i = 0; i < GrallocInfoSize; i++) {
-        C2GrallocInfo fbcInfo = GrallocInfos[i];
-
-        if (strstr(chipInfo->name, fbcInfo.chipName)) {
-            grallocVersion = fbcInfo.grallocVersion;
-            break;
+        if (strstr(chipName, GrallocInfos[i].chipName)) {
+            return &GrallocInfos[i];
         }
     }
 
-    c2_info("[%s] gralloc-version-%d", chipInfo->name, grallocVersion);
+    return NULL;
+}
+
+uint32_t C2RKGrallocDef::getGrallocVersion() {
+    const C2ChipCapInfo *info = C2RKChipCapDef::get();
+
+    if (info->chipInfo == NULL)
+        return 0;
+
+    c2_info("[%s] gralloc-version-%d", info->chipInfo->name, info->grallocVersion);
 
-    return grallocVersion;
+    return info->grallocVersion;
 }
 
 uint32_t C2RKGrallocDef::getAndroidVerison() {
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef  ROCKCHIP_LOG_TAG
+#define ROCKCHIP_LOG_TAG    "C2RKJobQueue"
+
+#include <stdio.h>
+#include <pthread.h>
+
+#include "C2RKJobQueue.h"
+#include "C2RKLog.h"
+
+C2RKJobQueue::C2RKJobQueue(const char *name, uint32_t maxPending)
+    : mMaxPending(maxPending ? maxPending : 1),
+      mRunning(false),
+      mExit(false) {
+    /* thread names are limited to 15 chars */
+    snprintf(mName, sizeof(mName), "%s", name);
+
+    mThread = std::thread(&C2RKJobQueue::threadLoop, this);
+}
+
+C2RKJobQueue::~C2RKJobQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    mCond.notify_all();
+
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+void C2RKJobQueue::post(std::function<void()> job) {
+    {
+        std::unique_lock<std::mutex> lock(mLock);
+        mCond.wait(lock, [this] { return mJobs.size() < mMaxPending; });
+        mJobs.push_back(std::move(job));
+    }
+    mCond.notify_all();
+}
+
+void C2RKJobQueue::waitIdle() {
+    std::unique_lock<std::mutex> lock(mLock);
+    mCond.wait(lock, [this] { return mJobs.empty() && !mRunning; });
+}
+
+void C2RKJobQueue::threadLoop() {
+    pthread_setname_np(pthread_self(), mName);
+
+    while (true) {
+        std::function<void()> job;
+
+        {
+            std::unique_lock<std::mutex> lock(mLock);
+            mCond.wait(lock, [this] { return !mJobs.empty() || mExit; });
+            if (mJobs.empty() && mExit) {
+                break;
+            }
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+            mRunning = true;
+        }
+        /* wake a producer blocked on a full queue */
+        mCond.notify_all();
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mRunning = false;
+        }
+        mCond.notify_all();
+    }
+}
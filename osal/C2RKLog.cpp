@@ -15,30 +15,97 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
+#include <atomic>
 #include <android/log.h>
+#include <sys/system_properties.h>
 #include "C2RKLog.h"
 #include "C2RKEnv.h"
 #include "C2RKTypes.h"
 
-void _Rockchip_C2_Log(ROCKCHIP_LOG_LEVEL logLevel, C2_U32 flag, const char *tag, const char *msg, ...)
+/*
+ * every codec thread logs, the cached fields are atomic. concurrent
+ * refreshes read the same property and store the same value.
+ */
+struct C2LogProperty {
+    constexpr explicit C2LogProperty(const char *propName)
+        : name(propName), info(nullptr), serial(0), areaSerial(0),
+          probed(false), value(0) {}
+
+    const char                       *name;
+    std::atomic<const prop_info *>    info;
+    std::atomic<uint32_t>             serial;
+    std::atomic<uint32_t>             areaSerial;
+    std::atomic<bool>                 probed;
+    std::atomic<C2_U32>               value;
+};
+
+static C2LogProperty sTraceProp("vendor.dump.c2.log");
+static C2LogProperty sDebugProp("vendor.c2.log.debug");
+
+/* lookup the property once and reread only when its serial changes */
+static C2_U32 getLogPropertyValue(C2LogProperty *prop)
+{
+    const prop_info *info = prop->info.load();
+
+    if (info == NULL) {
+        /* property not exist yet, find again after any property update */
+        uint32_t areaSerial = __system_property_area_serial();
+        if (prop->probed.load() && areaSerial == prop->areaSerial.load()) {
+            return prop->value.load();
+        }
+        prop->areaSerial.store(areaSerial);
+        prop->probed.store(true);
+        info = __system_property_find(prop->name);
+        if (info == NULL) {
+            return prop->value.load();
+        }
+        prop->serial.store(~__system_property_serial(info));
+        prop->info.store(info);
+    }
+
+    uint32_t serial = __system_property_serial(info);
+    if (serial != prop->serial.load()) {
+        char value[PROP_VALUE_MAX];
+        char *endptr = NULL;
+        __system_property_read(info, NULL, value);
+        int base = (value[0] == '0' && value[1] == 'x') ? (16) : (10);
+        C2_U32 result = strtoul(value, &endptr, base);
+        /* value first, a reader that sees the new serial sees the new value */
+        prop->value.store((endptr == value) ? 0 : result);
+        prop->serial.store(serial);
+    }
+
+    return prop->value.load();
+}
+
+int _Rockchip_C2_Log_Enabled(ROCKCHIP_LOG_LEVEL logLevel, C2_U32 flag)
 {
-    C2_U32 value = 0;
+    switch (logLevel) {
+    case ROCKCHIP_LOG_TRACE:
+        return getLogPropertyValue(&sTraceProp) != 0;
+    case ROCKCHIP_LOG_DEBUG:
+        return (getLogPropertyValue(&sDebugProp) & flag) != 0;
+    default:
+        return 1;
+    }
+}
 
+void _Rockchip_C2_Log(ROCKCHIP_LOG_LEVEL logLevel, C2_U32 flag, const char *tag, const char *msg, ...)
+{
     va_list argptr;
 
     va_start(argptr, msg);
 
     switch (logLevel) {
     case ROCKCHIP_LOG_TRACE: {
-        Rockchip_C2_GetEnvU32("vendor.dump.c2.log", &value, 0);
-        if (value) {
+        if (_Rockchip_C2_Log_Enabled(logLevel, flag)) {
             __android_log_vprint(ANDROID_LOG_DEBUG, tag, msg, argptr);
         }
     }
     break;
     case ROCKCHIP_LOG_DEBUG: {
-        Rockchip_C2_GetEnvU32("vendor.c2.log.debug", &value, 0);
-        if (value & flag) {
+        if (_Rockchip_C2_Log_Enabled(logLevel, flag)) {
             __android_log_vprint(ANDROID_LOG_DEBUG, tag, msg, argptr);
         }
     } break;
@@ -57,5 +124,3 @@ void _Rockchip_C2_Log(ROCKCHIP_LOG_LEVEL logLevel, C2_U32 flag, const char *tag,
 
     va_end(argptr);
 }
-
-
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef  ROCKCHIP_LOG_TAG
+#define ROCKCHIP_LOG_TAG    "C2RKMemoryBudget"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <chrono>
+
+#include "C2RKMemoryBudget.h"
+#include "C2RKLog.h"
+#include "C2RKEnv.h"
+
+#define C2_PSI_MEMORY_PATH      "/proc/pressure/memory"
+#define C2_PSI_WINDOW_US        1000000
+/* how long shares stay reduced after the last pressure event */
+#define C2_PSI_HOLD_US          10000000
+#define C2_PSI_POLL_MS          1000
+
+namespace {
+
+int64_t getNowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+C2RKMemoryBudget* C2RKMemoryBudget::get() {
+    static C2RKMemoryBudget *sBudget = [] {
+        C2_U32 budgetMb = 0, stallMs = 0;
+        Rockchip_C2_GetEnvU32("vendor.c2.dec.mem.budget", &budgetMb, 0);
+        Rockchip_C2_GetEnvU32("vendor.c2.dec.mem.psi_ms", &stallMs, 150);
+        return new C2RKMemoryBudget((uint64_t)budgetMb << 20, (uint32_t)stallMs);
+    }();
+
+    return sBudget;
+}
+
+C2RKMemoryBudget::C2RKMemoryBudget(uint64_t budget, uint32_t stallMs)
+    : mBudget(budget),
+      mPressureUntilUs(0),
+      mPsiFd(-1),
+      mExit(false) {
+    if (stallMs > 0 && openPsi(stallMs)) {
+        mThread = std::thread(&C2RKMemoryBudget::threadLoop, this);
+    }
+
+    c2_info("budget %llu MiB, psi %s", (unsigned long long)(mBudget >> 20),
+            (mPsiFd >= 0) ? "on" : "off");
+}
+
+C2RKMemoryBudget::~C2RKMemoryBudget() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+
+    /* the thread wakes up at the latest after a poll period */
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+
+    if (mPsiFd >= 0) {
+        close(mPsiFd);
+        mPsiFd = -1;
+    }
+}
+
+bool C2RKMemoryBudget::openPsi(uint32_t stallMs) {
+    char trigger[64];
+    int len = 0;
+
+    mPsiFd = open(C2_PSI_MEMORY_PATH, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (mPsiFd < 0) {
+        c2_warn("failed to open %s, %s", C2_PSI_MEMORY_PATH, strerror(errno));
+        return false;
+    }
+
+    len = snprintf(trigger, sizeof(trigger), "some %u %u",
+                   stallMs * 1000, C2_PSI_WINDOW_US);
+    if (write(mPsiFd, trigger, len + 1) < 0) {
+        c2_warn("failed to set psi trigger, %s", strerror(errno));
+        close(mPsiFd);
+        mPsiFd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+void C2RKMemoryBudget::threadLoop() {
+    pthread_setname_np(pthread_self(), "C2RKMemBudget");
+
+    while (true) {
+        struct pollfd fds;
+
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            if (mExit) {
+                break;
+            }
+        }
+
+        fds.fd = mPsiFd;
+        fds.events = POLLPRI;
+        fds.revents = 0;
+
+        int ret = poll(&fds, 1, C2_PSI_POLL_MS);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            c2_err("psi poll failed, %s", strerror(errno));
+            break;
+        }
+
+        if (ret > 0 && (fds.revents & POLLERR)) {
+            c2_warn("psi monitor gone, stop watching");
+            break;
+        }
+
+        if (ret > 0 && (fds.revents & POLLPRI)) {
+            std::lock_guard<std::mutex> lock(mLock);
+            if (mPressureUntilUs < getNowUs()) {
+                c2_info("memory pressure, reduce output buffers");
+            }
+            mPressureUntilUs = getNowUs() + C2_PSI_HOLD_US;
+        }
+    }
+}
+
+void C2RKMemoryBudget::attach(const void *owner) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mOwners.insert(owner);
+}
+
+void C2RKMemoryBudget::detach(const void *owner) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mOwners.erase(owner);
+}
+
+uint32_t C2RKMemoryBudget::getBufferCount(
+        const void *owner, size_t frameSize, uint32_t minCount, uint32_t maxCount) {
+    uint32_t count = maxCount;
+
+    std::lock_guard<std::mutex> lock(mLock);
+
+    bool pressure = (getNowUs() < mPressureUntilUs);
+
+    if (mBudget > 0 && frameSize > 0) {
+        size_t owners = mOwners.size();
+        uint64_t share = 0;
+
+        if (mOwners.find(owner) == mOwners.end()) {
+            owners++;
+        }
+        share = mBudget / owners;
+        if (pressure) {
+            share /= 2;
+        }
+        if (share / frameSize < maxCount) {
+            count = (uint32_t)(share / frameSize);
+        }
+    } else if (pressure) {
+        count = maxCount / 2;
+    }
+
+    if (count < minCount) {
+        count = minCount;
+    }
+    if (count > maxCount) {
+        count = maxCount;
+    }
+
+    return count;
+}
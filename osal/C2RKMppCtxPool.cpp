@@ -0,0 +1,216 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef  ROCKCHIP_LOG_TAG
+#define ROCKCHIP_LOG_TAG    "C2RKMppCtxPool"
+
+#include "C2RKMppCtxPool.h"
+#include "C2RKLog.h"
+#include "C2RKEnv.h"
+
+/* upper bound of idle contexts per key */
+#define C2_MPP_CTX_POOL_MAX_DEPTH   4
+
+C2RKMppCtxPool* C2RKMppCtxPool::get() {
+    static C2RKMppCtxPool *sPool = [] {
+        C2_U32 depth = 0;
+        Rockchip_C2_GetEnvU32("vendor.c2.mppctx.pool", &depth, 0);
+        if (depth > C2_MPP_CTX_POOL_MAX_DEPTH) {
+            depth = C2_MPP_CTX_POOL_MAX_DEPTH;
+        }
+        return new C2RKMppCtxPool((uint32_t)depth);
+    }();
+
+    return sPool;
+}
+
+C2RKMppCtxPool::C2RKMppCtxPool(uint32_t depth)
+    : mDepth(depth),
+      mHits(0),
+      mMisses(0),
+      mExit(false) {
+    if (mDepth > 0) {
+        mThread = std::thread(&C2RKMppCtxPool::threadLoop, this);
+    }
+}
+
+C2RKMppCtxPool::~C2RKMppCtxPool() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    mCond.notify_one();
+
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+
+    for (auto &it : mIdle) {
+        for (Context &context : it.second) {
+            mpp_destroy(context.ctx);
+        }
+    }
+    mIdle.clear();
+}
+
+/*
+ * controls that have to be issued before mpp_init, the same for every
+ * component of a key. everything depending on the stream is left to the
+ * component after take().
+ */
+MPP_RET C2RKMppCtxPool::createContext(const Key &key, Context *context) {
+    MPP_RET err = MPP_OK;
+
+    context->ctx = nullptr;
+    context->mpi = nullptr;
+
+    err = mpp_create(&context->ctx, &context->mpi);
+    if (err != MPP_OK) {
+        c2_err("failed to mpp_create, ret %d", err);
+        goto error;
+    }
+
+    if (key.first == MPP_CTX_DEC) {
+        // TODO: workround: CTS-CodecDecoderTest
+        // testFlushNative[15(c2.rk.mpeg2.decoder_video/mpeg2)
+        if (key.second == MPP_VIDEO_CodingMPEG2) {
+            uint32_t vmode = 0, split = 1;
+            context->mpi->control(context->ctx, MPP_DEC_SET_ENABLE_DEINTERLACE, &vmode);
+            context->mpi->control(context->ctx, MPP_DEC_SET_PARSER_SPLIT_MODE, &split);
+        } else {
+            // enable deinterlace, but not decting
+            uint32_t vmode = 1;
+            context->mpi->control(context->ctx, MPP_DEC_SET_ENABLE_DEINTERLACE, &vmode);
+        }
+
+        // enable fast mode,
+        uint32_t fastParser = 1;
+        context->mpi->control(context->ctx, MPP_DEC_SET_PARSER_FAST_MODE, &fastParser);
+    } else {
+        MppPollType timeout = MPP_POLL_BLOCK;
+        err = context->mpi->control(context->ctx, MPP_SET_OUTPUT_TIMEOUT, &timeout);
+        if (err != MPP_OK) {
+            c2_err("failed to set output timeout %d, ret %d", timeout, err);
+            goto error;
+        }
+    }
+
+    err = mpp_init(context->ctx, key.first, key.second);
+    if (err != MPP_OK) {
+        c2_err("failed to mpp_init, ret %d", err);
+        goto error;
+    }
+
+    return MPP_OK;
+
+error:
+    if (context->ctx) {
+        mpp_destroy(context->ctx);
+        context->ctx = nullptr;
+        context->mpi = nullptr;
+    }
+
+    return (err != MPP_OK) ? err : MPP_NOK;
+}
+
+void C2RKMppCtxPool::prepare(MppCtxType type, MppCodingType codingType) {
+    if (mDepth == 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mPending.insert(Key(type, codingType));
+    }
+    mCond.notify_one();
+}
+
+MPP_RET C2RKMppCtxPool::take(
+        MppCtxType type, MppCodingType codingType, MppCtx *ctx, MppApi **mpi) {
+    Key key(type, codingType);
+    Context context;
+
+    if (mDepth > 0) {
+        bool hit = false;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            std::list<Context> &idle = mIdle[key];
+            if (!idle.empty()) {
+                context = idle.front();
+                idle.pop_front();
+                hit = true;
+                mHits++;
+            } else {
+                mMisses++;
+            }
+            mPending.insert(key);
+            c2_info("take type %d coding %d %s, hits %u misses %u", type, codingType,
+                    hit ? "from pool" : "inline", mHits, mMisses);
+        }
+        mCond.notify_one();
+
+        if (hit) {
+            *ctx = context.ctx;
+            *mpi = context.mpi;
+            return MPP_OK;
+        }
+    }
+
+    MPP_RET err = createContext(key, &context);
+    if (err == MPP_OK) {
+        *ctx = context.ctx;
+        *mpi = context.mpi;
+    }
+
+    return err;
+}
+
+void C2RKMppCtxPool::put(MppCtx ctx) {
+    if (ctx != nullptr) {
+        mpp_destroy(ctx);
+    }
+}
+
+void C2RKMppCtxPool::threadLoop() {
+    while (true) {
+        Key key;
+
+        {
+            std::unique_lock<std::mutex> lock(mLock);
+            mCond.wait(lock, [this] { return mExit || !mPending.empty(); });
+            if (mExit) {
+                break;
+            }
+            key = *mPending.begin();
+            if (mIdle[key].size() >= mDepth) {
+                mPending.erase(mPending.begin());
+                continue;
+            }
+        }
+
+        /* creation takes a while, do it outside the lock */
+        Context context;
+        MPP_RET err = createContext(key, &context);
+
+        std::lock_guard<std::mutex> lock(mLock);
+        if (err != MPP_OK) {
+            c2_err("failed to warm type %d coding %d, ret %d", key.first, key.second, err);
+            mPending.erase(key);
+            continue;
+        }
+        mIdle[key].push_back(context);
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef  ROCKCHIP_LOG_TAG
+#define ROCKCHIP_LOG_TAG    "C2RKPacketStats"
+
+#include <string.h>
+
+#include "C2RKPacketStats.h"
+
+C2RKPacketStats::C2RKPacketStats() {
+    reset();
+}
+
+void C2RKPacketStats::reset() {
+    memset(mBins, 0, sizeof(mBins));
+    mTotal = 0;
+    mCount = 0;
+    mSyncCount = 0;
+    mMax = 0;
+}
+
+void C2RKPacketStats::add(size_t size, bool sync) {
+    size_t bin = size / kBinSize;
+
+    /* the last bin collects everything larger */
+    if (bin >= kBinCount) {
+        bin = kBinCount - 1;
+    }
+
+    if (mTotal >= kWindow) {
+        mTotal = 0;
+        for (uint32_t i = 0; i < kBinCount; i++) {
+            mBins[i] >>= 1;
+            mTotal += mBins[i];
+        }
+    }
+
+    mBins[bin]++;
+    mTotal++;
+    mCount++;
+
+    if (sync) {
+        mSyncCount++;
+    }
+    if (size > mMax) {
+        mMax = size;
+    }
+}
+
+size_t C2RKPacketStats::getPercentile(uint32_t percent) const {
+    uint32_t target = 0;
+    uint32_t sum = 0;
+
+    if (mTotal == 0) {
+        return 0;
+    }
+
+    target = (uint32_t)(((uint64_t)mTotal * percent + 99) / 100);
+
+    for (uint32_t i = 0; i < kBinCount - 1; i++) {
+        sum += mBins[i];
+        if (sum >= target) {
+            return (i + 1) * kBinSize;
+        }
+    }
+
+    return mMax;
+}
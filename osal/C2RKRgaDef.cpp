@@ -150,3 +150,60 @@ bool C2RKRgaDef::nv12Copy(RgaParam srcParam, RgaParam dstParam) {
 
     return ret;
 }
+
+bool C2RKRgaDef::blit(RgaParam srcParam, int32_t srcFormat,
+                      RgaParam dstParam, int32_t dstFormat) {
+    bool ret = true;
+
+    rga_info_t src;
+    rga_info_t dst;
+    rga_buffer_handle_t srcHdl;
+    rga_buffer_handle_t dstHdl;
+
+    RockchipRga& rkRga(RockchipRga::get());
+
+    c2_trace("rga src fd %d fmt 0x%x rect[%d, %d, %d, %d, %d, %d]",
+             srcParam.fd, srcFormat, srcParam.left, srcParam.top, srcParam.width,
+             srcParam.height, srcParam.wstride, srcParam.hstride);
+    c2_trace("rga dst fd %d fmt 0x%x rect[%d, %d, %d, %d, %d, %d]",
+             dstParam.fd, dstFormat, dstParam.left, dstParam.top, dstParam.width,
+             dstParam.height, dstParam.wstride, dstParam.hstride);
+
+    memset((void*)&src, 0, sizeof(rga_info_t));
+    memset((void*)&dst, 0, sizeof(rga_info_t));
+
+    /* import whole buffer, the crop goes to the rect */
+    RgaParam srcWhole = srcParam;
+    srcWhole.width  = srcParam.wstride;
+    srcWhole.height = srcParam.hstride;
+
+    RgaParam dstWhole = dstParam;
+    dstWhole.width  = dstParam.wstride;
+    dstWhole.height = dstParam.hstride;
+
+    srcHdl = importRgaBuffer(&srcWhole, srcFormat);
+    dstHdl = importRgaBuffer(&dstWhole, dstFormat);
+    if (!srcHdl || !dstHdl) {
+        c2_err("failed to import rga buffer");
+        if (srcHdl) freeRgaBuffer(srcHdl);
+        if (dstHdl) freeRgaBuffer(dstHdl);
+        return false;
+    }
+
+    src.handle = srcHdl;
+    dst.handle = dstHdl;
+    rga_set_rect(&src.rect, srcParam.left, srcParam.top, srcParam.width,
+                 srcParam.height, srcParam.wstride, srcParam.hstride, srcFormat);
+    rga_set_rect(&dst.rect, dstParam.left, dstParam.top, dstParam.width,
+                 dstParam.height, dstParam.wstride, dstParam.hstride, dstFormat);
+
+    if (rkRga.RkRgaBlit(&src, &dst, NULL)) {
+        c2_err("RgaBlit fail, blit fmt 0x%x -> 0x%x", srcFormat, dstFormat);
+        ret = false;
+    }
+
+    freeRgaBuffer(srcHdl);
+    freeRgaBuffer(dstHdl);
+
+    return ret;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_C2_RK_BITSTREAM_H_
+#define ANDROID_C2_RK_BITSTREAM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "mpp/rk_type.h"
+
+/*
+ * Light inspection of compressed access units, only the few header bits
+ * needed are parsed, nothing is validated.
+ */
+class C2RKBitstream {
+public:
+    /*
+     * true if the access unit decodes without earlier pictures: idr or
+     * intra slices for avc, irap for hevc, key frames for vpx and av1,
+     * intra pictures for mpeg2 and mpeg4. codecs not inspected always
+     * return true.
+     */
+    static bool isSyncFrame(MppCodingType codingType, const uint8_t *data, size_t size);
+
+    /*
+     * true if no later picture references this access unit, so it can be
+     * skipped without corrupting the stream: nal_ref_idc 0 for avc,
+     * sub-layer non-reference pictures of the highest sub-layer
+     * |maxTemporalId| for hevc, B pictures for mpeg2. false if unknown,
+     * always for hevc with a negative |maxTemporalId|.
+     */
+    static bool isNonRefFrame(MppCodingType codingType, const uint8_t *data, size_t size,
+                              int32_t maxTemporalId = -1);
+
+    /* highest temporal id from a hevc sps in the access unit, -1 if none */
+    static int32_t getMaxTemporalId(MppCodingType codingType, const uint8_t *data, size_t size);
+
+    /*
+     * pictures the dpb keeps besides the one being decoded, from an sps in
+     * front of the first slice: max_num_ref_frames for avc, the highest
+     * sps_max_dec_pic_buffering_minus1 for hevc. capped at 16, -1 if none.
+     */
+    static int32_t getRefFrameCount(MppCodingType codingType, const uint8_t *data, size_t size);
+};
+
+#endif  // ANDROID_C2_RK_BITSTREAM_H_
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * module: hardware capacity def.
+ */
+
+#ifndef SRC_RT_MEDIA_INCLUDE_C2RKCAPACITYDEF_H_
+#define SRC_RT_MEDIA_INCLUDE_C2RKCAPACITYDEF_H_
+
+#include <stdint.h>
+#include <map>
+#include <mutex>
+
+#include <C2.h>
+
+#include "C2RKChips.h"
+#include "mpp/rk_type.h"
+
+/* macroblocks per second of a width x height stream at fps */
+#define C2_CAP_MBPS(w, h, fps) \
+    ((uint64_t)(((w) + 15) >> 4) * (((h) + 15) >> 4) * (fps))
+
+typedef struct {
+    MppCodingType codingType;
+    uint64_t      decMbps;      /* decoder macroblocks per second, 0 no limit */
+    uint64_t      encMbps;      /* encoder macroblocks per second, 0 no limit */
+} C2CodecCapacity;
+
+typedef struct {
+    const char            *chipName;
+    RKChipType             chipType;
+    int                    codecNum;
+    const C2CodecCapacity *codecs;
+} C2CapacityInfo;
+
+typedef struct {
+    MppCtxType    type;
+    MppCodingType codingType;
+    uint32_t      width;
+    uint32_t      height;
+    float         frameRate;
+} C2CapacityRequest;
+
+class C2RKCapacityDef {
+public:
+    static const C2CapacityInfo* findCapacityInfo(const char *chipName);
+};
+
+/*
+ * Admission control of the decoder and encoder cores. Every session takes
+ * a share of its core, that is its load over the macroblock rate the core
+ * reaches for that codec, and a session that does not fit fails to start
+ * instead of degrading the running ones.
+ */
+class C2RKCapacity {
+public:
+    /* process wide model of the probed chip */
+    static C2RKCapacity* get();
+
+    /* a NULL info admits everything, synthetic profiles work for tests */
+    explicit C2RKCapacity(const C2CapacityInfo *info);
+
+    /*
+     * reserve capacity for |request|, the id is needed to release it.
+     * returns C2_NO_MEMORY if the core can not take the session.
+     */
+    c2_status_t reserve(const C2CapacityRequest &request, int32_t *id);
+    void release(int32_t id);
+
+    /*
+     * move reservation |id| to a new |request| of the same session, e.g.
+     * after an info-change. returns C2_NO_MEMORY and keeps the old share
+     * if the core can not take the new load.
+     */
+    c2_status_t update(int32_t id, const C2CapacityRequest &request);
+
+    /* macroblocks per second still available for a codec, UINT64_MAX if no limit */
+    uint64_t getAvailableMbps(MppCtxType type, MppCodingType codingType);
+
+private:
+    /* shares are in units of 1/kShareFull of a core */
+    static const uint32_t kShareFull = 1000000;
+
+    const C2CapacityInfo *mInfo;
+
+    std::mutex mLock;
+    int32_t    mNextId;
+    uint32_t   mUsed[MPP_CTX_BUTT];
+    std::map<int32_t, std::pair<MppCtxType, uint32_t>> mReservations;
+
+    uint64_t getCapacityMbps(MppCtxType type, MppCodingType codingType) const;
+    /* share of |request| on its core, false if the core is not limited */
+    bool getShare(const C2CapacityRequest &request, uint32_t *share) const;
+};
+
+#endif  // SRC_RT_MEDIA_INCLUDE_C2RKCAPACITYDEF_H_
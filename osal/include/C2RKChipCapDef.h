@@ -0,0 +1,60 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * module: chip capability def.
+ */
+
+#ifndef SRC_RT_MEDIA_INCLUDE_C2RKCHIPCAPDEF_H_
+#define SRC_RT_MEDIA_INCLUDE_C2RKCHIPCAPDEF_H_
+
+#include <stdio.h>
+#include "C2RKChips.h"
+#include "C2RKFbcDef.h"
+#include "C2RKCapacityDef.h"
+#include "mpp/mpp_soc.h"
+#include "mpp/mpp_buffer.h"
+
+/*
+ * all the per-chip static capabilities, probed once per process.
+ */
+typedef struct {
+    RKChipInfo        *chipInfo;        /* NULL if chip unknown */
+    int                grallocVersion;
+    int                fbcCapNum;
+    const C2FbcCaps   *fbcCaps;
+    const C2CapacityInfo *capacityInfo; /* NULL if not modeled */
+    const MppSocInfo  *socInfo;         /* from libmpp, may be NULL */
+    MppBufferType      importBufferType; /* dma-bufs handed to mpp */
+    MppBufferType      allocBufferType;  /* buffers mpp allocates, with flags */
+} C2ChipCapInfo;
+
+class C2RKChipCapDef {
+public:
+    static const C2ChipCapInfo* get();
+
+    static RKChipType getChipType();
+    static const C2FbcCaps* getFbcCaps(MppCodingType codecId);
+
+    /*
+     * buffer types for mpp, picked from the allocators the kernel has
+     * (ion, dma-heap, drm) unless vendor.c2.buffer.type is ion, dma or
+     * drm. vendor.c2.buffer.flags adds MPP_BUFFER_FLAGS_* to drm
+     * allocations.
+     */
+    static MppBufferType getImportBufferType();
+    static MppBufferType getAllocBufferType();
+};
+
+#endif  // SRC_RT_MEDIA_INCLUDE_C2RKCHIPCAPDEF_H_
@@ -101,6 +101,9 @@ static const RKChipInfo ChipList[] = {
     {"rk3588",    RK_CHIP_3588},
 };
 
+/* reads efuse, device tree and cpuinfo, use getChipName() instead */
+RKChipInfo* probeChipName();
+/* cached result of probeChipName() */
 RKChipInfo* getChipName();
 
 #endif  // C2_RK_CHIPS_H_
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_C2_RK_DUMP_H__
+#define ANDROID_C2_RK_DUMP_H__
+
+#include <stdint.h>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+/*
+ * Background writer for debug dumps. write() only copies into a bounded
+ * memory ring, a writer thread flushes the ring to file. Chunks that do
+ * not fit into the ring are dropped whole and accounted.
+ */
+class C2RKDump {
+public:
+    static C2RKDump* open(const char *fileName, size_t ringSize = 0);
+    ~C2RKDump();
+
+    void write(const void *data, size_t size);
+
+private:
+    C2RKDump(int fd, const char *fileName, size_t ringSize);
+
+    void threadLoop();
+
+    int                      mFd;
+    char                     mFileName[128];
+
+    uint8_t                 *mRing;
+    size_t                   mRingSize;
+    size_t                   mHead;     /* write position */
+    size_t                   mTail;     /* read position */
+    size_t                   mUsed;
+
+    bool                     mExit;
+    uint64_t                 mWritten;
+    uint64_t                 mDropBytes;
+    uint32_t                 mDropCount;
+
+    std::mutex               mLock;
+    std::condition_variable  mCond;
+    std::thread              mThread;
+};
+
+#endif  // ANDROID_C2_RK_DUMP_H__
@@ -50,6 +50,7 @@ typedef struct {
 
 class C2RKFbcDef {
  public:
+    static const C2FbcInfo* findFbcInfo(const char *chipName);
     static int   getFbcOutputMode(MppCodingType codecId);
     static void  getFbcOutputOffset(MppCodingType codecId, uint32_t *offsetX, uint32_t *offsetY);
 };
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_C2_RK_FRAME_POOL_H__
+#define ANDROID_C2_RK_FRAME_POOL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "mpp/rk_mpi.h"
+
+/*
+ * Per process pool of dma-buf frame buffers shared by buffer mode
+ * decoders. Each decoder reserves the buffers the dpb of its stream
+ * needs, of the exact size mpp asked for, and gives all of them back on
+ * info-change, flush or release. Buffers are not shared between running
+ * decoders; ones given back stay idle for the next decoder of the same
+ * geometry, up to vendor.c2.dec.shared_pool of them. A pool size of 0
+ * disables sharing and decoders keep mpp internal buffers.
+ */
+class C2RKFramePool {
+public:
+    static C2RKFramePool* get();
+
+    explicit C2RKFramePool(uint32_t maxIdle);
+    ~C2RKFramePool();
+
+    bool isEnabled() const { return mMaxIdle > 0; }
+
+    /* add |count| buffers of |size| bytes to the reservation of |owner| */
+    MPP_RET reserve(const void *owner, size_t size, uint32_t count,
+                    std::vector<MppBuffer> *buffers);
+
+    /* give back everything |owner| reserved */
+    void unreserve(const void *owner);
+
+private:
+    struct Entry {
+        size_t    size;
+        MppBuffer buffer;
+    };
+
+    uint32_t                                 mMaxIdle;
+    uint32_t                                 mAllocated;
+    MppBufferGroup                           mGroup;
+
+    std::list<Entry>                         mIdle;     /* recently returned first */
+    std::map<const void *, std::list<Entry>> mReserved;
+
+    std::mutex                               mLock;
+};
+
+#endif  // ANDROID_C2_RK_FRAME_POOL_H__
@@ -31,6 +31,7 @@ typedef struct {
 
 class C2RKGrallocDef {
 public:
+    static const C2GrallocInfo* findGrallocInfo(const char *chipName);
     static uint32_t   getGrallocVersion();
     static uint32_t   getAndroidVerison();
 };
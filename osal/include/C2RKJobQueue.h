@@ -0,0 +1,57 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_C2_RK_JOB_QUEUE_H__
+#define ANDROID_C2_RK_JOB_QUEUE_H__
+
+#include <stdint.h>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+/*
+ * Single thread that runs posted jobs in order. post() blocks while
+ * maxPending jobs are queued, so a slow consumer throttles the producer
+ * instead of piling up buffers. Remaining jobs still run on destruction.
+ */
+class C2RKJobQueue {
+public:
+    C2RKJobQueue(const char *name, uint32_t maxPending);
+    ~C2RKJobQueue();
+
+    void post(std::function<void()> job);
+
+    /* return once every job posted so far has run */
+    void waitIdle();
+
+private:
+    char                              mName[16];
+    uint32_t                          mMaxPending;
+
+    std::list<std::function<void()>>  mJobs;
+    bool                              mRunning;   /* a job is out of the list */
+    bool                              mExit;
+
+    std::mutex                        mLock;
+    std::condition_variable           mCond;
+    std::thread                       mThread;
+
+    void threadLoop();
+};
+
+#endif  // ANDROID_C2_RK_JOB_QUEUE_H__
@@ -46,20 +46,39 @@ typedef enum _LOG_LEVEL
 #define C2_DBG_CAPACITYS               0x00000001
 
 void _Rockchip_C2_Log(ROCKCHIP_LOG_LEVEL logLevel, C2_U32 flag, const char *tag, const char *msg, ...);
+/* cheap check of cached log properties, refreshed when the property changes */
+int  _Rockchip_C2_Log_Enabled(ROCKCHIP_LOG_LEVEL logLevel, C2_U32 flag);
+
+/*
+ * C2_LOG_TRACE_DISABLE compiles trace and debug logs out, set through the
+ * rockchip_codec2 log_trace_disable soong config variable, see Android.bp.
+ * arguments are still referenced so that no unused warning comes up.
+ */
+#ifdef C2_LOG_TRACE_DISABLE
+#define _c2_log_on(level, flag)  0
+#else
+#define _c2_log_on(level, flag)  _Rockchip_C2_Log_Enabled(level, flag)
+#endif
+
+#define _c2_log_cond(level, flag, fmt, ...) \
+            do { \
+                if (_c2_log_on(level, flag)) \
+                    _Rockchip_C2_Log(level, flag, ROCKCHIP_LOG_TAG, fmt, ##__VA_ARGS__); \
+            } while (0)
 
 #define c2_info(fmt, ...)        _Rockchip_C2_Log(ROCKCHIP_LOG_INFO,     C2_DBG_UNKNOWN, ROCKCHIP_LOG_TAG, fmt "\n", ##__VA_ARGS__)
-#define c2_trace(fmt, ...)       _Rockchip_C2_Log(ROCKCHIP_LOG_TRACE,    C2_DBG_UNKNOWN, ROCKCHIP_LOG_TAG, fmt "\n", ##__VA_ARGS__)
+#define c2_trace(fmt, ...)       _c2_log_cond(ROCKCHIP_LOG_TRACE,        C2_DBG_UNKNOWN, fmt "\n", ##__VA_ARGS__)
 #define c2_err(fmt, ...)         _Rockchip_C2_Log(ROCKCHIP_LOG_ERROR,    C2_DBG_UNKNOWN, ROCKCHIP_LOG_TAG, fmt "\n", ##__VA_ARGS__)
 #define c2_warn(fmt, ...)        _Rockchip_C2_Log(ROCKCHIP_LOG_WARNING,  C2_DBG_UNKNOWN, ROCKCHIP_LOG_TAG, fmt "\n", ##__VA_ARGS__)
 
 #define c2_info_f(fmt, ...)      _Rockchip_C2_Log(ROCKCHIP_LOG_INFO,     C2_DBG_UNKNOWN, ROCKCHIP_LOG_TAG, "%s(%d): " fmt "\n",__FUNCTION__, __LINE__, ##__VA_ARGS__)
-#define c2_trace_f(fmt, ...)     _Rockchip_C2_Log(ROCKCHIP_LOG_TRACE,    C2_DBG_UNKNOWN, ROCKCHIP_LOG_TAG, "%s(%d): " fmt "\n",__FUNCTION__, __LINE__, ##__VA_ARGS__)
+#define c2_trace_f(fmt, ...)     _c2_log_cond(ROCKCHIP_LOG_TRACE,        C2_DBG_UNKNOWN, "%s(%d): " fmt "\n",__FUNCTION__, __LINE__, ##__VA_ARGS__)
 #define c2_err_f(fmt, ...)       _Rockchip_C2_Log(ROCKCHIP_LOG_ERROR,    C2_DBG_UNKNOWN, ROCKCHIP_LOG_TAG, "%s(%d): " fmt "\n",__FUNCTION__, __LINE__, ##__VA_ARGS__)
 #define c2_warn_f(fmt, ...)      _Rockchip_C2_Log(ROCKCHIP_LOG_WARNING,  C2_DBG_UNKNOWN, ROCKCHIP_LOG_TAG, "%s(%d): " fmt "\n",__FUNCTION__, __LINE__, ##__VA_ARGS__)
 
 #define _c2_dbg(fmt, ...)          _Rockchip_C2_Log(ROCKCHIP_LOG_INFO,     C2_DBG_UNKNOWN, ROCKCHIP_LOG_TAG, "%s(%d): " fmt "\n",__FUNCTION__, __LINE__, ##__VA_ARGS__)
 
-#define c2_dbg_f(flags, fmt, ...)  _Rockchip_C2_Log(ROCKCHIP_LOG_DEBUG, flags, ROCKCHIP_LOG_TAG, "%s(%d): " fmt "\n",__FUNCTION__, __LINE__, ##__VA_ARGS__)
+#define c2_dbg_f(flags, fmt, ...)  _c2_log_cond(ROCKCHIP_LOG_DEBUG, flags, "%s(%d): " fmt "\n",__FUNCTION__, __LINE__, ##__VA_ARGS__)
 
 #define c2_dbg(debug, flag, fmt, ...) \
             do { \
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_C2_RK_MEMORY_BUDGET_H__
+#define ANDROID_C2_RK_MEMORY_BUDGET_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <set>
+#include <mutex>
+#include <thread>
+
+/*
+ * Per process budget of decoder output buffers. vendor.c2.dec.mem.budget
+ * (MiB, 0 for none) is split evenly between attached decoders, and a
+ * thread watching /proc/pressure/memory halves every share for a while
+ * after a stall above vendor.c2.dec.mem.psi_ms per second is reported.
+ */
+class C2RKMemoryBudget {
+public:
+    static C2RKMemoryBudget* get();
+
+    C2RKMemoryBudget(uint64_t budget, uint32_t stallMs);
+    ~C2RKMemoryBudget();
+
+    void attach(const void *owner);
+    void detach(const void *owner);
+
+    /*
+     * output buffers |owner| should hold for frames of |frameSize| bytes,
+     * never below |minCount| nor above |maxCount|
+     */
+    uint32_t getBufferCount(
+            const void *owner, size_t frameSize, uint32_t minCount, uint32_t maxCount);
+
+private:
+    uint64_t               mBudget;            /* bytes, 0 if unlimited */
+    std::set<const void *> mOwners;
+    int64_t                mPressureUntilUs;
+
+    int                    mPsiFd;
+    bool                   mExit;
+    std::mutex             mLock;
+    std::thread            mThread;
+
+    bool openPsi(uint32_t stallMs);
+    void threadLoop();
+};
+
+#endif  // ANDROID_C2_RK_MEMORY_BUDGET_H__
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_C2_RK_MPP_CTX_POOL_H__
+#define ANDROID_C2_RK_MPP_CTX_POOL_H__
+
+#include <stdint.h>
+#include <list>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "mpp/rk_mpi.h"
+
+/*
+ * Per process set of idle mpp contexts that already passed mpp_create,
+ * the pre-init controls and mpp_init, keyed by (ctx type, coding type).
+ * A background thread keeps vendor.c2.mppctx.pool contexts ready for every
+ * key seen, so a component start or a channel switch skips the setup.
+ * With a pool depth of 0 take() creates the context inline.
+ */
+class C2RKMppCtxPool {
+public:
+    static C2RKMppCtxPool* get();
+
+    explicit C2RKMppCtxPool(uint32_t depth);
+    ~C2RKMppCtxPool();
+
+    /* start warming contexts of a key ahead of the first take() */
+    void prepare(MppCtxType type, MppCodingType codingType);
+
+    /* context ready for the post-init controls, created inline on a miss */
+    MPP_RET take(MppCtxType type, MppCodingType codingType, MppCtx *ctx, MppApi **mpi);
+
+    /*
+     * give back a context from take(). a used context keeps stream state
+     * and may reference buffer groups of its owner, so it is destroyed
+     * here and never handed out again.
+     */
+    void put(MppCtx ctx);
+
+private:
+    typedef std::pair<MppCtxType, MppCodingType> Key;
+
+    struct Context {
+        MppCtx  ctx;
+        MppApi *mpi;
+    };
+
+    uint32_t                         mDepth;
+    uint32_t                         mHits;
+    uint32_t                         mMisses;
+
+    std::map<Key, std::list<Context>> mIdle;
+    std::set<Key>                    mPending;   /* keys to refill */
+
+    bool                             mExit;
+    std::mutex                       mLock;
+    std::condition_variable          mCond;
+    std::thread                      mThread;
+
+    static MPP_RET createContext(const Key &key, Context *context);
+
+    void threadLoop();
+};
+
+#endif  // ANDROID_C2_RK_MPP_CTX_POOL_H__
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_C2_RK_PACKET_STATS_H_
+#define ANDROID_C2_RK_PACKET_STATS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Running size statistics of the packets of one stream. Sizes go into a
+ * histogram of fixed width bins whose counts are halved once the window
+ * is full, so percentiles follow the recent part of the stream while the
+ * max is kept for the whole stream.
+ */
+class C2RKPacketStats {
+public:
+    C2RKPacketStats();
+
+    void reset();
+    void add(size_t size, bool sync);
+
+    /* upper bound of the bin holding the given percentile, 0 if empty */
+    size_t getPercentile(uint32_t percent) const;
+
+    size_t   getMax() const       { return mMax; }
+    uint32_t getCount() const     { return mCount; }
+    uint32_t getSyncCount() const { return mSyncCount; }
+
+private:
+    static const uint32_t kBinCount = 64;
+    static const size_t   kBinSize  = 32 * 1024;
+    static const uint32_t kWindow   = 512;
+
+    uint32_t mBins[kBinCount];
+    uint32_t mTotal;        /* sum of mBins after decay */
+    uint32_t mCount;        /* packets seen */
+    uint32_t mSyncCount;
+    size_t   mMax;
+};
+
+#endif  // ANDROID_C2_RK_PACKET_STATS_H_
@@ -25,6 +25,8 @@ typedef struct {
     int32_t height;
     int32_t wstride;
     int32_t hstride;
+    int32_t left;
+    int32_t top;
 } RgaParam;
 
 class C2RKRgaDef {
@@ -35,6 +37,13 @@ public:
 
     static bool rgbToNv12(RgaParam srcParam, RgaParam dstParam);
     static bool nv12Copy(RgaParam srcParam, RgaParam dstParam);
+
+    /*
+     * generic blit between two hal pixel formats, the src rect at
+     * (left, top, width, height) gets scaled into the dst rect.
+     */
+    static bool blit(RgaParam srcParam, int32_t srcFormat,
+                     RgaParam dstParam, int32_t dstFormat);
 };
 
 #endif  // ANDROID_C2_RK_RGA_DEF_H__
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_C2_RK_TRACE_H__
+#define ANDROID_C2_RK_TRACE_H__
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <cutils/trace.h>
+
+/*
+ * Pipeline stage events for systrace/perfetto, recorded under the "video"
+ * atrace category. Names are only formatted while the category is enabled.
+ */
+#define C2_TRACE_TAG        ATRACE_TAG_VIDEO
+#define C2_TRACE_NAME_LEN   96
+
+#define C2_TRACE_ENABLED()  (atrace_is_tag_enabled(C2_TRACE_TAG) != 0)
+
+/*
+ * scoped slice named "<stage> #<frameIndex> pts <pts>", or "<stage> pts <pts>"
+ * for outputs that are no longer tied to an input work, or "<stage> #<frameIndex>"
+ * where only the frame index travels with the buffer.
+ */
+class C2RKTraceStage {
+public:
+    C2RKTraceStage(const char *stage, uint64_t frameIndex, int64_t pts)
+        : mEnabled(C2_TRACE_ENABLED()) {
+        if (mEnabled) {
+            char name[C2_TRACE_NAME_LEN];
+            snprintf(name, sizeof(name), "%s #%" PRIu64 " pts %" PRId64,
+                     stage, frameIndex, pts);
+            atrace_begin(C2_TRACE_TAG, name);
+        }
+    }
+
+    C2RKTraceStage(const char *stage, int64_t pts)
+        : mEnabled(C2_TRACE_ENABLED()) {
+        if (mEnabled) {
+            char name[C2_TRACE_NAME_LEN];
+            snprintf(name, sizeof(name), "%s pts %" PRId64, stage, pts);
+            atrace_begin(C2_TRACE_TAG, name);
+        }
+    }
+
+    C2RKTraceStage(const char *stage, uint64_t frameIndex)
+        : mEnabled(C2_TRACE_ENABLED()) {
+        if (mEnabled) {
+            char name[C2_TRACE_NAME_LEN];
+            snprintf(name, sizeof(name), "%s #%" PRIu64, stage, frameIndex);
+            atrace_begin(C2_TRACE_TAG, name);
+        }
+    }
+
+    ~C2RKTraceStage() {
+        if (mEnabled) {
+            atrace_end(C2_TRACE_TAG);
+        }
+    }
+
+private:
+    bool mEnabled;
+};
+
+/* per-instance track, named "<component>#<id> <what>" */
+class C2RKTraceTrack {
+public:
+    C2RKTraceTrack(const char *owner, uint32_t id, const char *what) {
+        snprintf(mName, sizeof(mName), "%s#%u %s", owner, id, what);
+    }
+
+    /* counter track */
+    void set(int64_t value) const {
+        atrace_int64(C2_TRACE_TAG, mName, value);
+    }
+
+    /* async slice track, one slice per cookie */
+    void begin(int32_t cookie) const {
+        atrace_async_begin(C2_TRACE_TAG, mName, cookie);
+    }
+
+    void end(int32_t cookie) const {
+        atrace_async_end(C2_TRACE_TAG, mName, cookie);
+    }
+
+private:
+    char mName[C2_TRACE_NAME_LEN];
+};
+
+#define c2_trace_stage(stage, frameIndex, pts) \
+    C2RKTraceStage c2_trace_stage_scope(stage, frameIndex, pts)
+
+#define c2_trace_stage_pts(stage, pts) \
+    C2RKTraceStage c2_trace_stage_scope(stage, (int64_t)(pts))
+
+#define c2_trace_stage_index(stage, frameIndex) \
+    C2RKTraceStage c2_trace_stage_scope(stage, (uint64_t)(frameIndex))
+
+#endif  // ANDROID_C2_RK_TRACE_H__
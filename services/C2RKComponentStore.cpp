@@ -27,12 +27,14 @@
 #include <C2PlatformStorePluginLoader.h>
 #include <C2PlatformSupport.h>
 #include <cutils/properties.h>
+#include <ui/GraphicBufferMapper.h>
 #include <util/C2InterfaceHelper.h>
 #include <utils/Log.h>
 #include <dlfcn.h>
 #include <unistd.h> // getpagesize
 
 #include "C2RKMediaUtils.h"
+#include "C2RKRgaDef.h"
 #include "C2RKLog.h"
 
 #include <map>
@@ -43,6 +45,9 @@ namespace android {
 
 #define C2_RK_COMPONENT_PATH        "libcodec2_rk_component.so"
 
+/* buffers below this area are cheaper to copy by cpu than to set up rga */
+#define C2_RK_MIN_RGA_COPY_AREA     (64 * 64)
+
 /**
  * Returns the preferred component store in this process to access its interface.
  */
@@ -609,8 +614,8 @@ private:
     /**
      * An object encapsulating a loaded component module.
      *
-     * \todo provide a way to add traits to known components here to avoid loading the .so-s
-     * for listComponents
+     * Traits of known components come from kComponentMapEntry, so the module is only loaded
+     * on createComponent/createInterface.
      */
     struct ComponentModule : public C2ComponentFactory,
             public std::enable_shared_from_this<ComponentModule> {
@@ -621,11 +626,6 @@ private:
                 c2_node_id_t id, std::shared_ptr<C2ComponentInterface> *interface,
                 InterfaceDeleter deleter = std::default_delete<C2ComponentInterface>()) override;
 
-        /**
-         * \returns the traits of the component in this module.
-         */
-        std::shared_ptr<const C2Component::Traits> getTraits();
-
         /**
          * Creates an uninitialized component module.
          *
@@ -663,9 +663,6 @@ private:
         typedef void (*DestroyRKCodec2FactoryFunc)(::C2ComponentFactory*);
 
     protected:
-        std::recursive_mutex mLock; ///< lock protecting mTraits
-        std::shared_ptr<C2Component::Traits> mTraits; ///< cached component traits
-
         c2_status_t mInit; ///< initialization result
 
         void *mLibHandle; ///< loaded library handle
@@ -799,12 +796,11 @@ private:
     c2_status_t findComponent(C2String name, std::shared_ptr<ComponentModule> *module);
 
     /**
-     * Loads each component module and discover its contents.
+     * Builds the traits of a known component without loading its module.
      */
-    void visitComponents();
+    static std::shared_ptr<const C2Component::Traits> createStaticTraits(
+            const ComponentMapEntry &entry);
 
-    std::mutex mMutex; ///< mutex guarding the component lists during construction
-    bool mVisited; ///< component modules visited
     std::map<C2String, ComponentLoader> mComponents; ///< componentName -> component module
     std::vector<std::shared_ptr<const C2Component::Traits>> mComponentList;
 
@@ -837,103 +833,6 @@ c2_status_t C2RKComponentStore::ComponentModule::init(
         mInit = C2_OK;
     }
 
-    if (mInit != C2_OK) {
-        return mInit;
-    }
-
-    std::shared_ptr<C2ComponentInterface> intf;
-    c2_status_t res = createInterface(0, &intf);
-    if (res != C2_OK) {
-        c2_info("failed to create interface: %d", res);
-        return mInit;
-    }
-
-    std::shared_ptr<C2Component::Traits> traits(new (std::nothrow) C2Component::Traits);
-    if (traits) {
-        traits->name = intf->getName();
-
-        C2ComponentKindSetting kind;
-        C2ComponentDomainSetting domain;
-        res = intf->query_vb({ &kind, &domain }, {}, C2_MAY_BLOCK, nullptr);
-        bool fixDomain = res != C2_OK;
-        if (res == C2_OK) {
-            traits->kind = kind.value;
-            traits->domain = domain.value;
-        } else {
-            // TODO: remove this fall-back
-            c2_info("failed to query interface for kind and domain: %d", res);
-
-            traits->kind =
-                (traits->name.find("encoder") != std::string::npos) ? C2Component::KIND_ENCODER :
-                (traits->name.find("decoder") != std::string::npos) ? C2Component::KIND_DECODER :
-                C2Component::KIND_OTHER;
-        }
-
-        uint32_t mediaTypeIndex =
-                traits->kind == C2Component::KIND_ENCODER ? C2PortMediaTypeSetting::output::PARAM_TYPE
-                : C2PortMediaTypeSetting::input::PARAM_TYPE;
-        std::vector<std::unique_ptr<C2Param>> params;
-        res = intf->query_vb({}, { mediaTypeIndex }, C2_MAY_BLOCK, &params);
-        if (res != C2_OK) {
-            c2_info("failed to query interface: %d", res);
-            return mInit;
-        }
-        if (params.size() != 1u) {
-            c2_info("failed to query interface: unexpected vector size: %zu", params.size());
-            return mInit;
-        }
-        C2PortMediaTypeSetting *mediaTypeConfig = C2PortMediaTypeSetting::From(params[0].get());
-        if (mediaTypeConfig == nullptr) {
-            c2_info("failed to query media type");
-            return mInit;
-        }
-        traits->mediaType =
-            std::string(mediaTypeConfig->m.value,
-                        strnlen(mediaTypeConfig->m.value, mediaTypeConfig->flexCount()));
-
-        if (fixDomain) {
-            if (strncmp(traits->mediaType.c_str(), "audio/", 6) == 0) {
-                traits->domain = C2Component::DOMAIN_AUDIO;
-            } else if (strncmp(traits->mediaType.c_str(), "video/", 6) == 0) {
-                traits->domain = C2Component::DOMAIN_VIDEO;
-            } else if (strncmp(traits->mediaType.c_str(), "image/", 6) == 0) {
-                traits->domain = C2Component::DOMAIN_IMAGE;
-            } else {
-                traits->domain = C2Component::DOMAIN_OTHER;
-            }
-        }
-
-        // TODO: get this properly from the store during emplace
-        switch (traits->domain) {
-        case C2Component::DOMAIN_AUDIO:
-            traits->rank = 8;
-            break;
-        default:
-            traits->rank = 128;
-        }
-
-        params.clear();
-        res = intf->query_vb({}, { C2ComponentAliasesSetting::PARAM_TYPE }, C2_MAY_BLOCK, &params);
-        if (res == C2_OK && params.size() == 1u) {
-            C2ComponentAliasesSetting *aliasesSetting =
-                C2ComponentAliasesSetting::From(params[0].get());
-            if (aliasesSetting) {
-                // Split aliases on ','
-                // This looks simpler in plain C and even std::string would still make a copy.
-                char *aliases = ::strndup(aliasesSetting->m.value, aliasesSetting->flexCount());
-                c2_info("'%s' has aliases: '%s'", intf->getName().c_str(), aliases);
-
-                for (char *tok, *ptr, *str = aliases; (tok = ::strtok_r(str, ",", &ptr));
-                        str = nullptr) {
-                    traits->aliases.push_back(tok);
-                    c2_info("adding alias: '%s'", tok);
-                }
-                free(aliases);
-            }
-        }
-    }
-    mTraits = traits;
-
     return mInit;
 }
 
@@ -982,35 +881,304 @@ c2_status_t C2RKComponentStore::ComponentModule::createComponent(
     return res;
 }
 
-std::shared_ptr<const C2Component::Traits> C2RKComponentStore::ComponentModule::getTraits() {
-    std::unique_lock<std::recursive_mutex> lock(mLock);
-    return mTraits;
+std::shared_ptr<const C2Component::Traits> C2RKComponentStore::createStaticTraits(
+        const ComponentMapEntry &entry) {
+    std::shared_ptr<C2Component::Traits> traits(new (std::nothrow) C2Component::Traits);
+    if (!traits) {
+        return nullptr;
+    }
+
+    traits->name = entry.componentName;
+    traits->mediaType = entry.mime;
+    traits->kind = (entry.type == MPP_CTX_ENC)
+            ? C2Component::KIND_ENCODER : C2Component::KIND_DECODER;
+    if (!C2RKMediaUtils::getDomainFromComponentName(entry.componentName, &traits->domain)) {
+        traits->domain = C2Component::DOMAIN_OTHER;
+    }
+
+    // keep the same rank the interface query used to give
+    switch (traits->domain) {
+    case C2Component::DOMAIN_AUDIO:
+        traits->rank = 8;
+        break;
+    default:
+        traits->rank = 128;
+    }
+
+    return traits;
 }
 
 C2RKComponentStore::C2RKComponentStore()
-    : mVisited(false),
-      mReflector(std::make_shared<C2ReflectorHelper>()),
+    : mReflector(std::make_shared<C2ReflectorHelper>()),
       mInterface(mReflector) {
-    auto emplace = [this](const char *componentName) {
-        mComponents.emplace(componentName, componentName);
+    auto emplace = [this](const ComponentMapEntry &entry) {
+        std::shared_ptr<const C2Component::Traits> traits = createStaticTraits(entry);
+        if (traits) {
+            mComponents.emplace(entry.componentName, entry.componentName);
+            mComponentList.push_back(traits);
+        }
     };
 
     for (int i = 0; i < C2_RK_ARRAY_ELEMS(kComponentMapEntry); ++i) {
         if (C2RKMediaUtils::checkHWSupport(
                 kComponentMapEntry[i].type, kComponentMapEntry[i].codingType)) {
             c2_info("plugin %s", kComponentMapEntry[i].componentName.c_str());
-            emplace(kComponentMapEntry[i].componentName.c_str());
+            emplace(kComponentMapEntry[i]);
         } else {
             c2_info("%s unsupport", kComponentMapEntry[i].componentName.c_str());
         }
     }
 }
 
+namespace {
+
+struct GraphicBlockInfo {
+    int32_t  fd;
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;
+    uint32_t stride;
+    uint64_t usage;
+    C2Rect   crop;
+};
+
+bool GetGraphicBlockInfo(const C2ConstGraphicBlock &block, GraphicBlockInfo *info) {
+    uint32_t bqSlot, generation;
+    uint64_t bqId;
+    const C2Handle *c2Handle = block.handle();
+
+    if (c2Handle == nullptr || c2Handle->numFds <= 0) {
+        return false;
+    }
+
+    _UnwrapNativeCodec2GrallocMetadata(
+            c2Handle, &info->width, &info->height, &info->format, &info->usage,
+            &info->stride, &generation, &bqId, &bqSlot);
+
+    info->fd = c2Handle->data[0];
+    info->crop = block.crop();
+    if (info->stride == 0) {
+        info->stride = info->width;
+    }
+
+    return true;
+}
+
+/*
+ * cpu write mapping of a gralloc block. C2ConstGraphicBlock::map() locks
+ * for read only, writes through it may never reach the device.
+ */
+struct GraphicWriteMap {
+    buffer_handle_t handle;
+    uint8_t        *data[C2PlanarLayout::MAX_NUM_PLANES];
+    int32_t         rowInc[C2PlanarLayout::MAX_NUM_PLANES];
+    int32_t         colInc[C2PlanarLayout::MAX_NUM_PLANES];
+};
+
+/* lock |block| laid out as |layout|, plane pointers start at the crop */
+bool LockGraphicBlockForWrite(
+        const C2ConstGraphicBlock &block, const GraphicBlockInfo &info,
+        const C2PlanarLayout &layout, GraphicWriteMap *map) {
+    GraphicBufferMapper &gm(GraphicBufferMapper::get());
+    native_handle_t *nHandle = UnwrapNativeCodec2GrallocHandle(block.handle());
+    Rect bounds(info.width, info.height);
+    status_t err = OK;
+
+    memset(map, 0, sizeof(*map));
+
+    err = gm.importBuffer(nHandle, info.width, info.height, 1, info.format,
+                          info.usage, info.stride, &map->handle);
+    native_handle_delete(nHandle);
+    if (err != OK) {
+        c2_err("failed to import dst buffer, err %d", err);
+        return false;
+    }
+
+    if (layout.type == C2PlanarLayout::TYPE_YUV) {
+        android_ycbcr ycbcr;
+
+        err = gm.lockYCbCr(map->handle, GRALLOC_USAGE_SW_WRITE_OFTEN, bounds, &ycbcr);
+        if (err == OK) {
+            map->data[C2PlanarLayout::PLANE_Y]   = (uint8_t *)ycbcr.y;
+            map->data[C2PlanarLayout::PLANE_U]   = (uint8_t *)ycbcr.cb;
+            map->data[C2PlanarLayout::PLANE_V]   = (uint8_t *)ycbcr.cr;
+            map->rowInc[C2PlanarLayout::PLANE_Y] = (int32_t)ycbcr.ystride;
+            map->rowInc[C2PlanarLayout::PLANE_U] = (int32_t)ycbcr.cstride;
+            map->rowInc[C2PlanarLayout::PLANE_V] = (int32_t)ycbcr.cstride;
+            map->colInc[C2PlanarLayout::PLANE_Y] = 1;
+            map->colInc[C2PlanarLayout::PLANE_U] = (int32_t)ycbcr.chroma_step;
+            map->colInc[C2PlanarLayout::PLANE_V] = (int32_t)ycbcr.chroma_step;
+        }
+    } else {
+        void *vaddr = nullptr;
+
+        /* same format as the source, components keep their offsets */
+        err = gm.lock(map->handle, GRALLOC_USAGE_SW_WRITE_OFTEN, bounds, &vaddr);
+        if (err == OK) {
+            for (uint32_t i = 0; i < layout.numPlanes; i++) {
+                const C2PlaneInfo &plane = layout.planes[i];
+                map->data[i]   = (uint8_t *)vaddr + plane.offset;
+                map->colInc[i] = plane.colInc;
+                map->rowInc[i] = (int32_t)info.stride * plane.colInc;
+            }
+        }
+    }
+
+    if (err != OK) {
+        c2_err("failed to lock dst buffer for write, err %d", err);
+        gm.freeBuffer(map->handle);
+        map->handle = nullptr;
+        return false;
+    }
+
+    for (uint32_t i = 0; i < layout.numPlanes; i++) {
+        const C2PlaneInfo &plane = layout.planes[i];
+        map->data[i] += (info.crop.top / plane.rowSampling) * map->rowInc[i] +
+                        (info.crop.left / plane.colSampling) * map->colInc[i];
+    }
+
+    return true;
+}
+
+void UnlockGraphicBlock(GraphicWriteMap *map) {
+    GraphicBufferMapper &gm(GraphicBufferMapper::get());
+
+    if (map->handle != nullptr) {
+        /* flushes the cpu writes */
+        gm.unlock(map->handle);
+        gm.freeBuffer(map->handle);
+        map->handle = nullptr;
+    }
+}
+
+/*
+ * plain row copy for buffers of the same format and crop size, memcpy of
+ * bionic is already neon optimized so there is no need for hand written one.
+ */
+c2_status_t CpuCopyGraphicBlock(
+        const C2ConstGraphicBlock &srcBlock, const GraphicBlockInfo &srcInfo,
+        const C2ConstGraphicBlock &dstBlock, const GraphicBlockInfo &dstInfo) {
+    C2GraphicView srcView = srcBlock.map().get();
+    GraphicWriteMap dstMap;
+    c2_status_t ret = C2_OK;
+
+    if (srcView.error() != C2_OK) {
+        c2_err("failed to map src graphic view, err %d", srcView.error());
+        return C2_CORRUPTED;
+    }
+
+    const C2PlanarLayout &layout = srcView.layout();
+    if (layout.type != C2PlanarLayout::TYPE_YUV &&
+        layout.type != C2PlanarLayout::TYPE_RGB &&
+        layout.type != C2PlanarLayout::TYPE_RGBA) {
+        return C2_CANNOT_DO;
+    }
+
+    if (!LockGraphicBlockForWrite(dstBlock, dstInfo, layout, &dstMap)) {
+        return C2_CANNOT_DO;
+    }
+
+    uint32_t width  = srcInfo.crop.width;
+    uint32_t height = srcInfo.crop.height;
+
+    /* interleaved components must sit the same way in both buffers */
+    for (uint32_t i = 0; i < layout.numPlanes; i++) {
+        const C2PlaneInfo &plane = layout.planes[i];
+
+        if (dstMap.colInc[i] != plane.colInc ||
+            dstMap.data[i] != dstMap.data[plane.rootIx] + plane.offset) {
+            ret = C2_CANNOT_DO;
+            break;
+        }
+    }
+
+    for (uint32_t i = 0; ret == C2_OK && i < layout.numPlanes; i++) {
+        const C2PlaneInfo &plane = layout.planes[i];
+
+        /* interleaved components are copied together with their root plane */
+        if (plane.offset != 0) {
+            continue;
+        }
+
+        const uint8_t *srcPtr = srcView.data()[i];
+        uint8_t *dstPtr = dstMap.data[i];
+        size_t rowBytes = (width / plane.colSampling) * plane.colInc;
+
+        for (uint32_t row = 0; row < height / plane.rowSampling; row++) {
+            memcpy(dstPtr, srcPtr, rowBytes);
+            srcPtr += plane.rowInc;
+            dstPtr += dstMap.rowInc[i];
+        }
+    }
+
+    UnlockGraphicBlock(&dstMap);
+
+    return ret;
+}
+
+} // namespace
+
 c2_status_t C2RKComponentStore::copyBuffer(
         std::shared_ptr<C2GraphicBuffer> src, std::shared_ptr<C2GraphicBuffer> dst) {
-    (void)src;
-    (void)dst;
-    return C2_OMITTED;
+    GraphicBlockInfo srcInfo, dstInfo;
+
+    if (!src || !dst ||
+        src->data().graphicBlocks().empty() ||
+        dst->data().graphicBlocks().empty()) {
+        return C2_BAD_VALUE;
+    }
+
+    const C2ConstGraphicBlock srcBlock = src->data().graphicBlocks().front();
+    const C2ConstGraphicBlock dstBlock = dst->data().graphicBlocks().front();
+
+    if (!GetGraphicBlockInfo(srcBlock, &srcInfo) ||
+        !GetGraphicBlockInfo(dstBlock, &dstInfo)) {
+        c2_err("copyBuffer: failed to get gralloc info");
+        return C2_BAD_VALUE;
+    }
+
+    c2_trace("copyBuffer: src fmt 0x%x crop [%d %d %d %d] dst fmt 0x%x crop [%d %d %d %d]",
+             srcInfo.format, srcInfo.crop.left, srcInfo.crop.top,
+             srcInfo.crop.width, srcInfo.crop.height,
+             dstInfo.format, dstInfo.crop.left, dstInfo.crop.top,
+             dstInfo.crop.width, dstInfo.crop.height);
+
+    bool sameGeometry = (srcInfo.format == dstInfo.format &&
+                         srcInfo.crop.width == dstInfo.crop.width &&
+                         srcInfo.crop.height == dstInfo.crop.height);
+
+    if (sameGeometry &&
+        srcInfo.crop.width * srcInfo.crop.height <= C2_RK_MIN_RGA_COPY_AREA) {
+        c2_status_t err = CpuCopyGraphicBlock(srcBlock, srcInfo, dstBlock, dstInfo);
+        if (err != C2_CANNOT_DO) {
+            return err;
+        }
+    }
+
+    RgaParam srcParam, dstParam;
+
+    C2RKRgaDef::paramInit(&srcParam, srcInfo.fd,
+                          srcInfo.crop.width, srcInfo.crop.height,
+                          srcInfo.stride, srcInfo.height);
+    srcParam.left = srcInfo.crop.left;
+    srcParam.top  = srcInfo.crop.top;
+
+    C2RKRgaDef::paramInit(&dstParam, dstInfo.fd,
+                          dstInfo.crop.width, dstInfo.crop.height,
+                          dstInfo.stride, dstInfo.height);
+    dstParam.left = dstInfo.crop.left;
+    dstParam.top  = dstInfo.crop.top;
+
+    if (C2RKRgaDef::blit(srcParam, srcInfo.format, dstParam, dstInfo.format)) {
+        return C2_OK;
+    }
+
+    if (sameGeometry) {
+        c2_warn("copyBuffer: rga failed, fallback to cpu copy");
+        return CpuCopyGraphicBlock(srcBlock, srcInfo, dstBlock, dstInfo);
+    }
+
+    return C2_CORRUPTED;
 }
 
 c2_status_t C2RKComponentStore::query_sm(
@@ -1026,35 +1194,15 @@ c2_status_t C2RKComponentStore::config_sm(
     return mInterface.config(params, C2_MAY_BLOCK, failures);
 }
 
-void C2RKComponentStore::visitComponents() {
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (mVisited) {
-        return;
-    }
-    for (auto &nameAndLoader : mComponents) {
-        ComponentLoader &loader = nameAndLoader.second;
-        std::shared_ptr<ComponentModule> module;
-        if (loader.fetchModule(&module) == C2_OK) {
-            std::shared_ptr<const C2Component::Traits> traits = module->getTraits();
-            if (traits) {
-                mComponentList.push_back(traits);
-            }
-        }
-    }
-    mVisited = true;
-}
-
 std::vector<std::shared_ptr<const C2Component::Traits>> C2RKComponentStore::listComponents() {
     // This method SHALL return within 500ms.
     c2_trace_f("in");
-    visitComponents();
     return mComponentList;
 }
 
 c2_status_t C2RKComponentStore::findComponent(
         C2String name, std::shared_ptr<ComponentModule> *module) {
     (*module).reset();
-    visitComponents();
 
     auto pos = mComponents.find(name);
     if (pos != mComponents.end()) {
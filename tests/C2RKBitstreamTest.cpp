@@ -0,0 +1,161 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "C2RKBitstream.h"
+
+namespace {
+
+template <size_t N>
+bool isSync(MppCodingType codingType, const uint8_t (&data)[N]) {
+    return C2RKBitstream::isSyncFrame(codingType, data, N);
+}
+
+template <size_t N>
+bool isNonRef(MppCodingType codingType, const uint8_t (&data)[N], int32_t maxTemporalId = -1) {
+    return C2RKBitstream::isNonRefFrame(codingType, data, N, maxTemporalId);
+}
+
+/* avc slices, the byte after the nal header carries first_mb 0 and the slice type */
+const uint8_t kAvcIdr[]       = { 0, 0, 0, 1, 0x65, 0x88 };
+const uint8_t kAvcISlice[]    = { 0, 0, 1, 0x21, 0x88 };    /* slice_type 7 */
+const uint8_t kAvcPSlice[]    = { 0, 0, 1, 0x41, 0x9a };    /* slice_type 5 */
+const uint8_t kAvcNonRef[]    = { 0, 0, 1, 0x01, 0x9a };
+const uint8_t kAvcSpsOnly[]   = { 0, 0, 1, 0x67, 0x42, 0x00, 0x1f };
+const uint8_t kAvcTruncated[] = { 0, 0, 1, 0x41 };
+
+/* hevc nal header is type << 1, then temporal id + 1 */
+const uint8_t kHevcIdr[]      = { 0, 0, 1, 0x26, 0x01, 0xaf };
+const uint8_t kHevcTrailR[]   = { 0, 0, 1, 0x02, 0x01, 0xaf };
+const uint8_t kHevcTrailN0[]  = { 0, 0, 1, 0x00, 0x01, 0xaf };
+const uint8_t kHevcTrailN1[]  = { 0, 0, 1, 0x00, 0x02, 0xaf };
+const uint8_t kHevcTsaN1[]    = { 0, 0, 1, 0x04, 0x02, 0xaf };
+/* vps, then sps with sps_max_sub_layers_minus1 2 */
+const uint8_t kHevcVpsSps[]   = { 0, 0, 1, 0x40, 0x01, 0x0c, 0x01,
+                                  0, 0, 1, 0x42, 0x01, 0x04, 0x01 };
+
+/* baseline sps, pic_order_cnt_type 2, max_num_ref_frames 3 */
+const uint8_t kAvcSpsBase[]   = { 0, 0, 1, 0x67, 0x42, 0x00, 0x1e, 0xd9, 0x00, 0x78, 0x02, 0x24 };
+/* high profile sps with a scaling list, pic_order_cnt_type 1, max_num_ref_frames 4 */
+const uint8_t kAvcSpsHigh[]   = { 0, 0, 1, 0x67, 0x64, 0x00, 0x28, 0xad, 0x90, 0xe3, 0x86,
+                                  0x84, 0x40, 0x50, 0xa6, 0x69, 0x95 };
+/* two sub-layers, sps_max_dec_pic_buffering_minus1 2 and 5, emulation prevention bytes */
+const uint8_t kHevcSps2Layers[] = {
+        0, 0, 1, 0x42, 0x01, 0x03, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+        0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x78, 0xc0, 0x00, 0x00, 0x03, 0x00, 0x00,
+        0x03, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x00, 0x5a,
+        0xa0, 0x03, 0xc0, 0x80, 0x10, 0xe7, 0xcb, 0x96, 0xf3, 0x3e };
+
+}  // namespace
+
+TEST(C2RKBitstreamTest, AvcSyncFrames) {
+    EXPECT_TRUE(isSync(MPP_VIDEO_CodingAVC, kAvcIdr));
+    EXPECT_TRUE(isSync(MPP_VIDEO_CodingAVC, kAvcISlice));
+    EXPECT_FALSE(isSync(MPP_VIDEO_CodingAVC, kAvcPSlice));
+    EXPECT_TRUE(isSync(MPP_VIDEO_CodingAVC, kAvcSpsOnly));
+    EXPECT_FALSE(isSync(MPP_VIDEO_CodingAVC, kAvcTruncated));
+}
+
+TEST(C2RKBitstreamTest, AvcNonRefFrames) {
+    EXPECT_TRUE(isNonRef(MPP_VIDEO_CodingAVC, kAvcNonRef));
+    EXPECT_FALSE(isNonRef(MPP_VIDEO_CodingAVC, kAvcPSlice));
+    EXPECT_FALSE(isNonRef(MPP_VIDEO_CodingAVC, kAvcIdr));
+    EXPECT_FALSE(isNonRef(MPP_VIDEO_CodingAVC, kAvcSpsOnly));
+}
+
+TEST(C2RKBitstreamTest, HevcSyncFrames) {
+    EXPECT_TRUE(isSync(MPP_VIDEO_CodingHEVC, kHevcIdr));
+    EXPECT_FALSE(isSync(MPP_VIDEO_CodingHEVC, kHevcTrailR));
+    EXPECT_TRUE(isSync(MPP_VIDEO_CodingHEVC, kHevcVpsSps));
+}
+
+TEST(C2RKBitstreamTest, HevcDropsOnlyTheTopSubLayer) {
+    /* unknown sub-layer count, never droppable */
+    EXPECT_FALSE(isNonRef(MPP_VIDEO_CodingHEVC, kHevcTrailN0));
+
+    EXPECT_TRUE(isNonRef(MPP_VIDEO_CodingHEVC, kHevcTrailN0, 0));
+    EXPECT_FALSE(isNonRef(MPP_VIDEO_CodingHEVC, kHevcTrailR, 0));
+
+    /* a sub-layer non-reference picture below the top is still referenced */
+    EXPECT_FALSE(isNonRef(MPP_VIDEO_CodingHEVC, kHevcTrailN0, 1));
+    EXPECT_TRUE(isNonRef(MPP_VIDEO_CodingHEVC, kHevcTrailN1, 1));
+    EXPECT_TRUE(isNonRef(MPP_VIDEO_CodingHEVC, kHevcTsaN1, 1));
+    EXPECT_FALSE(isNonRef(MPP_VIDEO_CodingHEVC, kHevcTrailN1, 2));
+}
+
+TEST(C2RKBitstreamTest, HevcMaxTemporalId) {
+    EXPECT_EQ(2, C2RKBitstream::getMaxTemporalId(
+            MPP_VIDEO_CodingHEVC, kHevcVpsSps, sizeof(kHevcVpsSps)));
+    EXPECT_EQ(-1, C2RKBitstream::getMaxTemporalId(
+            MPP_VIDEO_CodingHEVC, kHevcIdr, sizeof(kHevcIdr)));
+    EXPECT_EQ(-1, C2RKBitstream::getMaxTemporalId(
+            MPP_VIDEO_CodingAVC, kHevcVpsSps, sizeof(kHevcVpsSps)));
+}
+
+TEST(C2RKBitstreamTest, RefFrameCountFromTheSps) {
+    EXPECT_EQ(3, C2RKBitstream::getRefFrameCount(
+            MPP_VIDEO_CodingAVC, kAvcSpsBase, sizeof(kAvcSpsBase)));
+    EXPECT_EQ(4, C2RKBitstream::getRefFrameCount(
+            MPP_VIDEO_CodingAVC, kAvcSpsHigh, sizeof(kAvcSpsHigh)));
+    EXPECT_EQ(5, C2RKBitstream::getRefFrameCount(
+            MPP_VIDEO_CodingHEVC, kHevcSps2Layers, sizeof(kHevcSps2Layers)));
+
+    /* slices before any sps, or no sps at all */
+    EXPECT_EQ(-1, C2RKBitstream::getRefFrameCount(
+            MPP_VIDEO_CodingAVC, kAvcIdr, sizeof(kAvcIdr)));
+    EXPECT_EQ(-1, C2RKBitstream::getRefFrameCount(
+            MPP_VIDEO_CodingHEVC, kHevcIdr, sizeof(kHevcIdr)));
+    EXPECT_EQ(-1, C2RKBitstream::getRefFrameCount(
+            MPP_VIDEO_CodingVP9, kAvcSpsBase, sizeof(kAvcSpsBase)));
+}
+
+TEST(C2RKBitstreamTest, VpxAndAv1KeyFrames) {
+    const uint8_t vp8Key[]   = { 0x10, 0x02, 0x00 };
+    const uint8_t vp8Inter[] = { 0x11, 0x02, 0x00 };
+    const uint8_t vp9Key[]   = { 0x80, 0x00 };
+    const uint8_t vp9Inter[] = { 0x84, 0x00 };
+    /* OBU_FRAME with has_size_field, one byte payload */
+    const uint8_t av1Key[]   = { 0x32, 0x01, 0x00 };
+    const uint8_t av1Inter[] = { 0x32, 0x01, 0x20 };
+    const uint8_t av1SeqHdr[] = { 0x0a, 0x00, 0x32, 0x01, 0x20 };
+
+    EXPECT_TRUE(isSync(MPP_VIDEO_CodingVP8, vp8Key));
+    EXPECT_FALSE(isSync(MPP_VIDEO_CodingVP8, vp8Inter));
+    EXPECT_TRUE(isSync(MPP_VIDEO_CodingVP9, vp9Key));
+    EXPECT_FALSE(isSync(MPP_VIDEO_CodingVP9, vp9Inter));
+    EXPECT_TRUE(isSync(MPP_VIDEO_CodingAV1, av1Key));
+    EXPECT_FALSE(isSync(MPP_VIDEO_CodingAV1, av1Inter));
+    EXPECT_TRUE(isSync(MPP_VIDEO_CodingAV1, av1SeqHdr));
+}
+
+TEST(C2RKBitstreamTest, Mpeg2PictureTypes) {
+    /* picture header, temporal_reference 0 then picture_coding_type */
+    const uint8_t intra[] = { 0, 0, 1, 0x00, 0x00, 0x08 };
+    const uint8_t bidir[] = { 0, 0, 1, 0x00, 0x00, 0x18 };
+
+    EXPECT_TRUE(isSync(MPP_VIDEO_CodingMPEG2, intra));
+    EXPECT_FALSE(isNonRef(MPP_VIDEO_CodingMPEG2, intra));
+    EXPECT_FALSE(isSync(MPP_VIDEO_CodingMPEG2, bidir));
+    EXPECT_TRUE(isNonRef(MPP_VIDEO_CodingMPEG2, bidir));
+}
+
+TEST(C2RKBitstreamTest, EmptyInput) {
+    EXPECT_TRUE(C2RKBitstream::isSyncFrame(MPP_VIDEO_CodingAVC, nullptr, 0));
+    EXPECT_FALSE(C2RKBitstream::isNonRefFrame(MPP_VIDEO_CodingAVC, nullptr, 0));
+    EXPECT_EQ(-1, C2RKBitstream::getMaxTemporalId(MPP_VIDEO_CodingHEVC, nullptr, 0));
+    EXPECT_EQ(-1, C2RKBitstream::getRefFrameCount(MPP_VIDEO_CodingAVC, nullptr, 0));
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "C2RKCapacityDef.h"
+
+namespace {
+
+/* a synthetic soc: avc on both cores, hevc decode only, vp9 not limited */
+const C2CodecCapacity kCodecs[] = {
+    { MPP_VIDEO_CodingAVC,  C2_CAP_MBPS(1920, 1080, 60), C2_CAP_MBPS(1920, 1080, 30) },
+    { MPP_VIDEO_CodingHEVC, C2_CAP_MBPS(3840, 2160, 30), 0 },
+};
+
+const C2CapacityInfo kProfile = {
+    "synthetic", RK_CHIP_UNKOWN, (int)(sizeof(kCodecs) / sizeof(kCodecs[0])), kCodecs
+};
+
+C2CapacityRequest makeRequest(
+        MppCtxType type, MppCodingType codingType,
+        uint32_t width, uint32_t height, float frameRate) {
+    C2CapacityRequest request;
+
+    request.type = type;
+    request.codingType = codingType;
+    request.width = width;
+    request.height = height;
+    request.frameRate = frameRate;
+
+    return request;
+}
+
+}  // namespace
+
+TEST(C2RKCapacityTest, NullProfileAdmitsEverything) {
+    C2RKCapacity capacity(NULL);
+    int32_t id = -1;
+
+    EXPECT_EQ(C2_OK, capacity.reserve(
+            makeRequest(MPP_CTX_DEC, MPP_VIDEO_CodingAVC, 7680, 4320, 120), &id));
+    EXPECT_EQ(0, id);
+    EXPECT_EQ(UINT64_MAX, capacity.getAvailableMbps(MPP_CTX_DEC, MPP_VIDEO_CodingAVC));
+}
+
+TEST(C2RKCapacityTest, UnlistedCodecIsNotLimited) {
+    C2RKCapacity capacity(&kProfile);
+    int32_t id = -1;
+
+    EXPECT_EQ(C2_OK, capacity.reserve(
+            makeRequest(MPP_CTX_DEC, MPP_VIDEO_CodingVP9, 7680, 4320, 60), &id));
+    EXPECT_EQ(0, id);
+    EXPECT_EQ(UINT64_MAX, capacity.getAvailableMbps(MPP_CTX_DEC, MPP_VIDEO_CodingVP9));
+
+    /* listed, but a zero rate leaves the encoder free */
+    EXPECT_EQ(UINT64_MAX, capacity.getAvailableMbps(MPP_CTX_ENC, MPP_VIDEO_CodingHEVC));
+}
+
+TEST(C2RKCapacityTest, ReservesUntilTheCoreIsFull) {
+    C2RKCapacity capacity(&kProfile);
+    C2CapacityRequest request =
+            makeRequest(MPP_CTX_DEC, MPP_VIDEO_CodingAVC, 1920, 1080, 30);
+    int32_t first = 0, second = 0, third = 0;
+
+    EXPECT_EQ(C2_OK, capacity.reserve(request, &first));
+    EXPECT_NE(0, first);
+    EXPECT_EQ(C2_CAP_MBPS(1920, 1080, 30),
+              capacity.getAvailableMbps(MPP_CTX_DEC, MPP_VIDEO_CodingAVC));
+
+    EXPECT_EQ(C2_OK, capacity.reserve(request, &second));
+    EXPECT_EQ(0u, capacity.getAvailableMbps(MPP_CTX_DEC, MPP_VIDEO_CodingAVC));
+
+    EXPECT_EQ(C2_NO_MEMORY, capacity.reserve(request, &third));
+    EXPECT_EQ(0, third);
+
+    capacity.release(first);
+    EXPECT_EQ(C2_OK, capacity.reserve(request, &third));
+    EXPECT_NE(0, third);
+}
+
+TEST(C2RKCapacityTest, UnknownFrameRateCountsAs30) {
+    C2RKCapacity capacity(&kProfile);
+    int32_t id = 0;
+
+    EXPECT_EQ(C2_OK, capacity.reserve(
+            makeRequest(MPP_CTX_DEC, MPP_VIDEO_CodingAVC, 1920, 1080, 0), &id));
+    EXPECT_EQ(C2_CAP_MBPS(1920, 1080, 30),
+              capacity.getAvailableMbps(MPP_CTX_DEC, MPP_VIDEO_CodingAVC));
+}
+
+TEST(C2RKCapacityTest, DecoderAndEncoderCoresAreSeparate) {
+    C2RKCapacity capacity(&kProfile);
+    int32_t dec = 0, enc = 0;
+
+    EXPECT_EQ(C2_OK, capacity.reserve(
+            makeRequest(MPP_CTX_DEC, MPP_VIDEO_CodingAVC, 1920, 1080, 60), &dec));
+    EXPECT_EQ(0u, capacity.getAvailableMbps(MPP_CTX_DEC, MPP_VIDEO_CodingAVC));
+
+    EXPECT_EQ(C2_OK, capacity.reserve(
+            makeRequest(MPP_CTX_ENC, MPP_VIDEO_CodingAVC, 1920, 1080, 30), &enc));
+    EXPECT_NE(0, enc);
+    EXPECT_EQ(0u, capacity.getAvailableMbps(MPP_CTX_ENC, MPP_VIDEO_CodingAVC));
+}
+
+TEST(C2RKCapacityTest, UpdateMovesTheReservation) {
+    C2RKCapacity capacity(&kProfile);
+    int32_t id = 0, other = 0;
+
+    /* started at the configured size, the stream turns out larger */
+    EXPECT_EQ(C2_OK, capacity.reserve(
+            makeRequest(MPP_CTX_DEC, MPP_VIDEO_CodingAVC, 1280, 720, 30), &id));
+    EXPECT_EQ(C2_OK, capacity.update(
+            id, makeRequest(MPP_CTX_DEC, MPP_VIDEO_CodingAVC, 1920, 1080, 60)));
+    EXPECT_EQ(0u, capacity.getAvailableMbps(MPP_CTX_DEC, MPP_VIDEO_CodingAVC));
+    EXPECT_EQ(C2_NO_MEMORY, capacity.reserve(
+            makeRequest(MPP_CTX_DEC, MPP_VIDEO_CodingAVC, 320, 240, 30), &other));
+
+    /* too large for the core, the old share stays */
+    EXPECT_EQ(C2_NO_MEMORY, capacity.update(
+            id, makeRequest(MPP_CTX_DEC, MPP_VIDEO_CodingAVC, 3840, 2160, 30)));
+    EXPECT_EQ(0u, capacity.getAvailableMbps(MPP_CTX_DEC, MPP_VIDEO_CodingAVC));
+
+    /* and back down once the frame rate is known */
+    EXPECT_EQ(C2_OK, capacity.update(
+            id, makeRequest(MPP_CTX_DEC, MPP_VIDEO_CodingAVC, 1920, 1080, 30)));
+    EXPECT_EQ(C2_CAP_MBPS(1920, 1080, 30),
+              capacity.getAvailableMbps(MPP_CTX_DEC, MPP_VIDEO_CodingAVC));
+
+    EXPECT_EQ(C2_BAD_VALUE, capacity.update(
+            id + 100, makeRequest(MPP_CTX_DEC, MPP_VIDEO_CodingAVC, 1920, 1080, 30)));
+}
+
+TEST(C2RKCapacityTest, FindsProfilesByChipName) {
+    const C2CapacityInfo *info = C2RKCapacityDef::findCapacityInfo("rockchip,rk3588");
+
+    ASSERT_NE(nullptr, info);
+    EXPECT_EQ(RK_CHIP_3588, info->chipType);
+    EXPECT_EQ(nullptr, C2RKCapacityDef::findCapacityInfo("synthetic"));
+}
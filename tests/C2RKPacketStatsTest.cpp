@@ -0,0 +1,69 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "C2RKPacketStats.h"
+
+TEST(C2RKPacketStatsTest, EmptyStats) {
+    C2RKPacketStats stats;
+
+    EXPECT_EQ(0u, stats.getPercentile(50));
+    EXPECT_EQ(0u, stats.getMax());
+    EXPECT_EQ(0u, stats.getCount());
+}
+
+TEST(C2RKPacketStatsTest, PercentilesRoundUpToTheBin) {
+    C2RKPacketStats stats;
+
+    for (int i = 0; i < 99; i++) {
+        stats.add(10 * 1024, false);
+    }
+    stats.add(100 * 1024, true);
+
+    EXPECT_EQ(100u, stats.getCount());
+    EXPECT_EQ(1u, stats.getSyncCount());
+    EXPECT_EQ(100u * 1024, stats.getMax());
+    EXPECT_EQ(32u * 1024, stats.getPercentile(50));
+    EXPECT_EQ(32u * 1024, stats.getPercentile(99));
+    EXPECT_EQ(128u * 1024, stats.getPercentile(100));
+}
+
+TEST(C2RKPacketStatsTest, OversizedPacketsReportTheMax) {
+    C2RKPacketStats stats;
+
+    stats.add(8 * 1024 * 1024, true);
+    EXPECT_EQ(8u * 1024 * 1024, stats.getPercentile(50));
+}
+
+TEST(C2RKPacketStatsTest, OldPacketsDecay) {
+    C2RKPacketStats stats;
+
+    for (int i = 0; i < 1024; i++) {
+        stats.add(10 * 1024, false);
+    }
+    for (int i = 0; i < 1024; i++) {
+        stats.add(200 * 1024, false);
+    }
+
+    /* the max covers the whole stream, percentiles the recent part */
+    EXPECT_EQ(2048u, stats.getCount());
+    EXPECT_EQ(224u * 1024, stats.getPercentile(50));
+
+    stats.reset();
+    EXPECT_EQ(0u, stats.getCount());
+    EXPECT_EQ(0u, stats.getPercentile(50));
+}
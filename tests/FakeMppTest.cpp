@@ -0,0 +1,203 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+#include "rk_mpi.h"
+
+namespace {
+
+class FakeMppTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        MppPollType timeout = MPP_POLL_NON_BLOCK;
+
+        ASSERT_EQ(MPP_OK, mpp_create(&mCtx, &mMpi));
+        ASSERT_EQ(MPP_OK, mpp_init(mCtx, MPP_CTX_DEC, MPP_VIDEO_CodingAVC));
+        ASSERT_EQ(MPP_OK, mMpi->control(mCtx, MPP_SET_OUTPUT_TIMEOUT, &timeout));
+    }
+
+    void TearDown() override {
+        if (mCtx) {
+            mpp_destroy(mCtx);
+        }
+        if (mGroup) {
+            mpp_buffer_group_put(mGroup);
+        }
+    }
+
+    MPP_RET putPacket(int64_t pts, size_t size, bool eos = false, bool extra = false) {
+        static uint8_t data[64];
+        MppPacket packet = nullptr;
+
+        mpp_packet_init(&packet, data, size);
+        mpp_packet_set_pts(packet, pts);
+        if (eos) {
+            mpp_packet_set_eos(packet);
+        }
+        if (extra) {
+            mpp_packet_set_extra_data(packet);
+        }
+
+        MPP_RET ret = mMpi->decode_put_packet(mCtx, packet);
+        mpp_packet_deinit(&packet);
+
+        return ret;
+    }
+
+    MppFrame getFrame() {
+        MppFrame frame = nullptr;
+
+        EXPECT_EQ(MPP_OK, mMpi->decode_get_frame(mCtx, &frame));
+        return frame;
+    }
+
+    /* external group with |count| committed buffers, as surface mode does */
+    void commitBuffers(int32_t count, size_t size) {
+        ASSERT_EQ(MPP_OK, mpp_buffer_group_get_external(&mGroup, MPP_BUFFER_TYPE_ION));
+        ASSERT_EQ(MPP_OK, mMpi->control(mCtx, MPP_DEC_SET_EXT_BUF_GROUP, mGroup));
+
+        for (int32_t i = 0; i < count; i++) {
+            MppBufferInfo info;
+
+            memset(&info, 0, sizeof(info));
+            info.type  = MPP_BUFFER_TYPE_ION;
+            info.fd    = 100 + i;
+            info.size  = size;
+            info.index = i;
+            ASSERT_EQ(MPP_OK, mpp_buffer_commit(mGroup, &info));
+        }
+    }
+
+    /* consume the info change the first picture raises */
+    void ackInfoChange() {
+        MppFrame frame = getFrame();
+
+        ASSERT_NE(nullptr, frame);
+        EXPECT_TRUE(mpp_frame_get_info_change(frame));
+        mpp_frame_deinit(&frame);
+        ASSERT_EQ(MPP_OK, mMpi->control(mCtx, MPP_DEC_SET_INFO_CHANGE_READY, nullptr));
+    }
+
+    MppCtx         mCtx = nullptr;
+    MppApi        *mMpi = nullptr;
+    MppBufferGroup mGroup = nullptr;
+};
+
+}  // namespace
+
+TEST_F(FakeMppTest, InfoChangeBeforeTheFirstPicture) {
+    ASSERT_EQ(MPP_OK, putPacket(0, 32));
+
+    MppFrame frame = getFrame();
+    ASSERT_NE(nullptr, frame);
+    EXPECT_TRUE(mpp_frame_get_info_change(frame));
+    EXPECT_EQ(1920u, mpp_frame_get_width(frame));
+    EXPECT_EQ(1080u, mpp_frame_get_height(frame));
+    EXPECT_EQ(1920u, mpp_frame_get_hor_stride(frame));
+    EXPECT_EQ(1088u, mpp_frame_get_ver_stride(frame));
+    EXPECT_EQ((size_t)1920 * 1088 * 3 / 2, mpp_frame_get_buf_size(frame));
+    EXPECT_EQ(nullptr, mpp_frame_get_buffer(frame));
+    mpp_frame_deinit(&frame);
+
+    /* nothing comes out until the info change is acknowledged */
+    EXPECT_EQ(nullptr, getFrame());
+    ASSERT_EQ(MPP_OK, mMpi->control(mCtx, MPP_DEC_SET_INFO_CHANGE_READY, nullptr));
+
+    frame = getFrame();
+    ASSERT_NE(nullptr, frame);
+    EXPECT_FALSE(mpp_frame_get_info_change(frame));
+    EXPECT_NE(nullptr, mpp_frame_get_buffer(frame));
+    EXPECT_EQ(0, mpp_frame_get_pts(frame));
+    mpp_frame_deinit(&frame);
+}
+
+TEST_F(FakeMppTest, ConfigAndEmptyPacketsMakeNoPicture) {
+    ASSERT_EQ(MPP_OK, putPacket(0, 16, false, true));
+    ASSERT_EQ(MPP_OK, putPacket(0, 0));
+
+    EXPECT_EQ(nullptr, getFrame());
+}
+
+TEST_F(FakeMppTest, InputQueueIsBounded) {
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(MPP_OK, putPacket(i, 32));
+    }
+    EXPECT_EQ(MPP_NOK, putPacket(4, 32));
+}
+
+TEST_F(FakeMppTest, ExternalGroupBacksThePictures) {
+    size_t size = (size_t)1920 * 1088 * 3 / 2;
+
+    commitBuffers(2, size);
+    EXPECT_EQ(2, mpp_buffer_group_unused(mGroup));
+    EXPECT_EQ(2 * size, mpp_buffer_group_usage(mGroup));
+
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(MPP_OK, putPacket(i, 32));
+    }
+    ackInfoChange();
+
+    MppFrame first = getFrame();
+    MppFrame second = getFrame();
+    ASSERT_NE(nullptr, first);
+    ASSERT_NE(nullptr, second);
+    EXPECT_EQ(0, mpp_buffer_group_unused(mGroup));
+
+    /* starved until a buffer is returned */
+    EXPECT_EQ(nullptr, getFrame());
+    EXPECT_EQ(0, mpp_buffer_get_index(mpp_frame_get_buffer(first)));
+    mpp_frame_deinit(&first);
+    EXPECT_EQ(1, mpp_buffer_group_unused(mGroup));
+
+    MppFrame third = getFrame();
+    ASSERT_NE(nullptr, third);
+    EXPECT_EQ(2, mpp_frame_get_pts(third));
+    EXPECT_EQ(0, mpp_buffer_get_index(mpp_frame_get_buffer(third)));
+
+    mpp_frame_deinit(&second);
+    mpp_frame_deinit(&third);
+}
+
+TEST_F(FakeMppTest, EosFollowsTheLastPicture) {
+    ASSERT_EQ(MPP_OK, putPacket(0, 32));
+    ASSERT_EQ(MPP_OK, putPacket(33, 0, true));
+    ackInfoChange();
+
+    MppFrame frame = getFrame();
+    ASSERT_NE(nullptr, frame);
+    EXPECT_FALSE(mpp_frame_get_eos(frame));
+    mpp_frame_deinit(&frame);
+
+    frame = getFrame();
+    ASSERT_NE(nullptr, frame);
+    EXPECT_TRUE(mpp_frame_get_eos(frame));
+    EXPECT_EQ(nullptr, mpp_frame_get_buffer(frame));
+    mpp_frame_deinit(&frame);
+
+    EXPECT_EQ(nullptr, getFrame());
+}
+
+TEST_F(FakeMppTest, ResetDropsPendingInput) {
+    ASSERT_EQ(MPP_OK, putPacket(0, 32));
+    ackInfoChange();
+    ASSERT_EQ(MPP_OK, putPacket(33, 32));
+
+    ASSERT_EQ(MPP_OK, mMpi->reset(mCtx));
+    EXPECT_EQ(nullptr, getFrame());
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_C2_RK_BENCH_UTILS_H__
+#define ANDROID_C2_RK_BENCH_UTILS_H__
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include <C2Component.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+ * Helpers shared by the offline codec benchmarks: clocks, latency
+ * percentiles and a listener forwarding finished works to a callback.
+ */
+namespace c2_rk_bench {
+
+inline int64_t nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/* user + system cpu time of the whole process */
+inline int64_t cpuTimeUs() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (int64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000LL +
+           usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+class LatencyStats {
+public:
+    void add(int64_t us) { mSamples.push_back(us); }
+
+    size_t count() const { return mSamples.size(); }
+
+    /* nearest-rank percentile, |p| in [0, 100] */
+    int64_t percentile(double p) {
+        if (mSamples.empty()) {
+            return 0;
+        }
+        if (!mSorted) {
+            std::sort(mSamples.begin(), mSamples.end());
+            mSorted = true;
+        }
+        size_t rank = (size_t)(p / 100.0 * (mSamples.size() - 1) + 0.5);
+        return mSamples[std::min(rank, mSamples.size() - 1)];
+    }
+
+    int64_t average() const {
+        if (mSamples.empty()) {
+            return 0;
+        }
+        int64_t sum = 0;
+        for (int64_t v : mSamples) {
+            sum += v;
+        }
+        return sum / (int64_t)mSamples.size();
+    }
+
+private:
+    std::vector<int64_t> mSamples;
+    bool mSorted = false;
+};
+
+class Listener : public C2Component::Listener {
+public:
+    typedef std::function<void(std::unique_ptr<C2Work>)> WorkDoneCb;
+
+    explicit Listener(WorkDoneCb cb) : mWorkDone(cb) {}
+
+    void onWorkDone_nb(
+            std::weak_ptr<C2Component> /* component */,
+            std::list<std::unique_ptr<C2Work>> workItems) override {
+        for (std::unique_ptr<C2Work> &work : workItems) {
+            mWorkDone(std::move(work));
+        }
+    }
+
+    void onTripped_nb(
+            std::weak_ptr<C2Component> /* component */,
+            std::vector<std::shared_ptr<C2SettingResult>> /* settingResult */) override {
+    }
+
+    void onError_nb(
+            std::weak_ptr<C2Component> /* component */,
+            uint32_t errorCode) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        mError = errorCode;
+    }
+
+    uint32_t error() {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mError;
+    }
+
+private:
+    WorkDoneCb  mWorkDone;
+    std::mutex  mLock;
+    uint32_t    mError = 0;
+};
+
+}  // namespace c2_rk_bench
+
+#endif  // ANDROID_C2_RK_BENCH_UTILS_H__
@@ -0,0 +1,504 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Offline decode benchmark, drives C2RKMpiDec directly without the codec2
+ * service. Elementary streams are read into memory up front, split into
+ * access units and queued with a bounded number of works in flight.
+ *
+ * usage: c2_rk_dec_bench -i <file> [options]
+ *   -c <avc|hevc|vp8|vp9|av1>  codec, guessed from the file when omitted
+ *   -p <buffer|graphic>        output pool: basic graphic pool (buffer
+ *                              mode) or a local gralloc pool, default buffer
+ *   -n <frames>                stop after n access units, default all
+ *   -d <depth>                 input works in flight, default 8
+ *   -k <count>                 output buffers held like a renderer, default 2
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <C2Buffer.h>
+#include <C2Config.h>
+#include <C2PlatformSupport.h>
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+
+#include "C2RKComponent.h"
+#include "C2RKMpiDec.h"
+#include "C2RKBenchUtils.h"
+
+using namespace android;
+using namespace c2_rk_bench;
+
+namespace {
+
+const int64_t kStallTimeoutUs = 5000000LL;
+const int64_t kFrameDurationUs = 33333;
+
+enum StreamFormat {
+    STREAM_ANNEXB_AVC,
+    STREAM_ANNEXB_HEVC,
+    STREAM_IVF,
+};
+
+struct Options {
+    std::string input;
+    std::string codec;
+    bool        graphicPool = false;
+    uint32_t    maxFrames = 0;
+    uint32_t    depth = 8;
+    uint32_t    hold = 2;
+};
+
+class StreamReader {
+public:
+    StreamReader(std::vector<uint8_t> data, StreamFormat format)
+        : mData(std::move(data)), mFormat(format), mPos(0) {
+        if (mFormat == STREAM_IVF) {
+            uint32_t headerLen = mData[6] | (mData[7] << 8);
+            mPos = headerLen;
+        }
+    }
+
+    /* returns false at the end of stream */
+    bool next(const uint8_t **au, size_t *size) {
+        return (mFormat == STREAM_IVF) ? nextIvf(au, size) : nextAnnexB(au, size);
+    }
+
+private:
+    std::vector<uint8_t> mData;
+    StreamFormat mFormat;
+    size_t mPos;
+
+    bool nextIvf(const uint8_t **au, size_t *size) {
+        if (mPos + 12 > mData.size()) {
+            return false;
+        }
+        const uint8_t *p = &mData[mPos];
+        size_t frameSize = p[0] | (p[1] << 8) | (p[2] << 16) | ((size_t)p[3] << 24);
+        if (mPos + 12 + frameSize > mData.size()) {
+            fprintf(stderr, "truncated ivf frame at offset %zu\n", mPos);
+            return false;
+        }
+        *au = p + 12;
+        *size = frameSize;
+        mPos += 12 + frameSize;
+        return true;
+    }
+
+    /* offset of the next start code at or after |from|, or data size */
+    size_t findStartCode(size_t from) const {
+        for (size_t i = from; i + 3 <= mData.size(); i++) {
+            if (mData[i] == 0 && mData[i + 1] == 0 && mData[i + 2] == 1) {
+                return (i > 0 && mData[i - 1] == 0) ? i - 1 : i;
+            }
+        }
+        return mData.size();
+    }
+
+    /* whether the nal at |nal| (after the start code) opens a new access unit */
+    bool startsAccessUnit(const uint8_t *nal, size_t len, bool *isVcl) const {
+        if (mFormat == STREAM_ANNEXB_AVC) {
+            uint32_t type = nal[0] & 0x1f;
+            *isVcl = (type >= 1 && type <= 5);
+            if (*isVcl) {
+                /* first_mb_in_slice == 0 */
+                return len > 1 && (nal[1] & 0x80);
+            }
+            return type == 6 || type == 7 || type == 8 || type == 9 ||
+                   (type >= 14 && type <= 18);
+        }
+
+        uint32_t type = (nal[0] >> 1) & 0x3f;
+        *isVcl = (type < 32);
+        if (*isVcl) {
+            /* first_slice_segment_in_pic_flag */
+            return len > 2 && (nal[2] & 0x80);
+        }
+        return (type >= 32 && type <= 35) || type == 39 ||
+               (type >= 41 && type <= 44) || (type >= 48 && type <= 55);
+    }
+
+    bool nextAnnexB(const uint8_t **au, size_t *size) {
+        size_t start = findStartCode(mPos);
+        if (start >= mData.size()) {
+            return false;
+        }
+
+        bool vclSeen = false;
+        size_t nalStart = start;
+        while (nalStart < mData.size()) {
+            size_t payload = nalStart + ((mData[nalStart + 2] == 1) ? 3 : 4);
+            size_t nalEnd = findStartCode(payload);
+            bool isVcl = false;
+
+            if (payload < nalEnd &&
+                    startsAccessUnit(&mData[payload], nalEnd - payload, &isVcl) &&
+                    vclSeen) {
+                break;
+            }
+            vclSeen |= isVcl;
+            nalStart = nalEnd;
+        }
+
+        *au = &mData[start];
+        *size = nalStart - start;
+        mPos = nalStart;
+        return true;
+    }
+};
+
+bool readFile(const std::string &path, std::vector<uint8_t> *data) {
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (!fp) {
+        fprintf(stderr, "failed to open %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    data->resize(size > 0 ? size : 0);
+    size_t read = fread(data->data(), 1, data->size(), fp);
+    fclose(fp);
+    return read == data->size() && !data->empty();
+}
+
+bool probeStream(const std::vector<uint8_t> &data, Options *opts, StreamFormat *format) {
+    if (data.size() >= 32 && !memcmp(data.data(), "DKIF", 4)) {
+        *format = STREAM_IVF;
+        if (opts->codec.empty()) {
+            if (!memcmp(&data[8], "VP90", 4)) {
+                opts->codec = "vp9";
+            } else if (!memcmp(&data[8], "VP80", 4)) {
+                opts->codec = "vp8";
+            } else if (!memcmp(&data[8], "AV01", 4)) {
+                opts->codec = "av1";
+            }
+        }
+        return !opts->codec.empty();
+    }
+
+    if (opts->codec.empty()) {
+        const std::string &in = opts->input;
+        std::string ext = in.substr(in.find_last_of('.') + 1);
+        if (ext == "h264" || ext == "264" || ext == "avc") {
+            opts->codec = "avc";
+        } else if (ext == "h265" || ext == "265" || ext == "hevc") {
+            opts->codec = "hevc";
+        }
+    }
+    if (opts->codec == "avc") {
+        *format = STREAM_ANNEXB_AVC;
+    } else if (opts->codec == "hevc") {
+        *format = STREAM_ANNEXB_HEVC;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/* inode of the first fd identifies the dma-buf behind an output block */
+uint64_t bufferId(const std::shared_ptr<C2Buffer> &buffer) {
+    const C2BufferData &data = buffer->data();
+    if (data.graphicBlocks().empty()) {
+        return 0;
+    }
+    const C2Handle *handle = data.graphicBlocks().front().handle();
+    struct stat st;
+    if (!handle || handle->numFds < 1 || fstat(handle->data[0], &st)) {
+        return 0;
+    }
+    return (uint64_t)st.st_ino;
+}
+
+class DecodeSession {
+public:
+    explicit DecodeSession(const Options &opts) : mOpts(opts) {}
+
+    int run(StreamReader *reader);
+
+private:
+    const Options &mOpts;
+
+    std::mutex mLock;
+    std::condition_variable mCond;
+
+    uint32_t mInFlight = 0;
+    uint32_t mPeakInFlight = 0;
+    uint32_t mOutputs = 0;
+    bool     mEos = false;
+    int64_t  mFirstOutputUs = 0;
+
+    std::map<int64_t, int64_t> mQueueTimeUs;    /* pts -> queue time */
+    std::deque<std::shared_ptr<C2Buffer>> mHeld;
+    std::set<uint64_t> mBufferIds;
+    LatencyStats mLatency;
+
+    void onWorkDone(std::unique_ptr<C2Work> work);
+    c2_status_t setupGraphicPool(const std::shared_ptr<C2Component> &component);
+};
+
+void DecodeSession::onWorkDone(std::unique_ptr<C2Work> work) {
+    int64_t now = nowUs();
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (work->input.ordinal.frameIndex.peeku() != OUTPUT_WORK_INDEX) {
+        mInFlight--;
+    }
+
+    if (!work->worklets.empty()) {
+        const C2FrameData &output = work->worklets.front()->output;
+        for (const std::shared_ptr<C2Buffer> &buffer : output.buffers) {
+            auto it = mQueueTimeUs.find(output.ordinal.timestamp.peekll());
+            if (it != mQueueTimeUs.end()) {
+                mLatency.add(now - it->second);
+                mQueueTimeUs.erase(it);
+            }
+            mBufferIds.insert(bufferId(buffer));
+            mHeld.push_back(buffer);
+            while (mHeld.size() > mOpts.hold) {
+                mHeld.pop_front();
+            }
+            if (mOutputs == 0) {
+                mFirstOutputUs = now;
+            }
+            mOutputs++;
+        }
+        if (output.flags & C2FrameData::FLAG_END_OF_STREAM) {
+            mEos = true;
+        }
+    }
+
+    mCond.notify_all();
+}
+
+c2_status_t DecodeSession::setupGraphicPool(const std::shared_ptr<C2Component> &component) {
+    std::shared_ptr<C2BlockPool> pool;
+    c2_status_t err = CreateCodec2BlockPool(C2PlatformAllocatorStore::GRALLOC, component, &pool);
+    if (err != C2_OK) {
+        fprintf(stderr, "failed to create gralloc pool, err %d\n", err);
+        return err;
+    }
+
+    std::unique_ptr<C2PortBlockPoolsTuning::output> poolIds =
+            C2PortBlockPoolsTuning::output::AllocUnique({ pool->getLocalId() });
+    std::vector<std::unique_ptr<C2SettingResult>> failures;
+    err = component->intf()->config_vb({ poolIds.get() }, C2_MAY_BLOCK, &failures);
+    if (err != C2_OK) {
+        fprintf(stderr, "failed to config output pool, err %d\n", err);
+    }
+    return err;
+}
+
+int DecodeSession::run(StreamReader *reader) {
+    std::string name = "c2.rk." + mOpts.codec + ".decoder";
+    std::unique_ptr<C2ComponentFactory> factory(CreateRKMpiDecFactory(name));
+    std::shared_ptr<C2Component> component;
+    std::shared_ptr<C2BlockPool> inputPool;
+    c2_status_t err = C2_OK;
+    int64_t startUs = 0, startCpuUs = 0, wallUs = 0, cpuUs = 0;
+    int64_t startCallUs = 0;
+    uint32_t queued = 0;
+
+    err = factory->createComponent(0, &component, std::default_delete<C2Component>());
+    if (err != C2_OK || !component) {
+        fprintf(stderr, "failed to create %s, err %d\n", name.c_str(), err);
+        return 1;
+    }
+
+    std::shared_ptr<Listener> listener = std::make_shared<Listener>(
+            [this](std::unique_ptr<C2Work> work) { onWorkDone(std::move(work)); });
+    component->setListener_vb(listener, C2_MAY_BLOCK);
+
+    if (mOpts.graphicPool && setupGraphicPool(component) != C2_OK) {
+        goto error;
+    }
+
+    err = GetCodec2BlockPool(C2BlockPool::BASIC_LINEAR, nullptr, &inputPool);
+    if (err != C2_OK) {
+        fprintf(stderr, "failed to get linear pool, err %d\n", err);
+        goto error;
+    }
+
+    startCallUs = nowUs();
+    err = component->start();
+    if (err != C2_OK) {
+        fprintf(stderr, "failed to start %s, err %d\n", name.c_str(), err);
+        goto error;
+    }
+
+    startUs = nowUs();
+    startCpuUs = cpuTimeUs();
+
+    while (true) {
+        const uint8_t *au = nullptr;
+        size_t size = 0;
+        bool eos = (mOpts.maxFrames && queued >= mOpts.maxFrames) ||
+                   !reader->next(&au, &size);
+
+        std::unique_ptr<C2Work> work(new C2Work);
+        int64_t pts = (int64_t)queued * kFrameDurationUs;
+
+        work->input.flags = eos ? C2FrameData::FLAG_END_OF_STREAM : (C2FrameData::flags_t)0;
+        work->input.ordinal.timestamp = pts;
+        work->input.ordinal.frameIndex = queued;
+        work->input.ordinal.customOrdinal = pts;
+        work->worklets.emplace_back(new C2Worklet);
+
+        if (!eos) {
+            std::shared_ptr<C2LinearBlock> block;
+            err = inputPool->fetchLinearBlock(
+                    size, { C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE }, &block);
+            if (err != C2_OK) {
+                fprintf(stderr, "failed to fetch input block, err %d\n", err);
+                goto error;
+            }
+            C2WriteView view = block->map().get();
+            if (view.error() != C2_OK) {
+                fprintf(stderr, "failed to map input block, err %d\n", view.error());
+                goto error;
+            }
+            memcpy(view.data(), au, size);
+            work->input.buffers.push_back(
+                    C2Buffer::CreateLinearBuffer(block->share(0, size, C2Fence())));
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mLock);
+            if (!mCond.wait_for(lock, std::chrono::microseconds(kStallTimeoutUs),
+                                [this] { return mInFlight < mOpts.depth; })) {
+                fprintf(stderr, "decoder stalled with %u works in flight\n", mInFlight);
+                goto error;
+            }
+            mInFlight++;
+            mPeakInFlight = std::max(mPeakInFlight, mInFlight);
+            mQueueTimeUs[pts] = nowUs();
+        }
+
+        std::list<std::unique_ptr<C2Work>> items;
+        items.push_back(std::move(work));
+        err = component->queue_nb(&items);
+        if (err != C2_OK) {
+            fprintf(stderr, "failed to queue work, err %d\n", err);
+            goto error;
+        }
+        queued++;
+
+        if (eos) {
+            break;
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mLock);
+        if (!mCond.wait_for(lock, std::chrono::microseconds(kStallTimeoutUs),
+                            [this] { return mEos; })) {
+            fprintf(stderr, "eos not reached, %u frames out\n", mOutputs);
+        }
+        mHeld.clear();
+    }
+
+    wallUs = nowUs() - startUs;
+    cpuUs = cpuTimeUs() - startCpuUs;
+
+    component->stop();
+    component->release();
+
+    if (listener->error()) {
+        fprintf(stderr, "component reported error 0x%x\n", listener->error());
+    }
+
+    printf("component      : %s (%s pool)\n", name.c_str(),
+           mOpts.graphicPool ? "graphic" : "buffer");
+    printf("frames         : %u in, %u out\n", queued - 1, mOutputs);
+    printf("wall time      : %.3f s\n", wallUs / 1e6);
+    printf("fps            : %.2f\n", wallUs ? mOutputs * 1e6 / wallUs : 0.0);
+    printf("latency us     : avg %lld p50 %lld p90 %lld p99 %lld max %lld\n",
+           (long long)mLatency.average(), (long long)mLatency.percentile(50),
+           (long long)mLatency.percentile(90), (long long)mLatency.percentile(99),
+           (long long)mLatency.percentile(100));
+    printf("start latency  : start() %lld us, first output %lld us\n",
+           (long long)(startUs - startCallUs),
+           mFirstOutputUs ? (long long)(mFirstOutputUs - startCallUs) : -1LL);
+    printf("works in flight: peak %u\n", mPeakInFlight);
+    printf("output buffers : %zu distinct\n", mBufferIds.size());
+    printf("cpu time       : %.3f s (%.1f%% of wall, %.1f us/frame)\n", cpuUs / 1e6,
+           wallUs ? cpuUs * 100.0 / wallUs : 0.0,
+           mOutputs ? (double)cpuUs / mOutputs : 0.0);
+
+    return (mEos && !listener->error()) ? 0 : 1;
+
+error:
+    component->release();
+    return 1;
+}
+
+void usage(const char *self) {
+    fprintf(stderr,
+            "usage: %s -i <file> [-c avc|hevc|vp8|vp9|av1] [-p buffer|graphic]\n"
+            "       [-n frames] [-d depth] [-k held outputs]\n", self);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:c:p:n:d:k:h")) != -1) {
+        switch (opt) {
+        case 'i': opts.input = optarg; break;
+        case 'c': opts.codec = optarg; break;
+        case 'p': opts.graphicPool = !strcmp(optarg, "graphic"); break;
+        case 'n': opts.maxFrames = strtoul(optarg, nullptr, 0); break;
+        case 'd': opts.depth = strtoul(optarg, nullptr, 0); break;
+        case 'k': opts.hold = strtoul(optarg, nullptr, 0); break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<uint8_t> data;
+    StreamFormat format;
+
+    if (opts.input.empty() || !opts.depth) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!readFile(opts.input, &data)) {
+        return 1;
+    }
+    if (!probeStream(data, &opts, &format)) {
+        fprintf(stderr, "unknown stream type, pass -c\n");
+        return 1;
+    }
+
+    StreamReader reader(std::move(data), format);
+    DecodeSession session(opts);
+
+    return session.run(&reader);
+}
@@ -0,0 +1,556 @@
+/*
+ * Copyright 2023 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Encoder benchmark and rate control check, drives C2RKMpiEnc directly.
+ * Input frames are rendered into a small ring of gralloc blocks before
+ * the timed run, either from a raw NV12/RGBA file or a synthetic moving
+ * pattern, so file io and pattern generation stay out of the numbers.
+ *
+ * usage: c2_rk_enc_bench [options]
+ *   -c <avc|hevc|vp8>          codec, default avc
+ *   -s <width>x<height>        frame size, default 1920x1080
+ *   -f <fps>                   frame rate, default 30
+ *   -b <bps>                   target bitrate, default 8000000
+ *   -m <cbr|vbr|fixqp>         bitrate mode, default cbr
+ *   -g <frames>                sync frame interval, default 2 seconds
+ *   -t <layers>                temporal layers, default 0 (off)
+ *   -n <frames>                frames to encode, default 300
+ *   -i <file>                  raw input file, synthetic pattern if omitted
+ *   -x <nv12|rgba>             input pixel format, default nv12
+ *   -d <depth>                 input works in flight, default 4
+ *   -o <file>                  write the json report here, stdout if omitted
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <C2Buffer.h>
+#include <C2Config.h>
+#include <C2PlatformSupport.h>
+#include <hardware/gralloc.h>
+#include <hardware/hardware_rockchip.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "C2RKMpiEnc.h"
+#include "C2RKBenchUtils.h"
+
+using namespace android;
+using namespace c2_rk_bench;
+
+namespace {
+
+const int64_t kStallTimeoutUs = 5000000LL;
+const uint32_t kInputRingSize = 8;
+
+struct Options {
+    std::string codec = "avc";
+    uint32_t    width = 1920;
+    uint32_t    height = 1080;
+    uint32_t    fps = 30;
+    uint32_t    bitrate = 8000000;
+    std::string mode = "cbr";
+    uint32_t    gop = 0;
+    uint32_t    layers = 0;
+    uint32_t    frames = 300;
+    std::string input;
+    bool        rgba = false;
+    uint32_t    depth = 4;
+    std::string output;
+};
+
+struct KeyFrame {
+    uint32_t index;
+    size_t   size;
+};
+
+/*
+ * Packed source frame, NV12 (w*h*3/2) or RGBA (w*h*4), sampled per plane
+ * of whatever layout gralloc hands back.
+ */
+class SourceFrame {
+public:
+    SourceFrame(uint32_t w, uint32_t h, bool rgba)
+        : mWidth(w), mHeight(h), mRgba(rgba),
+          mData(rgba ? w * h * 4 : w * h * 3 / 2) {}
+
+    uint8_t *data() { return mData.data(); }
+    size_t size() const { return mData.size(); }
+
+    uint8_t sample(uint32_t plane, uint32_t x, uint32_t y) const {
+        if (mRgba) {
+            return mData[(y * mWidth + x) * 4 + plane];
+        }
+        if (plane == C2PlanarLayout::PLANE_Y) {
+            return mData[y * mWidth + x];
+        }
+        size_t uv = mWidth * mHeight + y * mWidth + x * 2;
+        return mData[uv + ((plane == C2PlanarLayout::PLANE_V) ? 1 : 0)];
+    }
+
+    /* moving gradient with some noise so that rate control has work to do */
+    void render(uint32_t index) {
+        uint32_t seed = index * 2654435761u;
+        auto noise = [&seed]() {
+            seed = seed * 1664525u + 1013904223u;
+            return (seed >> 24) & 0xf;
+        };
+
+        for (uint32_t y = 0; y < mHeight; y++) {
+            for (uint32_t x = 0; x < mWidth; x++) {
+                uint8_t v = (uint8_t)((x + y + index * 8) & 0xff) ^ noise();
+                if (mRgba) {
+                    uint8_t *p = &mData[(y * mWidth + x) * 4];
+                    p[0] = v;
+                    p[1] = (uint8_t)(x * 255 / mWidth);
+                    p[2] = (uint8_t)(y * 255 / mHeight);
+                    p[3] = 0xff;
+                } else {
+                    mData[y * mWidth + x] = v;
+                }
+            }
+        }
+        if (!mRgba) {
+            uint8_t *uv = &mData[mWidth * mHeight];
+            for (uint32_t y = 0; y < mHeight / 2; y++) {
+                for (uint32_t x = 0; x < mWidth / 2; x++) {
+                    uv[y * mWidth + x * 2]     = (uint8_t)(128 + ((x + index) & 0x3f));
+                    uv[y * mWidth + x * 2 + 1] = (uint8_t)(128 - ((y + index) & 0x3f));
+                }
+            }
+        }
+    }
+
+private:
+    uint32_t mWidth;
+    uint32_t mHeight;
+    bool     mRgba;
+    std::vector<uint8_t> mData;
+};
+
+bool fillBlock(const SourceFrame &src, const std::shared_ptr<C2GraphicBlock> &block) {
+    C2GraphicView view = block->map().get();
+    if (view.error() != C2_OK) {
+        fprintf(stderr, "failed to map input block, err %d\n", view.error());
+        return false;
+    }
+
+    const C2PlanarLayout &layout = view.layout();
+    for (uint32_t p = 0; p < layout.numPlanes; p++) {
+        const C2PlaneInfo &plane = layout.planes[p];
+        uint8_t *dst = view.data()[p];
+
+        for (uint32_t y = 0; y < view.height() / plane.rowSampling; y++) {
+            for (uint32_t x = 0; x < view.width() / plane.colSampling; x++) {
+                dst[y * plane.rowInc + x * plane.colInc] = src.sample(p, x, y);
+            }
+        }
+    }
+    return true;
+}
+
+class EncodeSession {
+public:
+    explicit EncodeSession(const Options &opts) : mOpts(opts) {}
+
+    int run();
+
+private:
+    const Options &mOpts;
+
+    std::mutex mLock;
+    std::condition_variable mCond;
+
+    uint32_t mInFlight = 0;
+    uint32_t mOutputs = 0;
+    bool     mEos = false;
+    size_t   mCsdSize = 0;
+
+    /* start() call, its return and the first encoded frame */
+    int64_t  mStartCallUs = 0;
+    int64_t  mStartDoneUs = 0;
+    int64_t  mFirstOutputUs = 0;
+
+    std::map<int64_t, int64_t> mQueueTimeUs;    /* pts -> queue time */
+    std::map<int64_t, size_t>  mBytesPerSecond;
+    std::map<int64_t, uint32_t> mFramesPerSecond;
+    std::vector<KeyFrame> mKeyFrames;
+    LatencyStats mLatency;
+
+    std::vector<std::shared_ptr<C2GraphicBlock>> mInputs;
+
+    int64_t ptsOf(uint32_t index) const {
+        return (int64_t)index * 1000000LL / mOpts.fps;
+    }
+
+    void onWorkDone(std::unique_ptr<C2Work> work);
+    c2_status_t configure(const std::shared_ptr<C2Component> &component);
+    c2_status_t prepareInputs();
+    void report(int64_t wallUs, int64_t cpuUs, uint32_t queued);
+};
+
+void EncodeSession::onWorkDone(std::unique_ptr<C2Work> work) {
+    int64_t now = nowUs();
+    std::lock_guard<std::mutex> lock(mLock);
+
+    mInFlight--;
+
+    if (!work->worklets.empty()) {
+        const C2FrameData &output = work->worklets.front()->output;
+        int64_t pts = output.ordinal.timestamp.peekll();
+
+        for (const std::unique_ptr<C2Param> &param : output.configUpdate) {
+            C2StreamInitDataInfo::output *csd = C2StreamInitDataInfo::output::From(param.get());
+            if (csd) {
+                mCsdSize += csd->flexCount();
+            }
+        }
+
+        for (const std::shared_ptr<C2Buffer> &buffer : output.buffers) {
+            if (buffer->data().linearBlocks().empty()) {
+                continue;
+            }
+            size_t size = buffer->data().linearBlocks().front().size();
+
+            auto it = mQueueTimeUs.find(pts);
+            if (it != mQueueTimeUs.end()) {
+                mLatency.add(now - it->second);
+                mQueueTimeUs.erase(it);
+            }
+
+            std::shared_ptr<const C2Info> info =
+                    buffer->getInfo(C2StreamPictureTypeMaskInfo::output::PARAM_TYPE);
+            if (info) {
+                mKeyFrames.push_back({ (uint32_t)output.ordinal.frameIndex.peeku(), size });
+            }
+
+            if (mOutputs == 0) {
+                mFirstOutputUs = now;
+            }
+            mBytesPerSecond[pts / 1000000LL] += size;
+            mFramesPerSecond[pts / 1000000LL]++;
+            mOutputs++;
+        }
+        if (output.flags & C2FrameData::FLAG_END_OF_STREAM) {
+            mEos = true;
+        }
+    }
+
+    mCond.notify_all();
+}
+
+c2_status_t EncodeSession::configure(const std::shared_ptr<C2Component> &component) {
+    C2Config::bitrate_mode_t mode = C2Config::BITRATE_CONST;
+    uint32_t gop = mOpts.gop ? mOpts.gop : mOpts.fps * 2;
+
+    if (mOpts.mode == "vbr") {
+        mode = C2Config::BITRATE_VARIABLE;
+    } else if (mOpts.mode == "fixqp") {
+        mode = C2Config::BITRATE_IGNORE;
+    }
+
+    C2StreamPictureSizeInfo::input size(0u, mOpts.width, mOpts.height);
+    C2StreamFrameRateInfo::output frameRate(0u, (float)mOpts.fps);
+    C2StreamBitrateInfo::output bitrate(0u, mOpts.bitrate);
+    C2StreamBitrateModeTuning::output bitrateMode(0u, mode);
+    C2StreamSyncFrameIntervalTuning::output syncInterval(
+            0u, (int64_t)gop * 1000000LL / mOpts.fps);
+    std::unique_ptr<C2StreamTemporalLayeringTuning::output> layering =
+            C2StreamTemporalLayeringTuning::output::AllocUnique(0, 0u, mOpts.layers, 0u);
+
+    std::vector<std::unique_ptr<C2SettingResult>> failures;
+    c2_status_t err = component->intf()->config_vb(
+            { &size, &frameRate, &bitrate, &bitrateMode, &syncInterval, layering.get() },
+            C2_MAY_BLOCK, &failures);
+    if (err != C2_OK) {
+        fprintf(stderr, "failed to configure encoder, err %d, %zu failures\n",
+                err, failures.size());
+    }
+    return err;
+}
+
+c2_status_t EncodeSession::prepareInputs() {
+    std::shared_ptr<C2BlockPool> pool;
+    SourceFrame frame(mOpts.width, mOpts.height, mOpts.rgba);
+    FILE *fp = nullptr;
+    uint32_t format = mOpts.rgba ? HAL_PIXEL_FORMAT_RGBA_8888 : HAL_PIXEL_FORMAT_YCrCb_NV12;
+    C2MemoryUsage usage = C2AndroidMemoryUsage::FromGrallocUsage(
+            GRALLOC_USAGE_SW_WRITE_OFTEN | GRALLOC_USAGE_HW_VIDEO_ENCODER);
+    c2_status_t err = GetCodec2BlockPool(C2BlockPool::BASIC_GRAPHIC, nullptr, &pool);
+
+    if (err != C2_OK) {
+        fprintf(stderr, "failed to get graphic pool, err %d\n", err);
+        return err;
+    }
+
+    if (!mOpts.input.empty()) {
+        fp = fopen(mOpts.input.c_str(), "rb");
+        if (!fp) {
+            fprintf(stderr, "failed to open %s: %s\n", mOpts.input.c_str(), strerror(errno));
+            return C2_NOT_FOUND;
+        }
+    }
+
+    for (uint32_t i = 0; i < kInputRingSize; i++) {
+        std::shared_ptr<C2GraphicBlock> block;
+
+        if (fp) {
+            /* only the first frames of the file are used, then cycled */
+            if (fread(frame.data(), 1, frame.size(), fp) != frame.size()) {
+                if (mInputs.empty()) {
+                    fprintf(stderr, "%s is smaller than one frame\n", mOpts.input.c_str());
+                    err = C2_BAD_VALUE;
+                }
+                break;
+            }
+        } else {
+            frame.render(i);
+        }
+
+        err = pool->fetchGraphicBlock(mOpts.width, mOpts.height, format, usage, &block);
+        if (err != C2_OK) {
+            fprintf(stderr, "failed to fetch input block, err %d\n", err);
+            break;
+        }
+        if (!fillBlock(frame, block)) {
+            err = C2_CORRUPTED;
+            break;
+        }
+        mInputs.push_back(block);
+    }
+
+    if (fp) {
+        fclose(fp);
+    }
+    return err;
+}
+
+void EncodeSession::report(int64_t wallUs, int64_t cpuUs, uint32_t queued) {
+    FILE *fp = stdout;
+
+    if (!mOpts.output.empty()) {
+        fp = fopen(mOpts.output.c_str(), "w");
+        if (!fp) {
+            fprintf(stderr, "failed to open %s: %s\n", mOpts.output.c_str(), strerror(errno));
+            fp = stdout;
+        }
+    }
+
+    /* scale the last, possibly partial, second by its frame count */
+    std::vector<int64_t> achieved;
+    int64_t totalBits = 0;
+    for (auto &it : mBytesPerSecond) {
+        uint32_t frames = mFramesPerSecond[it.first];
+        int64_t bits = (int64_t)it.second * 8;
+        totalBits += bits;
+        achieved.push_back(frames < mOpts.fps ? bits * mOpts.fps / frames : bits);
+    }
+    double seconds = (double)mOutputs / mOpts.fps;
+    double avgBps = seconds > 0 ? totalBits / seconds : 0;
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"component\": \"c2.rk.%s.encoder\",\n", mOpts.codec.c_str());
+    fprintf(fp, "  \"width\": %u,\n  \"height\": %u,\n", mOpts.width, mOpts.height);
+    fprintf(fp, "  \"format\": \"%s\",\n", mOpts.rgba ? "rgba" : "nv12");
+    fprintf(fp, "  \"fps\": %u,\n", mOpts.fps);
+    fprintf(fp, "  \"bitrate_mode\": \"%s\",\n", mOpts.mode.c_str());
+    fprintf(fp, "  \"bitrate_target\": %u,\n", mOpts.bitrate);
+    fprintf(fp, "  \"temporal_layers\": %u,\n", mOpts.layers);
+    fprintf(fp, "  \"frames_in\": %u,\n  \"frames_out\": %u,\n", queued, mOutputs);
+    fprintf(fp, "  \"wall_s\": %.3f,\n", wallUs / 1e6);
+    fprintf(fp, "  \"encode_fps\": %.2f,\n", wallUs ? mOutputs * 1e6 / wallUs : 0.0);
+    fprintf(fp, "  \"cpu_s\": %.3f,\n", cpuUs / 1e6);
+    fprintf(fp, "  \"start_latency_us\": { \"start\": %lld, \"first_output\": %lld },\n",
+            (long long)(mStartDoneUs - mStartCallUs),
+            mFirstOutputUs ? (long long)(mFirstOutputUs - mStartCallUs) : -1LL);
+    fprintf(fp, "  \"latency_us\": { \"avg\": %lld, \"p50\": %lld, \"p90\": %lld, "
+                "\"p99\": %lld, \"max\": %lld },\n",
+            (long long)mLatency.average(), (long long)mLatency.percentile(50),
+            (long long)mLatency.percentile(90), (long long)mLatency.percentile(99),
+            (long long)mLatency.percentile(100));
+    fprintf(fp, "  \"bitrate_avg\": %.0f,\n", avgBps);
+    fprintf(fp, "  \"bitrate_error_pct\": %.2f,\n",
+            mOpts.bitrate ? (avgBps - mOpts.bitrate) * 100.0 / mOpts.bitrate : 0.0);
+    fprintf(fp, "  \"bitrate_per_second\": [");
+    for (size_t i = 0; i < achieved.size(); i++) {
+        fprintf(fp, "%s%lld", i ? ", " : "", (long long)achieved[i]);
+    }
+    fprintf(fp, "],\n");
+    fprintf(fp, "  \"csd_bytes\": %zu,\n", mCsdSize);
+    fprintf(fp, "  \"keyframes\": [");
+    for (size_t i = 0; i < mKeyFrames.size(); i++) {
+        fprintf(fp, "%s{ \"frame\": %u, \"bytes\": %zu }", i ? ", " : "",
+                mKeyFrames[i].index, mKeyFrames[i].size);
+    }
+    fprintf(fp, "]\n");
+    fprintf(fp, "}\n");
+
+    if (fp != stdout) {
+        fclose(fp);
+    }
+}
+
+int EncodeSession::run() {
+    std::string name = "c2.rk." + mOpts.codec + ".encoder";
+    std::unique_ptr<C2ComponentFactory> factory(CreateRKMpiEncFactory(name));
+    std::shared_ptr<C2Component> component;
+    c2_status_t err = C2_OK;
+    int64_t startUs = 0, startCpuUs = 0, wallUs = 0, cpuUs = 0;
+    uint32_t queued = 0;
+
+    err = factory->createComponent(0, &component, std::default_delete<C2Component>());
+    if (err != C2_OK || !component) {
+        fprintf(stderr, "failed to create %s, err %d\n", name.c_str(), err);
+        return 1;
+    }
+
+    std::shared_ptr<Listener> listener = std::make_shared<Listener>(
+            [this](std::unique_ptr<C2Work> work) { onWorkDone(std::move(work)); });
+    component->setListener_vb(listener, C2_MAY_BLOCK);
+
+    if (configure(component) != C2_OK || prepareInputs() != C2_OK) {
+        goto error;
+    }
+
+    mStartCallUs = nowUs();
+    err = component->start();
+    if (err != C2_OK) {
+        fprintf(stderr, "failed to start %s, err %d\n", name.c_str(), err);
+        goto error;
+    }
+
+    startUs = mStartDoneUs = nowUs();
+    startCpuUs = cpuTimeUs();
+
+    for (queued = 0; queued <= mOpts.frames; queued++) {
+        bool eos = (queued == mOpts.frames);
+        int64_t pts = ptsOf(queued);
+        std::unique_ptr<C2Work> work(new C2Work);
+
+        work->input.flags = eos ? C2FrameData::FLAG_END_OF_STREAM : (C2FrameData::flags_t)0;
+        work->input.ordinal.timestamp = pts;
+        work->input.ordinal.frameIndex = queued;
+        work->input.ordinal.customOrdinal = pts;
+        work->worklets.emplace_back(new C2Worklet);
+
+        if (!eos) {
+            const std::shared_ptr<C2GraphicBlock> &block = mInputs[queued % mInputs.size()];
+            work->input.buffers.push_back(C2Buffer::CreateGraphicBuffer(
+                    block->share(C2Rect(mOpts.width, mOpts.height), C2Fence())));
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mLock);
+            if (!mCond.wait_for(lock, std::chrono::microseconds(kStallTimeoutUs),
+                                [this] { return mInFlight < mOpts.depth; })) {
+                fprintf(stderr, "encoder stalled with %u works in flight\n", mInFlight);
+                goto error;
+            }
+            mInFlight++;
+            mQueueTimeUs[pts] = nowUs();
+        }
+
+        std::list<std::unique_ptr<C2Work>> items;
+        items.push_back(std::move(work));
+        err = component->queue_nb(&items);
+        if (err != C2_OK) {
+            fprintf(stderr, "failed to queue work, err %d\n", err);
+            goto error;
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mLock);
+        if (!mCond.wait_for(lock, std::chrono::microseconds(kStallTimeoutUs),
+                            [this] { return mEos; })) {
+            fprintf(stderr, "eos not reached, %u frames out\n", mOutputs);
+        }
+    }
+
+    wallUs = nowUs() - startUs;
+    cpuUs = cpuTimeUs() - startCpuUs;
+
+    component->stop();
+    component->release();
+
+    if (listener->error()) {
+        fprintf(stderr, "component reported error 0x%x\n", listener->error());
+    }
+
+    report(wallUs, cpuUs, mOpts.frames);
+
+    return (mEos && !listener->error()) ? 0 : 1;
+
+error:
+    component->release();
+    return 1;
+}
+
+void usage(const char *self) {
+    fprintf(stderr,
+            "usage: %s [-c avc|hevc|vp8] [-s WxH] [-f fps] [-b bps] [-m cbr|vbr|fixqp]\n"
+            "       [-g gop] [-t layers] [-n frames] [-i file] [-x nv12|rgba]\n"
+            "       [-d depth] [-o report.json]\n", self);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:s:f:b:m:g:t:n:i:x:d:o:h")) != -1) {
+        switch (opt) {
+        case 'c': opts.codec = optarg; break;
+        case 's':
+            if (sscanf(optarg, "%ux%u", &opts.width, &opts.height) != 2) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'f': opts.fps = strtoul(optarg, nullptr, 0); break;
+        case 'b': opts.bitrate = strtoul(optarg, nullptr, 0); break;
+        case 'm': opts.mode = optarg; break;
+        case 'g': opts.gop = strtoul(optarg, nullptr, 0); break;
+        case 't': opts.layers = strtoul(optarg, nullptr, 0); break;
+        case 'n': opts.frames = strtoul(optarg, nullptr, 0); break;
+        case 'i': opts.input = optarg; break;
+        case 'x': opts.rgba = !strcmp(optarg, "rgba"); break;
+        case 'd': opts.depth = strtoul(optarg, nullptr, 0); break;
+        case 'o': opts.output = optarg; break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!opts.fps || !opts.depth || !opts.frames || !opts.width || !opts.height ||
+            (opts.mode != "cbr" && opts.mode != "vbr" && opts.mode != "fixqp")) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    EncodeSession session(opts);
+
+    return session.run();
+}